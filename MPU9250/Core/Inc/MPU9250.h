@@ -27,6 +27,7 @@ typedef struct
 	float acc[3];    /*3 axis accel OutPut*/
 	float gyr[3];	 /*3 axis gyro OutPut*/
 	float mag[3];	 /*3 axis mag OutPut*/
+	float temp;	 	 /*die temperature OutPut in degC*/
 
 }MPU9250_Handle_t;
 
@@ -38,6 +39,31 @@ uint8_t MPU9250_init(MPU9250_Handle_t *imu);
 void MPU9250_ReadAccel(MPU9250_Handle_t *imu);
 void MPU9250_ReadGyro(MPU9250_Handle_t *imu);
 void MPU9250_ReadMag(MPU9250_Handle_t *imu);
+void MPU9250_ReadMotion(MPU9250_Handle_t *imu); // Accel + Temp + Gyro in one 14 byte burst
+/*
+ * Non blocking, the same burst on DMA (I2C1_RX stream linked in HAL_I2C_MspInit, I2C1 event/error IRQs on).
+ * StartReadDMA returns 1 if the transfer was started, 0 while one is in flight or if the HAL refused it.
+ * GetLatest decodes the last completed burst into acc, gyr and temp, 1 if it is newer than the previous call.
+ * The HAL I2C completion/error callbacks are defined in MPU9250.c, define MPU9250_NO_HAL_CALLBACKS
+ * to provide them elsewhere and call MPU9250_OnDMAComplete / MPU9250_OnDMAError from there.
+ */
+uint8_t MPU9250_StartReadDMA(MPU9250_Handle_t *imu);
+uint8_t MPU9250_GetLatest(MPU9250_Handle_t *imu);
+void MPU9250_OnDMAComplete(I2C_HandleTypeDef *hi2c);
+void MPU9250_OnDMAError(I2C_HandleTypeDef *hi2c);
+/*
+ * Data ready interrupt driven acquisition, INT on an EXTI rising edge line (MPU_INT_Pin).
+ * EnableDataReadyIRQ makes the latched INT clear on any read, the EXTI callback then starts the DMA
+ * burst which also clears it for the next sample. Read the result with MPU9250_GetLatest.
+ * An edge while the previous burst is still in flight is read once that burst completes. A second one
+ * in the same burst, a burst the HAL refuses or a DMA error count as dropped samples, the last two
+ * also clear the INT latch with a blocking INT_STATUS read.
+ * HAL_GPIO_EXTI_Callback is in MPU9250.c as well (MPU9250_NO_HAL_CALLBACKS), it calls MPU9250_OnDataReady.
+ */
+void MPU9250_EnableDataReadyIRQ(MPU9250_Handle_t *imu, uint16_t intPin);
+void MPU9250_DisableDataReadyIRQ(void);
+void MPU9250_OnDataReady(uint16_t GPIO_Pin);
+uint32_t MPU9250_DroppedSamples(void);
 //Reset
 void MPU9250_Reset();
 
@@ -109,6 +135,9 @@ float getMres(uint8_t Mscale);
 #define INT_ENABLE       0x38
 #define DMP_INT_STATUS   0x39  // Check DMP interrupt
 #define INT_STATUS       0x3A
+#define INT_LATCH_EN     0x20  // INT_PIN_CFG, INT held until cleared
+#define INT_ANYRD_2CLEAR 0x10  // INT_PIN_CFG, cleared by any read, the motion burst re-arms it
+#define INT_BYPASS_EN    0x02  // INT_PIN_CFG, host access to the AK8963
 
 //Accelerometer
 #define ACCEL_XOUT_H     0x3B
@@ -171,8 +200,15 @@ float getMres(uint8_t Mscale);
 
 #define MPU9250_I2C_TIMEOUT 100
 
+//Burst length of ACCEL_XOUT_H .. GYRO_ZOUT_L (accel 6 + temp 2 + gyro 6)
+#define MPU9250_MOTION_BURST_LEN 14
+
+//Die temperature conversion @refer register map pg 33
+#define TEMP_SENSITIVITY 333.87f
+#define TEMP_ROOM_OFFSET 21.0f
+
 //Math Constants
-#define PI 3.142857f
+#define PI 3.14159265358979f
 #define g  9.80665f
 //Enums to select the scale and range
 enum Ascale
@@ -190,7 +226,34 @@ enum Mscale
 	MFS_14BITS = 0, MFS_16BITS
 };
 
-/*Scale selection Macros*/
+/*Scale selection Macros, the init script in MPU9250.c is built from these at compile time*/
+#ifndef MPU9250_ASCALE
+#define MPU9250_ASCALE      AFS_2G
+#endif
+#ifndef MPU9250_GSCALE
+#define MPU9250_GSCALE      GFS_250DPS
+#endif
+#ifndef MPU9250_MSCALE
+#define MPU9250_MSCALE      MFS_16BITS
+#endif
+#ifndef MPU9250_SMPLRT_DIV
+#define MPU9250_SMPLRT_DIV  0x04  // Sample_rate = 1KHz/(1 + SMPLRT_DIV) = 200Hz
+#endif
+#ifndef MPU9250_GYRO_DLPF
+#define MPU9250_GYRO_DLPF   0x03  // 41Hz
+#endif
+#ifndef MPU9250_ACCEL_DLPF
+#define MPU9250_ACCEL_DLPF  0x03  // 41Hz
+#endif
+
+/*
+ * Board mounting, body axis i = sign i * sensor axis (axis i), for accel, gyro and the mag.
+ * Has to be a rotation, not a mirror: NED is X, -Y, -Z with the chip face up and X forward.
+ */
+#ifndef MPU9250_MOUNT_AXES
+#define MPU9250_MOUNT_AXES   0, 1, 2
+#define MPU9250_MOUNT_SIGNS  1.0f, -1.0f, -1.0f
+#endif
 
 
 #endif /* INC_MPU9250_H_ */
@@ -0,0 +1,38 @@
+/*
+ * fixfmt.h
+ *
+ *  Allocation free number formatting for the debug console, replaces sprintf("%.2f").
+ *
+ *  Each call writes at the given position and returns the number of characters written, no
+ *  terminating 0, so a record is built by advancing a pointer and sent with its exact length:
+ *
+ *  char *p = buf;
+ *  p += fixfmt_str(p, "ACCEL:: ");
+ *  p += fixfmt_axes(p, imu.acc, "g", 2);
+ *  HAL_UART_Transmit(&huart2, (uint8_t*)buf, p - buf, HAL_MAX_DELAY);
+ */
+
+#ifndef INC_FIXFMT_H_
+#define INC_FIXFMT_H_
+
+#include <stdint.h>
+
+#define FIXFMT_MAX_DECIMALS   4
+#define FIXFMT_FLOAT_MAX_LEN  (12 + FIXFMT_MAX_DECIMALS)   // '-', 10 digits, '.' and the decimals
+
+uint8_t fixfmt_str(char *out, const char *s);
+
+/*
+ * x with decimals (0 - 4) fractional digits, the same characters as printf("%.*f", decimals, x):
+ * rounded to nearest from the exact value of the float, ties to even, "-" for every negative
+ * sign bit, "nan" and "inf". Integer only, the float is taken apart into mantissa and exponent.
+ * Finite values past 4294967295 saturate there, printf would print all the digits.
+ */
+uint8_t fixfmt_float(char *out, float x, uint8_t decimals);
+
+/*
+ * "X: <v[0]> <unit>, Y: <v[1]> <unit>, Z: <v[2]> <unit>"
+ */
+uint8_t fixfmt_axes(char *out, const float v[3], const char *unit, uint8_t decimals);
+
+#endif /* INC_FIXFMT_H_ */
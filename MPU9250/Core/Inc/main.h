@@ -73,6 +73,9 @@ void Error_Handler(void);
 #define SWO_Pin GPIO_PIN_3
 #define SWO_GPIO_Port GPIOB
 /* USER CODE BEGIN Private defines */
+#define MPU_INT_Pin GPIO_PIN_8           /* MPU9250 INT, Arduino D7 on the Nucleo header */
+#define MPU_INT_GPIO_Port GPIOA
+#define MPU_INT_EXTI_IRQn EXTI9_5_IRQn
 
 /* USER CODE END Private defines */
 
@@ -16,103 +16,200 @@
 // Mag  and Accel Compensation
 */
 #include "MPU9250.h"
+#include <string.h>
 
-static void AK8963_init(I2C_HandleTypeDef *I2Chandle);
+static uint8_t AK8963_init(I2C_HandleTypeDef *I2Chandle);
+static void decodeMotion(const uint8_t *rawdata, MPU9250_Handle_t *imu);
 
 static void writeByte(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress, uint8_t data);
+static void writeBytes(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress, const uint8_t *data, uint16_t len);
 static uint8_t readByte(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress);
+static uint8_t readReg(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress, uint8_t *data);
 
-//Default Selection, overided with the enum scale selection
-static uint8_t Ascale = AFS_2G;     // AFS_2G, AFS_4G, AFS_8G, AFS_16G
-static uint8_t Gscale = GFS_250DPS; // GFS_250DPS, GFS_500DPS, GFS_1000DPS, GFS_2000DPS
-static uint8_t Mscale = MFS_16BITS; // MFS_14BITS or MFS_16BITS, 14-bit or 16-bit magnetometer resolution
-static uint8_t Mmode = 0x06;        // Either 8 Hz 0x02) or 100 Hz (0x06) magnetometer data ODR
+//Default Selection, overided with the MPU9250_xSCALE macros
+static const uint8_t Ascale = MPU9250_ASCALE; // AFS_2G, AFS_4G, AFS_8G, AFS_16G
+static const uint8_t Gscale = MPU9250_GSCALE; // GFS_250DPS, GFS_500DPS, GFS_1000DPS, GFS_2000DPS
+static const uint8_t Mscale = MPU9250_MSCALE; // MFS_14BITS or MFS_16BITS, 14-bit or 16-bit magnetometer resolution
+#define AK8963_MMODE 0x06          // Either 8 Hz 0x02) or 100 Hz (0x06) magnetometer data ODR
 
 float mRes, gRes, aRes;
 
-uint8_t MPU9250_init(MPU9250_Handle_t *imu)
+/*
+ * Per count resolution, indexed by the register field. The scales are fixed at compile time,
+ * so the reads multiply with a constant instead of calling a switch per axis.
+ *
+ * Accel: 16384, 8192, 4096, 2048 LSB/g for +-2, 4, 8, 16 g @refer datasheet pg 9, output in m/s^2
+ * Gyro:  131, 65.5, 32.8, 16.4 LSB/(deg/s) for +-250 .. 2000 dps @refer datasheet pg 8, output in rad/s
+ * Mag:   4912 uT over 8190 (14 bit) or 32760 (16 bit) counts, output in milliGauss
+ */
+static const float aResTable[4] = { g / 16384.0f, g / 8192.0f, g / 4096.0f, g / 2048.0f };
+static const float gResTable[4] = { PI / (180 * 131.0f), PI / (180 * 65.5f), PI / (180 * 32.8f), PI / (180 * 16.4f) };
+static const float mResTable[2] = { 10.0f * 4912.0f / 8190.0f, 10.0f * 4912.0f / 32760.0f };
+
+/*
+ * Axis remap, out[i] = sign[i] * in[axis[i]]. All constant, with the indices unrolled the compiler
+ * folds the sign into the scale and picks the register directly.
+ * The AK8963 has X and Y swapped and Z inverted compared to the accel/gyro @refer datasheet pg 38,
+ * the mag goes through that first and then the mounting.
+ */
+static const uint8_t mountAxis[3] = { MPU9250_MOUNT_AXES };
+static const float mountSign[3] = { MPU9250_MOUNT_SIGNS };
+static const uint8_t magAxis[3] = { 1, 0, 2 };
+static const float magSign[3] = { 1.0f, 1.0f, -1.0f };
+
+static void remap(const int16_t raw[3], float res, float out[3])
 {
+	for(uint8_t i = 0; i < 3; i++) out[i] = raw[mountAxis[i]] * (mountSign[i] * res);
+}
 
-	/* 1.Reset all the sensors*/
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, PWR_MGMT_1, 0x00);
-	HAL_Delay(10); // 1ms delay
+/*
+ * Per body axis mag factor, sign, resolution and the AK8963 sensitivity adjustment folded together
+ * by AK8963_init. ReadMag is one multiply per axis.
+ */
+static float magK[3];
+
+static void remapMag(const int16_t raw[3], float out[3])
+{
+	for(uint8_t i = 0; i < 3; i++) out[i] = raw[magAxis[mountAxis[i]]] * magK[i];
+}
+
+/*
+ * One init step, len registers written from subAddress on in a single burst, len 0 only polls.
+ * With pollMask set, subAddress is read back until (value & pollMask) == pollValue for at most delayMs ms,
+ * otherwise the step waits delayMs after the write.
+ */
+typedef struct
+{
+	uint8_t subAddress;
+	uint8_t len;
+	uint8_t data[5];
+	uint8_t pollMask;
+	uint8_t pollValue;
+	uint8_t delayMs;
+
+}MPU9250_InitStep_t;
+
+static uint8_t runScript(I2C_HandleTypeDef *I2Chandle, uint8_t Address, const MPU9250_InitStep_t *steps, uint8_t count);
+
+/*
+ * The whole MPU side configuration, resolved at compile time from the scale selection macros.
+ * SMPLRT_DIV .. ACCEL_CONFIG2 (0x19 - 0x1D) and INT_PIN_CFG .. INT_ENABLE (0x37 - 0x38) are consecutive
+ * registers and go out as one burst each, no read-modify-write: after reset the other bits are 0.
+ */
+static const MPU9250_InitStep_t initScript[] =
+{
+	/* 0.Wait for the part to answer as a MPU9250 instead of sleeping through the start-up time*/
+	{WHO_AM_I_MPU9250, 0, {0}, 0xFF, 0x71, 100},
+
+	/* 1.Reset all the sensors, H_RESET clears itself when done*/
+	{PWR_MGMT_1, 1, {0x80}, 0x80, 0x00, 100},
 
 	/*2. Power management and Crystal clock settings*/
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, PWR_MGMT_1, 0x01);
-	/*3. Configure the accel and gyro
-	 *   Set the sample rate and bandwidth  as 1KHz and 42 Hz @refer_datasheet pg 15
-	 *   DLPF_CFG = b'11
-	 *   Sample_rate = gyro_output_rate/(1 + SMPLRT_DIV)
-	 */
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, CONFIG, 0x03);
-    	// Using the 200Hz rate
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, SMPLRT_DIV, 0x04);
-
-	/*4.Gyro Scale selection
-	 * 1. Clear the Gyro_config register
-	 * 2. Set the Fchoice = b'11 aka f_choice_b = b'00 and clear the GFS
-	 * 3. Select the gyro scale
-	 *
-	 * 5. Repeat the same sequence for the accel scale selection
-	 */
-	uint8_t rxData;
-
-	//Gyro
-	rxData = readByte(imu->I2Chandle, MPU9250_ADDRESS, GYRO_CONFIG);
-	rxData &= ~(0x02); //celars fchoice
-	rxData &= ~(0x18); //celars GFS
-	rxData |= Gscale << 3;
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, GYRO_CONFIG, rxData);
-
-	//Accel
-	rxData = readByte(imu->I2Chandle, MPU9250_ADDRESS, ACCEL_CONFIG);
-	rxData &= ~(0x18); //celars GFS
-	rxData |= Ascale << 3;
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, ACCEL_CONFIG, rxData);
-
-	/*
-	 * Set accel sample rate @4KHz refer data_sheet pg 17
-	 * Bw = 41Hz
-	 */
-	rxData = readByte(imu->I2Chandle, MPU9250_ADDRESS, ACCEL_CONFIG2);
-	rxData &= ~(0x0F);
-	rxData |= 0x03;
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, ACCEL_CONFIG2, rxData);
+	{PWR_MGMT_1, 1, {0x01}, 0, 0, 0},
 
-	//Originally all the sensor are set to 1KHz, however refacotred using SMPLRT_DIV to 200hz
+	/*3. SMPLRT_DIV, CONFIG (DLPF_CFG) @refer_datasheet pg 15
+	 *4. GYRO_CONFIG, Fchoice = b'11 aka f_choice_b = b'00 and the GFS
+	 *5. ACCEL_CONFIG AFS, ACCEL_CONFIG2 bandwidth @refer data_sheet pg 17
+	 */
+	{SMPLRT_DIV, 5, {MPU9250_SMPLRT_DIV, MPU9250_GYRO_DLPF & 0x07, MPU9250_GSCALE << 3, MPU9250_ASCALE << 3, MPU9250_ACCEL_DLPF & 0x0F}, 0, 0, 0},
 
 	/*6.Configure the interrupt pins
 	 * Interrupt to rasing edge and clears on read
 	 * @refer reference manual  pg 29
 	 */
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, INT_PIN_CFG, 0x22);
-	writeByte(imu->I2Chandle, MPU9250_ADDRESS, INT_ENABLE, 0x01);
+	{INT_PIN_CFG, 2, {0x22, 0x01}, 0, 0, 0},
+};
 
-	/*7.Configure the magnetometer*/
-	AK8963_init(imu->I2Chandle);
+/*
+ * The AK8963 behind the bypass (INT_PIN_CFG BYPASS_EN above), same step format on AK8963_ADDRESS.
+ * Every mode change is read back from CNTL instead of a fixed 1ms, at 100/400KHz the read back takes
+ * longer than the 100us the AK8963 needs between two modes @refer AK8963 datasheet pg 13.
+ */
+#define AK8963_POLL_MS 10
 
-	return 1;
+static const MPU9250_InitStep_t ak8963Script[] =
+{
+	/* 0.Make sure it is an AK8963 that answers*/
+	{AK8963_WHO_AM_I, 0, {0}, 0xFF, 0x48, AK8963_POLL_MS},
+
+	/* 1.Reset the Mag sensor (power down)
+	 * 2.Fuse rom access mode, AK8963_init reads the ASA registers after this step
+	 */
+	{AK8963_CNTL, 1, {0x00}, 0xFF, 0x00, AK8963_POLL_MS},
+	{AK8963_CNTL, 1, {0x0F}, 0xFF, 0x0F, AK8963_POLL_MS},
+};
+
+static const MPU9250_InitStep_t ak8963RunScript[] =
+{
+	/* 3.Power down again, a mode can only be entered from power down*/
+	{AK8963_CNTL, 1, {0x00}, 0xFF, 0x00, AK8963_POLL_MS},
+
+	/* 4.Mscale enable the 16bit resolution mode
+	 *   Enable continous mode data acquisition Mmode = b'0110 @refer data sheet
+	 */
+	{AK8963_CNTL, 1, {(MPU9250_MSCALE << 4) | AK8963_MMODE}, 0xFF, (MPU9250_MSCALE << 4) | AK8963_MMODE, AK8963_POLL_MS},
+};
+
+uint8_t MPU9250_init(MPU9250_Handle_t *imu)
+{
+	/*1-6. Run the init script*/
+	if(!runScript(imu->I2Chandle, MPU9250_ADDRESS, initScript, sizeof(initScript) / sizeof(initScript[0]))) return 0;
+
+	aRes = aResTable[Ascale];
+	gRes = gResTable[Gscale];
+	mRes = mResTable[Mscale];
+
+	/*7.Configure the magnetometer*/
+	return AK8963_init(imu->I2Chandle);
 
 }
 
 
-static void AK8963_init(I2C_HandleTypeDef *I2Chandle)
+static uint8_t AK8963_init(I2C_HandleTypeDef *I2Chandle)
 {
-	/*1.Reset the Mag sensor*/
-	writeByte(I2Chandle, MPU9250_ADDRESS, AK8963_CNTL, 0x00);
-	HAL_Delay(1);
-	/*2.Fuse rom access mode*/
-	writeByte(I2Chandle, MPU9250_ADDRESS, AK8963_CNTL, 0x0F);
-	HAL_Delay(1);
-	/*3.Power doen Magnetometer*/
-	writeByte(I2Chandle, MPU9250_ADDRESS, AK8963_CNTL, 0x00);
-	HAL_Delay(1);
-	/*4.Mscale enable the 16bit resolution mode
-	 *  Enable continous mode data acquisition Mmode = b'0110 @refer data sheet
+	if(!runScript(I2Chandle, AK8963_ADDRESS, ak8963Script, sizeof(ak8963Script) / sizeof(ak8963Script[0]))) return 0;
+
+	/*Factory sensitivity adjustment, only readable in fuse ROM mode. Folded into the mag factors:
+	 *Hadj = H * ((ASA - 128) * 0.5 / 128 + 1) = H * (ASA + 128) / 256 @refer register map pg 53
 	 */
-	writeByte(I2Chandle, MPU9250_ADDRESS, AK8963_CNTL, Mscale << (4 | Mmode));
-	HAL_Delay(1);
+	uint8_t asa[3];
+	if(HAL_I2C_Mem_Read(I2Chandle, AK8963_ADDRESS, AK8963_ASAX, I2C_MEMADD_SIZE_8BIT, asa, 3, MPU9250_I2C_TIMEOUT) != HAL_OK) return 0;
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		const uint8_t axis = magAxis[mountAxis[i]];
+		magK[i] = mountSign[i] * magSign[mountAxis[i]] * mResTable[Mscale] * ((asa[axis] + 128) / 256.0f);
+	}
+
+	return runScript(I2Chandle, AK8963_ADDRESS, ak8963RunScript, sizeof(ak8963RunScript) / sizeof(ak8963RunScript[0]));
+}
+
+/*
+ * Writes and polls the steps in order on Address, returns 0 if a poll timed out.
+ */
+static uint8_t runScript(I2C_HandleTypeDef *I2Chandle, uint8_t Address, const MPU9250_InitStep_t *steps, uint8_t count)
+{
+	for(uint8_t i = 0; i < count; i++)
+	{
+		const MPU9250_InitStep_t *step = &steps[i];
+		if(step->len) writeBytes(I2Chandle, Address, step->subAddress, step->data, step->len);
+
+		if(step->pollMask == 0)
+		{
+			if(step->delayMs) HAL_Delay(step->delayMs);
+			continue;
+		}
+
+		/*A NACK (part still in reset) is not ready, whatever the buffer holds*/
+		uint8_t waited = 0, value = 0;
+		while(!readReg(I2Chandle, Address, step->subAddress, &value) || (value & step->pollMask) != step->pollValue)
+		{
+			if(waited++ >= step->delayMs) return 0;
+			HAL_Delay(1);
+		}
+	}
 
+	return 1;
 }
 
 
@@ -131,10 +228,10 @@ void MPU9250_ReadAccel(MPU9250_Handle_t *imu)
 	int16_t accY = (int16_t)((int16_t)rawdata[2] << 8 | rawdata[3]);
 	int16_t accZ = (int16_t)((int16_t)rawdata[4] << 8 | rawdata[5]);
 
-	imu->acc[0] =  accX * getAres(Ascale);
-	imu->acc[1] =  accY * getAres(Ascale);
-	imu->acc[2] = -accZ * getAres(Ascale);//NED system. Since positive Z axis points down aka fighitng against the gravity, use a negative sign. 
- 	//North, East, Down (NED), used specially in aerospace
+	//Body frame from MPU9250_MOUNT_AXES, NED by default. Positive Z points down aka fighitng against the gravity.
+	//North, East, Down (NED), used specially in aerospace
+	const int16_t acc[3] = {accX, accY, accZ};
+	remap(acc, aResTable[Ascale], imu->acc);
 
 }
 
@@ -147,31 +244,225 @@ void MPU9250_ReadGyro(MPU9250_Handle_t *imu)
 	int16_t gyrY = (int16_t)((int16_t)rawdata[2] << 8 | rawdata[3]);
 	int16_t gyrZ = (int16_t)((int16_t)rawdata[4] << 8 | rawdata[5]);
 
-	imu->gyr[0] =  gyrX * getGres(Gscale);
-	imu->gyr[1] =  gyrY * getGres(Gscale);
-	imu->gyr[2] =  gyrZ * getGres(Gscale);
+	const int16_t gyr[3] = {gyrX, gyrY, gyrZ};
+	remap(gyr, gResTable[Gscale], imu->gyr);
+}
+
+/*
+	Single transaction read of ACCEL_XOUT_H .. GYRO_ZOUT_L (0x3B - 0x48).
+	Accel, temp and gyro are decoded from the same burst so they belong to the same sample.
+	At 100KHz this replaces two 6 byte reads (2 address phases) with one 14 byte read.
+*/
+void MPU9250_ReadMotion(MPU9250_Handle_t *imu)
+{
+	uint8_t rawdata[MPU9250_MOTION_BURST_LEN];
+	HAL_I2C_Mem_Read(imu->I2Chandle, MPU9250_ADDRESS, ACCEL_XOUT_H, I2C_MEMADD_SIZE_8BIT, rawdata, MPU9250_MOTION_BURST_LEN, MPU9250_I2C_TIMEOUT);
+
+	decodeMotion(rawdata, imu);
+}
+
+/*
+	DMA acquisition of the same burst. The transfer goes into the back half of a ping-pong pair,
+	the completion only flips the index and bumps the sequence. The decode happens in MPU9250_GetLatest
+	on the application side, so the interrupt stays short and never writes the handle.
+*/
+static I2C_HandleTypeDef *dmaHandle;
+static uint8_t dmaBuf[2][MPU9250_MOTION_BURST_LEN];
+static volatile uint8_t dmaFront;   // Latest complete burst
+static volatile uint8_t dmaBusy;
+static volatile uint32_t dmaSeq;    // Bumped on every completion
+static uint32_t dmaSeqRead;         // dmaSeq at the last GetLatest
+
+//dmaBuf is written by the DMA, keep the compiler from moving the copy across the dmaSeq reads. No cache on the M4.
+#define DMA_BARRIER() __ASM volatile ("" ::: "memory")
+
+uint8_t MPU9250_StartReadDMA(MPU9250_Handle_t *imu)
+{
+	if(dmaBusy) return 0;
+
+	dmaHandle = imu->I2Chandle;
+	dmaBusy = 1;
+
+	if(HAL_I2C_Mem_Read_DMA(imu->I2Chandle, MPU9250_ADDRESS, ACCEL_XOUT_H, I2C_MEMADD_SIZE_8BIT, dmaBuf[dmaFront ^ 1], MPU9250_MOTION_BURST_LEN) != HAL_OK)
+	{
+		dmaBusy = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+uint8_t MPU9250_GetLatest(MPU9250_Handle_t *imu)
+{
+	uint8_t rawdata[MPU9250_MOTION_BURST_LEN];
+	uint32_t seq;
+
+	/*Retry if a completion landed during the copy, the transfer after it may reuse that buffer*/
+	do
+	{
+		seq = dmaSeq;
+		DMA_BARRIER();
+		memcpy(rawdata, dmaBuf[dmaFront], MPU9250_MOTION_BURST_LEN);
+		DMA_BARRIER();
+	} while(seq != dmaSeq);
+
+	if(seq == dmaSeqRead) return 0;
+	dmaSeqRead = seq;
+
+	decodeMotion(rawdata, imu);
+	return 1;
+}
+
+/*
+	Data ready, the EXTI callback starts the DMA burst.
+*/
+static MPU9250_Handle_t *irqImu;
+static uint16_t irqPin;
+static volatile uint32_t dropped;
+static volatile uint8_t deferred;   // An edge came in during the burst, read once it completes
+
+/*
+	The latched INT only drops on a read, so a burst that cannot start still has to read the part,
+	otherwise there is no further edge and the acquisition stops.
+*/
+static void irqRead(void)
+{
+	if(MPU9250_StartReadDMA(irqImu)) return;
+
+	dropped++;
+	readByte(irqImu->I2Chandle, MPU9250_ADDRESS, INT_STATUS);
+}
+
+void MPU9250_OnDMAComplete(I2C_HandleTypeDef *hi2c)
+{
+	if(hi2c != dmaHandle || !dmaBusy) return;
+
+	dmaFront ^= 1;
+	dmaSeq++;
+	dmaBusy = 0;
+
+	if(irqImu != NULL && deferred)
+	{
+		deferred = 0;
+		irqRead();
+	}
+}
+
+void MPU9250_OnDMAError(I2C_HandleTypeDef *hi2c)
+{
+	if(hi2c != dmaHandle || !dmaBusy) return;
+
+	dmaBusy = 0;
+	if(irqImu == NULL) return;
+
+	/*Whether the failed burst got far enough to clear the latch is unknown, make sure*/
+	dropped += deferred ? 2 : 1;
+	deferred = 0;
+	readByte(irqImu->I2Chandle, MPU9250_ADDRESS, INT_STATUS);
+}
+
+void MPU9250_EnableDataReadyIRQ(MPU9250_Handle_t *imu, uint16_t intPin)
+{
+	irqImu = imu;
+	irqPin = intPin;
+	dropped = 0;
+	deferred = 0;
+
+	/*Latched, active high, cleared by the motion burst itself @refer register map pg 29*/
+	writeByte(imu->I2Chandle, MPU9250_ADDRESS, INT_PIN_CFG, INT_LATCH_EN | INT_ANYRD_2CLEAR | INT_BYPASS_EN);
+	writeByte(imu->I2Chandle, MPU9250_ADDRESS, INT_ENABLE, 0x01);
+
+	/*Clear whatever is latched so the next sample produces an edge*/
+	readByte(imu->I2Chandle, MPU9250_ADDRESS, INT_STATUS);
+}
+
+void MPU9250_DisableDataReadyIRQ(void)
+{
+	MPU9250_Handle_t *imu = irqImu;
+	if(imu == NULL) return;
+
+	irqImu = NULL;
+	writeByte(imu->I2Chandle, MPU9250_ADDRESS, INT_PIN_CFG, INT_LATCH_EN | INT_BYPASS_EN);
+}
+
+void MPU9250_OnDataReady(uint16_t GPIO_Pin)
+{
+	if(irqImu == NULL || GPIO_Pin != irqPin) return;
+
+	/*The data registers only hold the newest sample, an older deferred edge is lost*/
+	if(dmaBusy)
+	{
+		if(deferred) dropped++;
+		deferred = 1;
+		return;
+	}
+
+	irqRead();
+}
+
+uint32_t MPU9250_DroppedSamples(void)
+{
+	return dropped;
+}
+
+#ifndef MPU9250_NO_HAL_CALLBACKS
+/*Overrides of the weak HAL callbacks*/
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	MPU9250_OnDMAComplete(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	MPU9250_OnDMAError(hi2c);
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	MPU9250_OnDataReady(GPIO_Pin);
+}
+#endif
+
+static void decodeMotion(const uint8_t *rawdata, MPU9250_Handle_t *imu)
+{
+	int16_t accX = (int16_t)((int16_t)rawdata[0] << 8 | rawdata[1]);
+	int16_t accY = (int16_t)((int16_t)rawdata[2] << 8 | rawdata[3]);
+	int16_t accZ = (int16_t)((int16_t)rawdata[4] << 8 | rawdata[5]);
+
+	int16_t tempRaw = (int16_t)((int16_t)rawdata[6] << 8 | rawdata[7]);
+
+	int16_t gyrX = (int16_t)((int16_t)rawdata[8] << 8 | rawdata[9]);
+	int16_t gyrY = (int16_t)((int16_t)rawdata[10] << 8 | rawdata[11]);
+	int16_t gyrZ = (int16_t)((int16_t)rawdata[12] << 8 | rawdata[13]);
+
+	const int16_t acc[3] = {accX, accY, accZ};
+	remap(acc, aResTable[Ascale], imu->acc); //Body frame, same as MPU9250_ReadAccel
+
+	imu->temp = (tempRaw / TEMP_SENSITIVITY) + TEMP_ROOM_OFFSET;
+
+	const int16_t gyr[3] = {gyrX, gyrY, gyrZ};
+	remap(gyr, gResTable[Gscale], imu->gyr);
 }
 
 void MPU9250_ReadMag(MPU9250_Handle_t *imu)
 {
 	uint8_t rawdata[6];
 	/*Wait for Mag to be ready*/
-	if(readByte(imu->I2Chandle, MPU9250_ADDRESS, AK8963_ST1) & 0x01)
+	if(readByte(imu->I2Chandle, AK8963_ADDRESS, AK8963_ST1) & 0x01)
 	{
-		HAL_I2C_Mem_Read(imu->I2Chandle, MPU9250_ADDRESS, AK8963_XOUT_L, I2C_MEMADD_SIZE_8BIT, rawdata, 3, MPU9250_I2C_TIMEOUT);
-		/*Check the Overflow flag in the SR of AK8963
-		 * wait until it gets cleared
+		HAL_I2C_Mem_Read(imu->I2Chandle, AK8963_ADDRESS, AK8963_XOUT_L, I2C_MEMADD_SIZE_8BIT, rawdata, 6, MPU9250_I2C_TIMEOUT);
+		/*Check the Overflow flag in the SR of AK8963, reading ST2 also releases the data latch
+		 * an overflowed sample is dropped
 		 * refer @ reference manual pg 50*/
-		if( readByte(imu->I2Chandle, MPU9250_ADDRESS, AK8963_ST2) & 0x08)
+		if(!(readByte(imu->I2Chandle, AK8963_ADDRESS, AK8963_ST2) & 0x08))
 		{
 
 			int16_t magX = (int16_t)((int16_t)rawdata[1] << 8 | rawdata[0]);
 			int16_t magY = (int16_t)((int16_t)rawdata[3] << 8 | rawdata[2]);
 			int16_t magZ = (int16_t)((int16_t)rawdata[5] << 8 | rawdata[4]);
 
-			imu->mag[0] =  magX * getMres(Mscale);
-			imu->mag[1] =  magY * getMres(Mscale);
-			imu->mag[2] =  magZ * getMres(Mscale);
+			const int16_t mag[3] = {magX, magY, magZ};
+			remapMag(mag, imu->mag);
 
 		}
 	}
@@ -190,104 +481,57 @@ void MPU9250_Reset(MPU9250_Handle_t *imu)
 ////////////////////////////////////////////////////////////////////////{HELPER_FUNCTIONS}////////////////////////////////////////////////////////////////////////////
 
 float getMres(uint8_t Mscale) {
-  switch (Mscale)
-  {
-
-    /*
-     * Possible magnetometer scales (and their register bit settings) are:
-     * Mmode = 14 bit resolution (0) and 16 bit resolution (1)
-     */
-
-    case MFS_14BITS:
-          mRes = 10.0*4912.0/8190.0; // Proper scale to return milliGauss
-          break;
-    case MFS_16BITS:
-          mRes = 10.0*4912.0/32760.0; // Proper scale to return milliGauss
-          break;
-  }
-
-  return mRes;
+  return mResTable[Mscale & 0x01];
 }
 
-
-
 float getGres(uint8_t Gscale) {
-  switch (Gscale)
-  {
-    /*
-     *  Possible gyro scales (and their register bit settings) are:
-     *  250 DPS (00), 500 DPS (01), 1000 DPS (10), and 2000 DPS  (11).
-     *  From the data sheet, divide the raw value with the accurate scale factors to get the Wx, Wy, Wz
-     *  @refer datasheet pg 8
-     *	The output unit is deg/sec
-     *  To get the output in rad/sec for future computation convert deg/s -> rad/s
-     */
-
-    case GFS_250DPS:
-          gRes = PI/ ( 180 * 131);
-          break;
-    case GFS_500DPS:
-          gRes = PI/ (180 * 65.5);
-          break;
-    case GFS_1000DPS:
-          gRes = PI/ (180 * 32.8);
-          break;
-    case GFS_2000DPS:
-          gRes = PI/ (180 * 16.4);
-          break;
-  }
-
-  return gRes;
-
+  return gResTable[Gscale & 0x03];
 }
 
-
 float getAres(uint8_t Ascale) {
-  switch (Ascale)
-  {
-    /*
-     * Possible accelerometer scales (and their register bit settings) are:
-     * 2 Gs (00), 4 Gs (01), 8 Gs (10), and 16 Gs  (11).
-     * From the data sheet, divide the raw value with the accurate scale factors to get the Ax, Ay, Az
-     * @refer datasheet pg 9
-     *
-     * Convert the acceleration value interms of acceleration due to gravity to make sense of the data.
-     */
-
-    case AFS_2G:
-          aRes = g/ 16384.0;
-          break;
-    case AFS_4G:
-          aRes = g/8192;
-          break;
-    case AFS_8G:
-          aRes = g/4096;
-          break;
-    case AFS_16G:
-          aRes = g/2048;
-          break;
-  }
-
-  return aRes;
+  return aResTable[Ascale & 0x03];
 }
 
 static void writeByte(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress, uint8_t data)
 {
 
 	 uint8_t txData[] = {subAddress, data};
-	 HAL_I2C_Master_Transmit(I2Chandle, MPU9250_ADDRESS, txData, 2, MPU9250_I2C_TIMEOUT);
+	 HAL_I2C_Master_Transmit(I2Chandle, Address, txData, 2, MPU9250_I2C_TIMEOUT);
 
 }
 
+static void writeBytes(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress, const uint8_t *data, uint16_t len)
+{
+	HAL_I2C_Mem_Write(I2Chandle, Address, subAddress, I2C_MEMADD_SIZE_8BIT, (uint8_t *)data, len, MPU9250_I2C_TIMEOUT);
+}
+
+/*
+ * Single register read, 0 if the bus failed.
+ */
 static uint8_t readByte(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress)
 {
-	uint8_t rxData[1];
-	uint8_t txData[] = {subAddress};
-	HAL_I2C_Master_Transmit(I2Chandle, MPU9250_ADDRESS, txData, 1, MPU9250_I2C_TIMEOUT);
+	uint8_t rxData = 0;
+	readReg(I2Chandle, Address, subAddress, &rxData);
 
-	HAL_I2C_Master_Receive(I2Chandle, MPU9250_ADDRESS, rxData, 1, MPU9250_I2C_TIMEOUT);
+	return rxData;
 
-	return rxData[0];
+}
 
+/*
+ * Single register read, returns 0 and leaves *data at 0 if either transfer failed.
+ */
+static uint8_t readReg(I2C_HandleTypeDef *I2Chandle, uint8_t Address, uint8_t subAddress, uint8_t *data)
+{
+	uint8_t txData[] = {subAddress};
+	*data = 0;
+	if(HAL_I2C_Master_Transmit(I2Chandle, Address, txData, 1, MPU9250_I2C_TIMEOUT) != HAL_OK) return 0;
+
+	if(HAL_I2C_Master_Receive(I2Chandle, Address, data, 1, MPU9250_I2C_TIMEOUT) != HAL_OK)
+	{
+		*data = 0;
+		return 0;
+	}
+
+	return 1;
 }
 
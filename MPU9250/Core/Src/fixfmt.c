@@ -0,0 +1,116 @@
+/*
+ * fixfmt.c
+ *
+ *  Fixed decimal formatting without newlib's float printf.
+ */
+#include <string.h>
+
+#include "fixfmt.h"
+
+static const uint16_t pow10[FIXFMT_MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000};
+
+uint8_t fixfmt_str(char *out, const char *s)
+{
+	uint8_t n = 0;
+
+	while(s[n])
+	{
+		out[n] = s[n];
+		n++;
+	}
+
+	return n;
+}
+
+uint8_t fixfmt_float(char *out, float x, uint8_t decimals)
+{
+	char digits[10];
+	uint8_t len = 0, n = 0;
+	uint32_t bits, ip = 0, fp = 0;
+
+	if(decimals > FIXFMT_MAX_DECIMALS) decimals = FIXFMT_MAX_DECIMALS;
+
+	memcpy(&bits, &x, sizeof(bits));
+	if(bits & 0x80000000u) out[n++] = '-';
+
+	/*x = m * 2^e exactly, the hidden bit is set unless x is subnormal*/
+	const uint32_t biased = (bits >> 23) & 0xFF, man = bits & 0x7FFFFFu;
+	if(biased == 0xFF) return (uint8_t)(n + fixfmt_str(&out[n], man ? "nan" : "inf"));
+
+	const uint32_t m = biased ? (man | 0x800000u) : man;
+	const int16_t e = (int16_t)(biased ? biased : 1) - 150;
+
+	if(e > 8)
+	{
+		ip = 0xFFFFFFFFu;		/*2^32 and up saturates*/
+	}
+	else if(e >= 0)
+	{
+		ip = m << e;
+	}
+	else if(e > -40)
+	{
+		/*Fraction bits times 10^decimals, the bits below the last decimal round it. Below 2^-39 the
+		 *value is under half of 10^-4 and everything stays 0*/
+		const uint8_t s = (uint8_t)-e;
+		const uint32_t f = s < 32 ? m & ((1u << s) - 1) : m;
+		const uint64_t scaled = (uint64_t)f * pow10[decimals];
+		const uint64_t rest = scaled & ((1ull << s) - 1), half = 1ull << (s - 1);
+
+		ip = s < 32 ? m >> s : 0;
+		fp = (uint32_t)(scaled >> s);
+
+		/*Nearest, an exact tie to even as printf does*/
+		if(rest > half || (rest == half && ((decimals ? fp : ip) & 1))) fp++;
+		if(fp >= pow10[decimals])
+		{
+			fp -= pow10[decimals];
+			ip++;
+		}
+	}
+
+	/*Least significant first*/
+	do
+	{
+		digits[len++] = (char)('0' + ip % 10);
+		ip /= 10;
+	}while(ip);
+
+	while(len) out[n++] = digits[--len];
+
+	if(decimals)
+	{
+		out[n++] = '.';
+		for(uint8_t i = decimals; i > 0; i--)
+		{
+			out[n + i - 1] = (char)('0' + fp % 10);
+			fp /= 10;
+		}
+		n += decimals;
+	}
+
+	return n;
+}
+
+uint8_t fixfmt_axes(char *out, const float v[3], const char *unit, uint8_t decimals)
+{
+	static const char axis[3] = {'X', 'Y', 'Z'};
+	uint8_t n = 0;
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		if(i)
+		{
+			out[n++] = ',';
+			out[n++] = ' ';
+		}
+		out[n++] = axis[i];
+		out[n++] = ':';
+		out[n++] = ' ';
+		n += fixfmt_float(&out[n], v[i], decimals);
+		out[n++] = ' ';
+		n += fixfmt_str(&out[n], unit);
+	}
+
+	return n;
+}
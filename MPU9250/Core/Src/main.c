@@ -23,8 +23,8 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "MPU9250.h"
+#include "fixfmt.h"
 /* USER CODE END Includes */
-#include "stdio.h"
 #include "String.h"
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN PTD */
@@ -47,6 +47,7 @@ UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
 MPU9250_Handle_t imu;
+DMA_HandleTypeDef hdma_i2c1_rx;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -55,6 +56,8 @@ static void MX_GPIO_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_I2C1_Init(void);
 /* USER CODE BEGIN PFP */
+static void MX_DMA_Init(void);
+static void MX_MPU_INT_Init(void);
 
 /* USER CODE END PFP */
 
@@ -70,7 +73,9 @@ static void MX_I2C1_Init(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
-	uint8_t buf[64];
+	char buf[96]; // "ACCEL:: " and 3 axes of at most FIXFMT_FLOAT_MAX_LEN digits, < 80 characters
+	char *p;
+	uint32_t lastPrint = 0;
 
 	memset(buf, 0, sizeof(buf));
   /* USER CODE END 1 */
@@ -88,6 +93,7 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  MX_DMA_Init(); // DMA clock must be running before HAL_I2C_MspInit links the I2C1_RX stream
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -95,24 +101,34 @@ int main(void)
   MX_USART2_UART_Init();
   MX_I2C1_Init();
   /* USER CODE BEGIN 2 */
+  MX_MPU_INT_Init();
   imu.I2Chandle = &hi2c1;
   if(MPU9250_init(&imu) == 0)
   {
 	  Error_Handler();
   }
+  MPU9250_EnableDataReadyIRQ(&imu, MPU_INT_Pin); // Every sample (200Hz) is read by DMA from here on
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
   while (1)
   {
-
-    MPU9250_ReadAccel(&imu);MPU9250_ReadGyro(&imu);MPU9250_ReadMag(&imu);
-    sprintf((char*)buf, "ACCEL:: X: %.2f g, Y: %.2f g, Z: %.2f g C\r\n", imu.acc[0], imu.acc[1], imu.acc[2]);
-    HAL_UART_Transmit(&huart2, buf, sizeof(buf), HAL_MAX_DELAY);
-    HAL_Delay(2000);
-    //sprintf(buf, "GYRO:: X: %.2f , Y: %.2f , Z: %.2f  C\r\n", imu.gyr[0], imu.gyr[1], imu.gyr[2]);
-    //HAL_UART_Transmit(&huart2, (uint8_t*)buf, sizeof(buf), HAL_MAX_DELAY);
+    /*The data ready EXTI starts the burst on DMA1 Stream0, the CPU only sees the interrupts*/
+    if((HAL_GetTick() - lastPrint) >= SAMPLE_TIME_COM_MS && MPU9250_GetLatest(&imu))
+    {
+      lastPrint = HAL_GetTick();
+      p = buf;
+      p += fixfmt_str(p, "ACCEL:: ");
+      p += fixfmt_axes(p, imu.acc, "g", 2);
+      p += fixfmt_str(p, " C\r\n");
+      HAL_UART_Transmit(&huart2, (uint8_t*)buf, (uint16_t)(p - buf), HAL_MAX_DELAY);
+    }
+    //p = buf;
+    //p += fixfmt_str(p, "GYRO:: ");
+    //p += fixfmt_axes(p, imu.gyr, "rad/s", 2);
+    //p += fixfmt_str(p, "\r\n");
+    //HAL_UART_Transmit(&huart2, (uint8_t*)buf, (uint16_t)(p - buf), HAL_MAX_DELAY);
     //HAL_Delay(2000);
   }
 
@@ -241,6 +257,40 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief DMA Initialization Function
+  *        I2C1_RX -> DMA1 Stream0 Channel1, the stream itself is configured in HAL_I2C_MspInit
+  * @param None
+  * @retval None
+  */
+static void MX_DMA_Init(void)
+{
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+}
+
+/**
+  * @brief MPU9250 data ready interrupt line
+  *        INT is push-pull active high (INT_PIN_CFG ACTL = 0) so trigger on the rising edge
+  * @param None
+  * @retval None
+  */
+static void MX_MPU_INT_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+
+  GPIO_InitStruct.Pin = MPU_INT_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  HAL_GPIO_Init(MPU_INT_GPIO_Port, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(MPU_INT_EXTI_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(MPU_INT_EXTI_IRQn);
+}
 
 /* USER CODE END 4 */
 
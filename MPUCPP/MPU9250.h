@@ -9,26 +9,43 @@
 #define MPU9250_H_
 
 
+#ifdef USE_HAL_DRIVER
 #include "main.h"
+#endif
 
 #include <math.h>
 #include <stdint.h>
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+/*
+ * MPU9250_NO_HEAP: the driver never allocates, throws or uses RTTI, this makes the build prove it.
+ * Define it together with -fno-exceptions -fno-rtti, every buffer is then a member sized by the
+ * template parameters and a static instance does not register a destructor with atexit.
+ * MPU9250_RAM_BUDGET: bytes one driver instance may take, every instantiation that does not fit fails
+ * to compile with its size and the budget in the error (detail::RamBudget<size, budget>).
+ */
+#if defined(MPU9250_NO_HEAP) && (defined(__cpp_exceptions) || defined(__GXX_RTTI))
+#error "MPU9250_NO_HEAP needs -fno-exceptions -fno-rtti"
+#endif
 
 /*
  * Math Macros
  */
 
-#define PI 				3.142857f
+#define PI 				3.14159265358979f
 #define PHY_g  		    9.80665f
-#define Deg2Rad 		(180/PI)
-#define Rad2Deg 		(PI/180)
+#define Deg2Rad 		(PI/180)
+#define Rad2Deg 		(180/PI)
 
 /*
  * Register defination
  */
 
 //Magnetometer Registers
-#define AK8963_ADDRESS   0x0C << 1
+#define AK8963_ADDRESS   (0x0C << 1)
+#define AK8963_ADDRESS_7BIT 0x0C // as written to I2C_SLVx_ADDR
 #define AK8963_WHO_AM_I  0x00 // should return 0x48
 #define AK8963_INFO      0x01
 #define AK8963_ST1       0x02  // data ready status bit 0
@@ -107,6 +124,10 @@
 #define GYRO_ZOUT_H      0x47
 #define GYRO_ZOUT_L      0x48
 
+//External sensor data, filled by the internal I2C master
+#define EXT_SENS_DATA_00 0x49
+#define EXT_SENS_DATA_23 0x60
+
 //I2C slave
 #define I2C_SLV0_DO      0x63
 #define I2C_SLV1_DO      0x64
@@ -147,6 +168,56 @@
 #endif
 
 #define MPU9250_I2C_TIMEOUT 100
+#define MPU9250_SPI_TIMEOUT 10
+
+//SPI framing @refer datasheet pg 32, bit 7 of the first byte selects read
+#define MPU9250_SPI_READ      0x80
+#define USER_CTRL_I2C_IF_DIS  0x10  // Must be set in SPI mode
+
+//Burst length of ACCEL_XOUT_H .. GYRO_ZOUT_L (accel 6 + temp 2 + gyro 6)
+#define MPU9250_MOTION_BURST_LEN 14
+
+//Die temperature conversion @refer register map pg 33
+#define TEMP_SENSITIVITY 333.87f
+#define TEMP_ROOM_OFFSET 21.0f
+
+//FIFO configuration @refer register map pg 16, 27, 29
+#define MPU9250_FIFO_SIZE     512
+#define FIFO_EN_TEMP          0x80
+#define FIFO_EN_GYRO          0x70  // GYRO_XOUT, GYRO_YOUT, GYRO_ZOUT
+#define FIFO_EN_ACCEL         0x08
+#define USER_CTRL_FIFO_EN     0x40
+#define USER_CTRL_FIFO_RST    0x04
+#define INT_FIFO_OFLOW        0x10  // Same bit in INT_ENABLE and INT_STATUS
+
+//Cold start @refer register map pg 40, 42
+#define MPU9250_WHO_AM_I_VALUE 0x71
+#define AK8963_WHO_AM_I_VALUE  0x48
+#define PWR_MGMT_1_H_RESET     0x80  // Self clearing once the reset is done
+#define PWR_MGMT_1_CLKSEL_PLL  0x01
+#define INT_RAW_DATA_RDY       0x01
+#define I2C_SLV4_READ          0x80  // Bit 7 of I2C_SLV4_ADDR
+#define MPU9250_BOOT_TIMEOUT_MS 100  // Worst case start-up time, only reached when something is wrong
+
+//Register shadow, SMPLRT_DIV .. INT_ENABLE is kept write-through in the driver
+#define MPU9250_SHADOW_BASE   SMPLRT_DIV
+#define MPU9250_SHADOW_LEN    (INT_ENABLE - SMPLRT_DIV + 1)
+
+//Data ready interrupt pipeline
+#define INT_PIN_CFG_LATCH_EN  0x20     // INT held until cleared, a 50 us pulse otherwise
+#define INT_PIN_CFG_ANYRD_2CLEAR 0x10  // Latched INT is cleared by any read, so the motion burst re-arms it
+#define MPU9250_SAMPLE_QUEUE_LEN 32    // Default QueueLen, must be a power of 2
+
+//AK8963 behind the internal I2C master @refer register map pg 18 - 23
+#define USER_CTRL_I2C_MST_EN  0x20
+#define INT_PIN_CFG_BYPASS_EN 0x02
+#define I2C_MST_CLK_400KHZ    0x0D
+#define I2C_MST_DELAY_ES_SHADOW 0x80  // EXT_SENS_DATA is updated only once all slaves are read
+#define I2C_SLV_EN            0x80
+#define I2C_SLV_READ          0x80  // Bit 7 of I2C_SLVx_ADDR
+#define I2C_MST_SLV4_DONE     0x40
+#define AK8963_FETCH_LEN      8     // ST1, XOUT_L .. ZOUT_H, ST2
+#define MPU9250_MOTION_MAG_BURST_LEN (MPU9250_MOTION_BURST_LEN + AK8963_FETCH_LEN)
 
 
 //Enums to select the scale and range
@@ -165,20 +236,145 @@ enum class Mscale
 	MFS_14BITS = 8, MFS_16BITS
 };
 
+/*
+ * How the host reaches the AK8963.
+ *
+ * Bypass : INT_PIN_CFG BYPASS_EN, the host talks to AK8963_ADDRESS directly (3 transactions per mag read).
+ * Master : the MPU's internal I2C master fetches ST1..ST2 into EXT_SENS_DATA every sample, so the
+ *          burst from ACCEL_XOUT_H returns accel, temp, gyro and mag in one time aligned read.
+ */
+enum class MagMode
+{
+	Bypass = 0, Master
+};
+
+//Sensitivity tables, init script, transport policies and the fixed point types, they need the register map and enums above
+#include "MPU9250_Scale.h"
+#include "MPU9250_Orient.h"
+#include "MPU9250_Init.h"
+#include "MPU9250_Transport.h"
+#include "MPU9250_Fixed.h"
+#include "MPU9250_Batch.h"
+
 
 namespace IMU {
 
-class MPU9250 final {
+/*
+ * One decoded accel/gyro(/temp) sample, the value type every read hands out (FIFO drain, DMA, queue, ReadSample).
+ * Trivially copyable and word aligned, pass it by value or memcpy it between consumers.
+ */
+template<typename Real>
+struct alignas(4) MotionSampleT
+{
+	Real acc[3];      /*3 axis accel*/
+	Real gyr[3];	  /*3 axis gyro*/
+	Real temp;	 	  /*die temperature in degC, 0 when temp is not streamed*/
+	uint32_t stamp;	  /*Bus::ticks() taken in the data ready ISR or by ReadSample, 0 otherwise*/
+	Real mag[3];	  /*3 axis mag, only filled in MagMode::Master, otherwise 0*/
+};
+
+using MotionSample = MotionSampleT<float>;
+using ImuSample = MotionSample;
+
+static_assert(std::is_trivially_copyable<MotionSample>::value && std::is_trivially_copyable<MotionSampleT<fixed::Q16>>::value,
+			  "samples are copied with memcpy through the queues");
+static_assert(alignof(MotionSample) == 4 && sizeof(MotionSample) == 44, "sample layout changed");
+
+/*
+ * State of the asynchronous DMA acquisition.
+ */
+enum class DMAState : uint8_t
+{
+	Idle = 0, Busy, Error
+};
+
+namespace detail {
+
+/*
+ * The HAL callbacks are plain C functions, this is what they forward to.
+ * Registered by StartReadDMA / EnableDataReadyIRQ of whichever driver instance owns the interrupts.
+ */
+struct IrqHook
+{
+	void *owner;
+	void (*rxComplete)(void *owner, const void *handle);
+	void (*rxError)(void *owner, const void *handle);
+	void (*dataReady)(void *owner, uint16_t GPIO_Pin, uint32_t stamp);
+};
+
+extern IrqHook irqHook;
+
+/*
+ * Instantiated with sizeof the driver, the compiler names both numbers when it does not fit.
+ */
+template<unsigned int Bytes, unsigned int Budget>
+struct RamBudget
+{
+	static_assert(Bytes <= Budget, "driver instance exceeds MPU9250_RAM_BUDGET");
+	static constexpr bool ok = true;
+};
+
+} /* namespace detail */
+
+
+/*
+ * MPU9250 driver over a compile time transport policy (see MPU9250_Transport.h).
+ *
+ * All bus access is a direct, inlinable call into Bus, there is no virtual dispatch anywhere in the
+ * sample path. The member functions are defined in MPU9250_Impl.h, included at the end of this header,
+ * so any transport, mounting and buffer size instantiates where it is used.
+ *
+ * Real is the type of the converted samples. The Cortex-M4F FPU is single precision only, a double
+ * there goes through the soft float library on every multiply, so float is the default.
+ * fixed::Q16 keeps the whole acquisition path in integer arithmetic (see MPU9250_Fixed.h).
+ *
+ * Mount is the board mounting (see MPU9250_Orient.h), every sample comes out in its body frame,
+ * mag included. SensorFrame by default, i.e. the accel/gyro axes of the chip.
+ *
+ * QueueLen is the depth of the data ready queue in samples (power of 2), FifoBytes the FIFO drain
+ * buffer (ReadFIFO returns at most FifoBytes / frame size samples per call). These two are most of
+ * the RAM of an instance, sizeof(MPU9250T) is all of it.
+ */
+template<class Bus, typename Real = float, class Mount = SensorFrame, uint16_t QueueLen = MPU9250_SAMPLE_QUEUE_LEN, uint16_t FifoBytes = MPU9250_FIFO_SIZE>
+class MPU9250T final {
+
+	static_assert(determinant(Mount::axes) == 1, "Mount::axes must be a rotation");
+
+	static_assert(QueueLen >= 2 && (QueueLen & (QueueLen - 1)) == 0, "QueueLen must be a power of 2");
+	static_assert(FifoBytes >= 14 && FifoBytes <= MPU9250_FIFO_SIZE, "FifoBytes must hold a frame and not exceed the FIFO");
 
 public:
 
-	MPU9250(I2C_HandleTypeDef &hi2c);
+	using Sample = MotionSampleT<Real>;
+	using Traits = ScalarTraits<Real>;
+	using Scale = typename Traits::Scale;
 
-	virtual ~MPU9250();
+	/*
+	 * The bus is taken by value, a move only bus (LinuxI2CBus) is moved in.
+	 */
+	MPU9250T(Bus bus, MagMode magMode = Bus::isSPI ? MagMode::Master : MagMode::Bypass);
 
-	MPU9250(const MPU9250 &other); //Copy constructor
+	/*
+	 * Unregisters the IRQ hook if this instance holds it, a late interrupt then finds no owner instead
+	 * of a dead driver. With MPU9250_NO_HEAP the instances are static and never destroyed, the
+	 * destructor stays trivial there (no atexit registration).
+	 */
+#ifdef MPU9250_NO_HEAP
+	~MPU9250T() = default;
+#else
+	~MPU9250T();
+#endif
 
-	MPU9250& operator=(const MPU9250 &other); //Assignment operator overload
+	/*
+	 * One driver per device, owned by the application. It can not be copied or moved: the IRQ hook and
+	 * an in flight DMA transfer hold its address, and the bus handle stays the application's (a LinuxI2CBus
+	 * moves in and is closed with the driver).
+	 * Share the data by value instead, see Snapshot/ReadSample.
+	 */
+	MPU9250T(const MPU9250T &) = delete;
+	MPU9250T& operator=(const MPU9250T &) = delete;
+	MPU9250T(MPU9250T &&) = delete;
+	MPU9250T& operator=(MPU9250T &&) = delete;
 
 
 	//API calls
@@ -189,53 +385,373 @@ public:
 	 * Initializes the  Gyro_init, Accel_init and Mag_init.
 	 *
 	 * Mag_init is called inside the init api.
+	 * In MagMode::Master AK8963_Init also sets up SLV0 to auto fetch the mag into EXT_SENS_DATA.
+	 *
+	 * Nothing sleeps for a fixed time, every step polls for its own completion: WHO_AM_I (0x71),
+	 * the PWR_MGMT_1 reset bit, AK8963_WHO_AM_I (0x48), the AK8963 mode changes and finally the
+	 * first RAW_DATA_RDY. StartupTicks() then holds the time from entry to that first valid sample.
 	 *
-	 * Returns true if successful.
+	 * Returns true if successful, false if a part did not identify or a poll timed out.
 	 *
 	 */
-	bool Init(const MPU9250 &imu);
-	void AK8963_Init(I2C_HandleTypeDef& hi2c);  //Mag_init
+	bool Init();
+	bool AK8963_Init();  //Mag_init
+
+	/*
+	 * Bus::ticks() from the start of Init to the first valid sample, 0 if Init failed.
+	 */
+	uint32_t StartupTicks() const { return startupTicks; }
+
+	/*
+	 * Runs a compile time generated init script (see MPU9250_Init.h) and takes the scales from its options.
+	 * The script resets the part, so the shadow is synced and AK8963_Init runs again after it, with the
+	 * mag scale of the options in CNTL. Init runs the one for MPU9250_DEFAULT_INIT.
+	 * Returns false for a script generated for another magMode or bus (options.spi), if a poll step
+	 * timed out or the AK8963 did not come up.
+	 */
+	bool RunInitScript(const InitScript &script);
 
 	/*
-	 * Reads the Accel, Gyro, Mag via the I2c interface.
+	 * Reads the Accel, Gyro, Mag via the bus.
 	 *
 	 * Gives the data to the global private buffers respectively.
+	 * ReadMag returns false and keeps the previous mag when the AK8963 has no new (or an overflowed) sample.
 	 */
-	void ReadAccel(MPU9250 &imu);
-	void ReadGyro(MPU9250 &imu);
-	void ReadMag(MPU9250 &imu);
+	void ReadAccel(MPU9250T &imu);
+	void ReadGyro(MPU9250T &imu);
+	bool ReadMag(MPU9250T &imu);
 
+	/*
+	 * Reads ACCEL_XOUT_H through GYRO_ZOUT_L (0x3B - 0x48) in a single 14 byte burst.
+	 *
+	 * Accel, die temperature and gyro are decoded from the same buffer so all three
+	 * belong to the same sample. One address phase instead of two separate 6 byte reads.
+	 * In MagMode::Master the burst is extended over EXT_SENS_DATA (22 bytes) and the mag is
+	 * updated from it as well.
+	 */
+	void ReadAll(MPU9250T &imu);
 
-public:
+	/*
+	 * Snapshot is the result of the last ReadAccel/ReadGyro/ReadMag/ReadAll as a value, stamp 0.
+	 * ReadSample does a ReadAll and returns it stamped with Bus::ticks() at the start of the burst.
+	 */
+	Sample Snapshot() const;
+	Sample ReadSample();
+
+	/*
+	 * FIFO streaming mode.
+	 *
+	 * EnableFIFO resets the 512 byte FIFO and streams accel + gyro (and optionally temp) into it
+	 * at the configured sample rate. The application then only needs to call ReadFIFO every
+	 * few ms, it reads FIFO_COUNT, drains all the complete frames in one burst from FIFO_R_W
+	 * and decodes them into batch[] in the order they were sampled.
+	 *
+	 * Returns the number of samples written to batch (at most maxSamples).
+	 * On FIFO overflow the FIFO is reset, nothing is returned and FIFOOverflowed() reports true
+	 * until the next successful drain.
+	 */
+	void EnableFIFO(bool withTemp);
+	void DisableFIFO();
+	uint16_t ReadFIFO(Sample *batch, uint16_t maxSamples);
+	bool FIFOOverflowed() const { return fifoOverflow; }
+
+	/*
+	 * Same drain, decoded column wise into out (see MPU9250_Batch.h), each column needs room for maxSamples.
+	 * GetConversion is the current scale and calibration as used by the decode, e.g. for reprocessing
+	 * recorded FIFO data offline with batch::decode.
+	 */
+	uint16_t ReadFIFO(const batch::Columns<Real> &out, uint16_t maxSamples);
+	batch::Conversion<Real, Scale> GetConversion() const;
+
+	/*
+	 * Acquisition straight into a SampleBatch, as many samples as it has space for.
+	 * ReadFIFO drains the FIFO into its columns, PopSamples moves the data ready queue over.
+	 * Returns the number of samples appended.
+	 */
+	template<uint16_t N>
+	uint16_t ReadFIFO(batch::SampleBatch<Real, N> &out)
+	{
+		const uint8_t flags = batch::SAMPLE_FIFO | (fifoFrameSize == 14 ? batch::SAMPLE_TEMP : 0);
+		const bool gap = fifoOverflow;
+		const uint16_t first = out.count;
+
+		uint16_t frames = ReadFIFO(out.tail(), out.space());
+		if(frames)
+		{
+			out.commit(frames, bus.ticks(), flags);
+			if(gap) out.flags[first] |= batch::SAMPLE_GAP;
+		}
+
+		return frames;
+	}
+
+	template<uint16_t N>
+	uint16_t PopSamples(batch::SampleBatch<Real, N> &out)
+	{
+		const uint8_t flags = batch::SAMPLE_TEMP | (magMode == MagMode::Master ? batch::SAMPLE_MAG : 0);
+		uint16_t n = 0;
+
+		while(out.space() && qTail != qHead)
+		{
+			std::atomic_signal_fence(std::memory_order_acquire);
+			out.push(queue[qTail], flags);
+			std::atomic_signal_fence(std::memory_order_release);
+			qTail = (qTail + 1) & (QueueLen - 1);
+			n++;
+		}
+
+		return n;
+	}
+
+	/*
+	 * Non blocking acquisition, only on transports with Bus::hasAsync (I2CDMABus), false otherwise.
+	 *
+	 * StartReadDMA kicks off the motion burst and returns immediately (false if a transfer
+	 * is still in flight or the HAL refused it). On completion HAL_I2C_MemRxCpltCallback calls
+	 * OnDMAComplete which decodes into the back buffer of a ping-pong pair and publishes it.
+	 *
+	 * GetLatest copies the most recent complete sample without tearing and returns true if it is
+	 * newer than the one handed out by the previous call.
+	 *
+	 * The HAL callbacks are defined in MPU9250.cpp, define MPU9250_NO_HAL_CALLBACKS if the
+	 * application provides its own and forward to OnDMAComplete/OnDMAError from there.
+	 */
+	bool StartReadDMA();
+	void OnDMAComplete();
+	void OnDMAError();
+	bool GetLatest(Sample &out);
+	DMAState GetDMAState() const { return dmaState; }
+
+	/*
+	 * Data ready interrupt driven sampling.
+	 *
+	 * EnableDataReadyIRQ makes INT clear on any read and starts the timestamp counter.
+	 * The EXTI callback calls OnDataReady with the counter captured on entry, which starts the
+	 * DMA burst. The completion callback stamps the decoded sample and pushes it to a single
+	 * producer / single consumer queue that the application drains with PopSample.
+	 *
+	 * A data ready edge that arrives while the previous burst is still in flight is read as soon as that
+	 * burst completes. A second one in the same burst, a full queue, a burst the HAL refuses or a DMA error
+	 * count as dropped samples, the last two also clear the INT latch with a blocking INT_STATUS read.
+	 * Without Bus::hasAsync (e.g. SPI, where the burst is a few us) the burst is read blocking from the ISR.
+	 */
+	void EnableDataReadyIRQ(uint16_t intPin);
+	void DisableDataReadyIRQ();
+	void OnDataReady(uint16_t GPIO_Pin, uint32_t stamp);
+	bool PopSample(Sample &out);
+	uint32_t DroppedSamples() const { return dropped; }
+
+	/*
+	 * Runtime reconfiguration through the register shadow.
+	 *
+	 * Every write to SMPLRT_DIV .. INT_ENABLE goes through to the device and into the shadow, so a
+	 * bit field change is computed locally and costs one register write (none if nothing changes),
+	 * instead of a read, a modify and a write.
+	 * SyncShadow re-reads the whole block in one burst, call it if something else may have
+	 * touched the device (e.g. after an external reset). Init does it once.
+	 */
+	void SyncShadow();
+	uint8_t ShadowReg(const uint8_t subAddress) const { return shadow[subAddress - MPU9250_SHADOW_BASE]; }
+	void SetGyroScale(Gscale scale);
+	void SetAccelScale(Ascale scale);
+	void SetGyroDLPF(uint8_t dlpfCfg);     /*CONFIG DLPF_CFG, 0 - 7*/
+	void SetAccelDLPF(uint8_t dlpfCfg);    /*ACCEL_CONFIG2 A_DLPFCFG, 0 - 7*/
+	void SetSampleRateDiv(uint8_t div);    /*Sample_rate = 1KHz/(1 + div)*/
+	void SetDataReadyInt(bool enable);
+
+	/*
+	 * Per body axis calibration (after the mounting), out = (raw * resolution - bias) * gain with the bias in output units.
+	 * Folded with the scale table into one factor and one offset per axis, so converting an axis
+	 * stays a single multiply-add. Default gain 1, bias 0.
+	 */
+	void SetAccelCalibration(const Real gain[3], const Real bias[3]);
+	void SetGyroCalibration(const Real gain[3], const Real bias[3]);
+	void SetMagCalibration(const Real gain[3], const Real bias[3]);
+
+	uint32_t Timestamp() const { return bus.ticks(); }
+
+	Bus &GetBus() { return bus; }
 
-	I2C_HandleTypeDef *I2Chandle; /* Handle to the I2C peripheral */
-	GPIO_InitTypeDef *GPIO_INT_PIN; /* Handle to configure the Alternate Functionality of the GPIO pins*/
 
 private:
 
 	/*
-	 * Helper functions for the read and write data via the i2c interface.
+	 * Helper functions for the read and write data via the transport.
+	 * Address is only meaningful on I2C, on SPI every access goes to the MPU9250 itself.
 	 */
-	void writeByte(I2C_HandleTypeDef& hi2c, const uint8_t Address, const uint8_t subAddress, const uint8_t data);
-	uint8_t readByte(I2C_HandleTypeDef& hi2c, const uint8_t Address, const uint8_t subAddress);
+	void writeByte(const uint8_t Address, const uint8_t subAddress, const uint8_t data)
+	{
+		if(Address == MPU9250_ADDRESS && isShadowed(subAddress)) shadow[subAddress - MPU9250_SHADOW_BASE] = data;
+		bus.write(Address, subAddress, data);
+	}
+	uint8_t readByte(const uint8_t Address, const uint8_t subAddress) { return bus.readByte(Address, subAddress); }
+	bool readByte(const uint8_t Address, const uint8_t subAddress, uint8_t &data) { return bus.read(Address, subAddress, &data, 1); } /* polls: a failed read is never ready */
+	bool readBytes(const uint8_t Address, const uint8_t subAddress, uint8_t *data, const uint16_t len) { return bus.read(Address, subAddress, data, len); }
+	void writeBytes(const uint8_t Address, const uint8_t subAddress, const uint8_t *data, const uint16_t len)
+	{
+		for(uint16_t i = 0; i < len; i++)
+		{
+			if(Address == MPU9250_ADDRESS && isShadowed(uint8_t(subAddress + i))) shadow[subAddress + i - MPU9250_SHADOW_BASE] = data[i];
+		}
+		bus.write(Address, subAddress, data, len);
+	}
 
 	/*
-	 * Helper function for the assiging the appropritate scales @refDataSheet.
+	 * The default script for both mag modes, generated at compile time.
 	 */
-	double getScale(const uint16_t scale);  // Gets the appropritate scale for GYRO, MAG, ACCEL
+	static constexpr InitOptions defaultInit(MagMode magMode)
+	{
+		InitOptions opt = MPU9250_DEFAULT_INIT;
+		opt.magMode = Bus::isSPI ? MagMode::Master : magMode;
+		opt.spi = Bus::isSPI;
+		return opt;
+	}
+	static constexpr InitScript initScripts[2] = { makeInitScript(defaultInit(MagMode::Bypass)), makeInitScript(defaultInit(MagMode::Master)) };
+
+	/*
+	 * Shadow helpers, updateReg clears clearMask, sets setBits and writes only if the value changed.
+	 * subAddress must be inside the shadow.
+	 */
+	static bool isShadowed(const uint8_t subAddress) { return uint8_t(subAddress - MPU9250_SHADOW_BASE) < MPU9250_SHADOW_LEN; }
+	void updateReg(const uint8_t subAddress, const uint8_t clearMask, const uint8_t setBits);
+
+	/*
+	 * Stamps and publishes the motion burst in dmaBuf, shared by the DMA completion and the blocking ISR read.
+	 */
+	void publishMotion();
+
+	/*
+	 * Reads the motion burst for the edge in pendingStamp. If the burst cannot start, the sample counts as
+	 * dropped and INT_STATUS is read blocking instead: the latched INT only drops on a read, without one
+	 * there is no further edge and the acquisition stops.
+	 */
+	void irqRead();
+
+	/*
+	 * Trampolines registered in detail::irqHook.
+	 */
+	static void rxCompleteHook(void *owner, const void *handle);
+	static void rxErrorHook(void *owner, const void *handle);
+	static void dataReadyHook(void *owner, uint16_t GPIO_Pin, uint32_t stamp);
+	void registerIrqHook();
+
+	/*
+	 * Per count resolution of every full scale, built at compile time from MPU9250_Scale.h.
+	 */
+	static constexpr Scale aTable[4] = { Traits::scale(perCount(Ascale::AFS_2G)), Traits::scale(perCount(Ascale::AFS_4G)),
+										 Traits::scale(perCount(Ascale::AFS_8G)), Traits::scale(perCount(Ascale::AFS_16G)) };
+	static constexpr Scale gTable[4] = { Traits::scale(perCount(Gscale::GFS_250DPS)), Traits::scale(perCount(Gscale::GFS_500DPS)),
+										 Traits::scale(perCount(Gscale::GFS_1000DPS)), Traits::scale(perCount(Gscale::GFS_2000DPS)) };
+	static constexpr Scale mTable[2] = { Traits::scale(perCount(Mscale::MFS_14BITS)), Traits::scale(perCount(Mscale::MFS_16BITS)) };
+
+	/*
+	 * Calibration of one sensor and what it folds into: out = raw * k + offset.
+	 */
+	struct AxisCal
+	{
+		Real gain[3];
+		Real bias[3];
+		Real sens[3];	/*Factory sensitivity trim per body axis, the fuse ROM ASA for the mag, 1 otherwise*/
+		Scale k[3];
+		Real offset[3];
+	};
+	static void foldCal(AxisCal &cal, const Scale res, const AxisMap &axes);	// only on a scale or calibration change
+
+	/*
+	 * Body frame axes, the mag through the AK8963 alignment first. pick is the sensor axis for body
+	 * axis i, with constant arguments it folds away to the right register.
+	 */
+	static constexpr AxisMap accAxes = Mount::axes;
+	static constexpr AxisMap gyrAxes = Mount::axes;
+	static constexpr AxisMap magAxes = compose(Mount::axes, AK8963_TO_MPU);
+	static constexpr int16_t pick(const AxisMap &axes, uint8_t i, int16_t x, int16_t y, int16_t z)
+	{
+		return axes.axis[i] == 0 ? x : (axes.axis[i] == 1 ? y : z);
+	}
+	static void setCal(AxisCal &cal, const Real gain[3], const Real bias[3]);
+	void updateRes();
+
+	/*
+	 * Reads the whole frames available (at most maxSamples) into fifoBuf, 0 on overflow or when empty.
+	 * Decodes one big endian FIFO frame ACCEL(6) [TEMP(2)] GYRO(6).
+	 */
+	uint16_t drainFIFO(uint16_t maxSamples);
+	void decodeFrame(const uint8_t *raw, bool hasTemp, Sample &out);
+
+	/*
+	 * AK8963 helpers for MagMode::Master.
+	 * writeAK8963 goes through SLV4 and waits for SLV4_DONE, decodeMag takes the ST1..ST2 block and
+	 * returns false when there is no new or valid data.
+	 */
+	bool writeAK8963(const uint8_t subAddress, const uint8_t data);
+	bool readAK8963(const uint8_t subAddress, uint8_t &data);
+	bool setAK8963Mode(const uint8_t mode);
+	bool decodeMag(const uint8_t *st1, Real *out);
+
+	uint8_t motionBurstLen() const { return magMode == MagMode::Master ? MPU9250_MOTION_MAG_BURST_LEN : MPU9250_MOTION_BURST_LEN; }
+	uint8_t userCtrlBase() const
+	{
+		return (magMode == MagMode::Master ? USER_CTRL_I2C_MST_EN : 0x00) | (Bus::isSPI ? USER_CTRL_I2C_IF_DIS : 0x00);
+	}
+	uint8_t intPinCfgBase() const { return magMode == MagMode::Master ? INT_PIN_CFG_LATCH_EN : (INT_PIN_CFG_LATCH_EN | INT_PIN_CFG_BYPASS_EN); }
 	
 //Keep public when testing 
 private: 
 
-	double acc[3];    /*3 axis accel OutPut*/
-	double gyr[3];	  /*3 axis gyro OutPut*/
-	double mag[3];	  /*3 axis mag OutPut*/
-
-	double roll_offset;
-	double pitch_offset;
+	Bus bus;
+
+	Real acc[3];      /*3 axis accel OutPut*/
+	Real gyr[3];	  /*3 axis gyro OutPut*/
+	Real mag[3];	  /*3 axis mag OutPut*/
+	Real temp;	 	  /*die temperature OutPut in degC*/
+
+	MagMode magMode;
+	Ascale aScale;	  /*Current accel full scale, used by the decode*/
+	Gscale gScale;	  /*Current gyro full scale, used by the decode*/
+	Mscale mScale;	  /*Current mag resolution*/
+	uint32_t startupTicks; /*Init entry to first RAW_DATA_RDY*/
+
+	AxisCal aCal, gCal, mCal; /*Current scale folded with the calibration, one multiply-add per axis*/
+	static constexpr Scale tempRes = Traits::scale(1.0 / TEMP_SENSITIVITY);
+	static constexpr Real tempOffset = Traits::value(TEMP_ROOM_OFFSET);
+
+	uint8_t shadow[MPU9250_SHADOW_LEN]; /*Write-through copy of SMPLRT_DIV .. INT_ENABLE*/
+
+	uint8_t fifoBuf[FifoBytes];			/*Drain buffer, a full FIFO by default*/
+	uint8_t fifoFrameSize;				/*12 (accel+gyro) or 14 (accel+temp+gyro) bytes*/
+	bool fifoOverflow;
+
+	uint8_t dmaBuf[MPU9250_MOTION_MAG_BURST_LEN]; /*DMA target, only touched by the DMA and the completion callback*/
+	Sample dmaSample[2];				  /*Ping-pong decoded samples*/
+	volatile uint8_t dmaFront;				  /*Index of the latest complete sample*/
+	volatile uint32_t dmaSeq;				  /*Bumped on every publish, used to detect a torn copy*/
+	uint32_t dmaSeqRead;					  /*dmaSeq at the last GetLatest*/
+	volatile DMAState dmaState;
+
+	uint16_t intPin;					/*EXTI line of the MPU INT pin*/
+	volatile bool irqMode;
+	volatile uint32_t pendingStamp;		/*Stamp of the burst in flight*/
+	volatile bool deferred;				/*An edge came in during the burst, read once it completes*/
+	volatile uint32_t deferredStamp;
+	Sample queue[QueueLen];
+	volatile uint16_t qHead;			/*Written by the ISR only*/
+	volatile uint16_t qTail;			/*Written by PopSample only*/
+	volatile uint32_t dropped;
+
+	Real roll_offset;
+	Real pitch_offset;
 };
 
+#ifdef USE_HAL_DRIVER
+/*
+ * The on target driver, I2C with the DMA path available. IMU::MPU9250 imu(hi2c1);
+ */
+using MPU9250 = MPU9250T<I2CDMABus>;
+#endif
+
 
 } /* namespace IMU */
 
+#include "MPU9250_Impl.h"
+
 #endif /* MPU9250_H_ */
@@ -0,0 +1,270 @@
+/*
+ * MPU9250_Batch.h
+ *
+ *  Batch decode of FIFO frames into structure of arrays, one column per axis.
+ *
+ *  A frame is big endian int16 words ACCEL(3) [TEMP(1)] GYRO(3). decode first byte swaps the whole
+ *  buffer in place, 8 words per step with SSE2 on the host and 2 with REV16 on the M4, and then
+ *  converts one column at a time with a constant stride, raw * k + offset per value. The float
+ *  columns convert 4 values per step with SSE2 on the host. On the M4 (single precision FPU, no
+ *  float SIMD) and for every other Real the conversion is the scalar loop, only the swap is packed.
+ *  decodeReference is the plain per frame version, it leaves the buffer alone. Both give the same result.
+ *
+ *  Works on any number of frames, e.g. a FIFO drain on target or a recorded stream on the host:
+ *
+ *  float ax[N], ay[N], az[N];
+ *  IMU::batch::Columns<float> out = {{ax, ay, az, nullptr, nullptr, nullptr, nullptr}};
+ *  IMU::batch::decode(raw, N, false, conv, out);
+ *
+ *  SampleBatch is a fixed capacity structure of arrays of samples with stamps and status flags. The
+ *  driver acquires into it in place (ReadFIFO, PopSamples) and filters can walk its columns directly.
+ *
+ *  Included from MPU9250.h.
+ */
+
+#ifndef MPU9250_BATCH_H_
+#define MPU9250_BATCH_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace IMU {
+namespace batch {
+
+/*
+ * Columns in burst order, TEMP only exists in frames with temperature.
+ */
+enum Column : uint8_t
+{
+	AX = 0, AY, AZ, TEMP, GX, GY, GZ, COLUMNS
+};
+
+/*
+ * Destination, one array per column with room for all the frames. A null column is skipped.
+ */
+template<typename Real>
+struct Columns
+{
+	Real *col[COLUMNS];
+};
+
+/*
+ * Per column out = raw[src] * k + offset, MPU9250T::GetConversion hands out the driver's current one.
+ * src is the frame column each output column is taken from (board mounting), straight through by default.
+ */
+template<typename Real, typename Scale>
+struct Conversion
+{
+	Scale k[COLUMNS];
+	Real offset[COLUMNS];
+	uint8_t src[COLUMNS] = {AX, AY, AZ, TEMP, GX, GY, GZ};
+};
+
+constexpr uint8_t frameWords(bool hasTemp) { return hasTemp ? 7 : 6; }
+
+constexpr uint8_t wordIndex(uint8_t column, bool hasTemp) { return (column > TEMP && !hasTemp) ? column - 1 : column; }
+
+/*
+ * Big endian int16 words to host order, in place. Both the M4 and the host are little endian.
+ */
+inline void swapWords(uint8_t *buf, uint32_t words)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	for(; i + 8 <= words; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 2 * i));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(buf + 2 * i), v);
+	}
+#elif defined(USE_HAL_DRIVER) && defined(__ARM_FEATURE_DSP)
+	for(; i + 2 <= words; i += 2)
+	{
+		uint32_t w;
+		memcpy(&w, buf + 2 * i, 4);		//Unaligned LDR/STR are fine on the M4
+		w = __REV16(w);
+		memcpy(buf + 2 * i, &w, 4);
+	}
+#endif
+
+	for(; i < words; i++)
+	{
+		uint8_t t = buf[2 * i];
+		buf[2 * i] = buf[2 * i + 1];
+		buf[2 * i + 1] = t;
+	}
+}
+
+/*
+ * One column of n frames, stride in words, from a swapped buffer.
+ */
+template<typename Real, typename Scale>
+void convertColumn(const uint8_t *words, uint8_t stride, uint32_t n, Scale k, Real offset, Real *out)
+{
+	for(uint32_t i = 0; i < n; i++)
+	{
+		int16_t v;
+		memcpy(&v, words + 2u * stride * i, 2);
+		out[i] = v * k + offset;
+	}
+}
+
+#if defined(__SSE2__)
+inline uint16_t loadWord(const uint8_t *p)
+{
+	uint16_t v;
+	memcpy(&v, p, 2);
+	return v;
+}
+
+/*
+ * float on SSE2, 4 values per step: the strided words are inserted into one register (pinsrw, not
+ * through an array on the stack, four 2 byte stores read back as one 8 byte load stall store
+ * forwarding), sign extended, converted, scaled and offset together. Same operations in the same
+ * order as the template, same result.
+ */
+inline void convertColumn(const uint8_t *words, uint8_t stride, uint32_t n, float k, float offset, float *out)
+{
+	const __m128 vk = _mm_set1_ps(k), vo = _mm_set1_ps(offset);
+	const uint32_t step = 2u * stride;
+	uint32_t i = 0;
+
+	for(; i + 4 <= n; i += 4, words += 4 * step)
+	{
+		__m128i w = _mm_cvtsi32_si128(loadWord(words));
+		w = _mm_insert_epi16(w, loadWord(words + step), 1);
+		w = _mm_insert_epi16(w, loadWord(words + 2 * step), 2);
+		w = _mm_insert_epi16(w, loadWord(words + 3 * step), 3);
+		const __m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(x, vk), vo));
+	}
+
+	for(; i < n; i++, words += step)
+	{
+		int16_t v;
+		memcpy(&v, words, 2);
+		out[i] = v * k + offset;
+	}
+}
+#endif
+
+/*
+ * Byte swaps raw in place and fills the columns. raw is not usable as FIFO data afterwards.
+ */
+template<typename Real, typename Scale>
+void decode(uint8_t *raw, uint32_t frames, bool hasTemp, const Conversion<Real, Scale> &conv, const Columns<Real> &out)
+{
+	const uint8_t stride = frameWords(hasTemp);
+	swapWords(raw, frames * stride);
+
+	for(uint8_t c = 0; c < COLUMNS; c++)
+	{
+		if(out.col[c] == nullptr || (c == TEMP && !hasTemp)) continue;
+		convertColumn(raw + 2 * wordIndex(conv.src[c], hasTemp), stride, frames, conv.k[c], conv.offset[c], out.col[c]);
+	}
+}
+
+/*
+ * Scalar reference, frame by frame straight from the big endian bytes.
+ */
+template<typename Real, typename Scale>
+void decodeReference(const uint8_t *raw, uint32_t frames, bool hasTemp, const Conversion<Real, Scale> &conv, const Columns<Real> &out)
+{
+	const uint8_t stride = frameWords(hasTemp);
+
+	for(uint32_t i = 0; i < frames; i++, raw += 2 * stride)
+	{
+		for(uint8_t c = 0; c < COLUMNS; c++)
+		{
+			if(out.col[c] == nullptr || (c == TEMP && !hasTemp)) continue;
+
+			const uint8_t w = wordIndex(conv.src[c], hasTemp);
+			int16_t v = (int16_t)((int16_t)raw[2 * w] << 8 | raw[2 * w + 1]);
+			out.col[c][i] = v * conv.k[c] + conv.offset[c];
+		}
+	}
+}
+
+/*
+ * Status of a sample in a SampleBatch.
+ */
+enum SampleFlags : uint8_t
+{
+	SAMPLE_TEMP = 0x01,		/*temp column is valid*/
+	SAMPLE_MAG  = 0x02,		/*mag columns are valid*/
+	SAMPLE_FIFO = 0x04,		/*from a FIFO drain, stamp is the drain time shared by the whole drain*/
+	SAMPLE_GAP  = 0x08		/*samples were lost right before this one (FIFO overflow)*/
+};
+
+/*
+ * Fixed capacity, no heap, one contiguous array per axis. Declare it static or as a member,
+ * it is Capacity * (10 * sizeof(Real) + 5) bytes.
+ */
+template<typename Real, uint16_t Capacity>
+struct SampleBatch
+{
+	Real acc[3][Capacity];
+	Real temp[Capacity];
+	Real gyr[3][Capacity];
+	Real mag[3][Capacity];
+	uint32_t stamp[Capacity];
+	uint8_t flags[Capacity];
+	uint16_t count = 0;
+
+	void clear() { count = 0; }
+	uint16_t space() const { return Capacity - count; }
+
+	/*
+	 * Columns from the first free slot on, to decode straight into the batch.
+	 */
+	Columns<Real> tail()
+	{
+		return Columns<Real>{{&acc[0][count], &acc[1][count], &acc[2][count], &temp[count],
+							  &gyr[0][count], &gyr[1][count], &gyr[2][count]}};
+	}
+
+	/*
+	 * Takes n samples written through tail().
+	 */
+	void commit(uint16_t n, uint32_t stampAll, uint8_t flagsAll)
+	{
+		for(uint16_t i = count; i < count + n; i++)
+		{
+			stamp[i] = stampAll;
+			flags[i] = flagsAll;
+		}
+		count += n;
+	}
+
+	/*
+	 * Appends one MotionSampleT<Real>, false when full.
+	 */
+	template<class Sample>
+	bool push(const Sample &s, uint8_t sampleFlags)
+	{
+		if(count == Capacity) return false;
+
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			acc[i][count] = s.acc[i];
+			gyr[i][count] = s.gyr[i];
+			mag[i][count] = s.mag[i];
+		}
+		temp[count] = s.temp;
+		stamp[count] = s.stamp;
+		flags[count] = sampleFlags;
+		count++;
+
+		return true;
+	}
+};
+
+} /* namespace batch */
+} /* namespace IMU */
+
+#endif /* MPU9250_BATCH_H_ */
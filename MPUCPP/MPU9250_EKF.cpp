@@ -0,0 +1,320 @@
+/*
+ * MPU9250_EKF.cpp
+ *
+ *  Error state Kalman filter, see MPU9250_EKF.h.
+ *
+ *  Error state layout: 0 - 2 attitude error (body), 3 - 5 gyro bias, 6 - 8 accel bias.
+ *  q_true = q * (1, dtheta / 2), b_true = b + db.
+ */
+
+#include "MPU9250_EKF.h"
+
+#include <math.h>
+
+namespace IMU {
+
+template<bool AccelBias>
+AttitudeEKF<AccelBias>::AttitudeEKF(const EKFNoise &noise, float secondsPerTick, Earth earth)
+: noise(noise), earth(earth), q{1.0f, 0.0f, 0.0f, 0.0f}, bg{0.0f, 0.0f, 0.0f}, ba{0.0f, 0.0f, 0.0f},
+  P(Covariance::zero()), clock(secondsPerTick), aligned(false), rejected(0)
+{
+	resetCovariance(false);
+}
+
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::resetCovariance(bool haveHeading)
+{
+	P = Covariance::zero();
+
+	const float a = noise.initAttitude * noise.initAttitude;
+	const float g = noise.initGyroBias * noise.initGyroBias;
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		P(i, i) = a;
+		P(3 + i, 3 + i) = g;
+		if constexpr(AccelBias) P(6 + i, 6 + i) = noise.initAccelBias * noise.initAccelBias;
+	}
+
+	//The heading is about earth z, spread over the body axes by the tilt. Level enough for a start.
+	if(!haveHeading)
+	{
+		float r[3][3];
+		rotation(r);
+
+		const float h = noise.initHeading * noise.initHeading - a;
+		for(uint8_t i = 0; i < 3; i++)
+			for(uint8_t j = 0; j < 3; j++) P(i, j) += h * (r[2][i] * r[2][j]);
+	}
+}
+
+/*
+ * Body to earth rotation matrix of q.
+ */
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::rotation(float r[3][3]) const
+{
+	const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+
+	r[0][0] = 1.0f - 2.0f * (q2 * q2 + q3 * q3);
+	r[0][1] = 2.0f * (q1 * q2 - q0 * q3);
+	r[0][2] = 2.0f * (q1 * q3 + q0 * q2);
+	r[1][0] = 2.0f * (q1 * q2 + q0 * q3);
+	r[1][1] = 1.0f - 2.0f * (q1 * q1 + q3 * q3);
+	r[1][2] = 2.0f * (q2 * q3 - q0 * q1);
+	r[2][0] = 2.0f * (q1 * q3 - q0 * q2);
+	r[2][1] = 2.0f * (q2 * q3 + q0 * q1);
+	r[2][2] = 1.0f - 2.0f * (q1 * q1 + q2 * q2);
+}
+
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::Align(const float acc[3], const float mag[3])
+{
+	//Earth axes seen from the body: z from gravity, x from the horizontal part of the field
+	const float zs = (earth == Earth::NED) ? -1.0f : 1.0f;
+	float z[3] = {zs * acc[0], zs * acc[1], zs * acc[2]};
+	//Once per alignment, so exact normalisations, invSqrt's 0.07 % would leave x off perpendicular to z
+	float n = 1.0f / sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	for(uint8_t i = 0; i < 3; i++) z[i] *= n;
+
+	const bool haveHeading = mag != nullptr && !fusion::isZero(mag);
+	float x[3];
+
+	if(haveHeading)
+	{
+		for(uint8_t i = 0; i < 3; i++) x[i] = mag[i];
+	}
+	else
+	{
+		//Body x, or body y when x is (nearly) vertical
+		x[0] = (z[0] * z[0] < 0.5f) ? 1.0f : 0.0f;
+		x[1] = 1.0f - x[0];
+		x[2] = 0.0f;
+	}
+
+	const float d = x[0] * z[0] + x[1] * z[1] + x[2] * z[2];
+	for(uint8_t i = 0; i < 3; i++) x[i] -= d * z[i];
+	n = 1.0f / sqrtf(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	for(uint8_t i = 0; i < 3; i++) x[i] *= n;
+
+	const float y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+
+	//Rows of the body to earth matrix are the earth axes in body coordinates
+	const float r[3][3] = {{x[0], x[1], x[2]}, {y[0], y[1], y[2]}, {z[0], z[1], z[2]}};
+	const float tr = r[0][0] + r[1][1] + r[2][2];
+
+	if(tr > 0.0f)
+	{
+		const float s = 2.0f * sqrtf(1.0f + tr);
+		q = Quaternion{0.25f * s, (r[2][1] - r[1][2]) / s, (r[0][2] - r[2][0]) / s, (r[1][0] - r[0][1]) / s};
+	}
+	else if(r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		const float s = 2.0f * sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]);
+		q = Quaternion{(r[2][1] - r[1][2]) / s, 0.25f * s, (r[0][1] + r[1][0]) / s, (r[0][2] + r[2][0]) / s};
+	}
+	else if(r[1][1] > r[2][2])
+	{
+		const float s = 2.0f * sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]);
+		q = Quaternion{(r[0][2] - r[2][0]) / s, (r[0][1] + r[1][0]) / s, 0.25f * s, (r[1][2] + r[2][1]) / s};
+	}
+	else
+	{
+		const float s = 2.0f * sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]);
+		q = Quaternion{(r[1][0] - r[0][1]) / s, (r[0][2] + r[2][0]) / s, (r[1][2] + r[2][1]) / s, 0.25f * s};
+	}
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		bg[i] = 0.0f;
+		ba[i] = 0.0f;
+	}
+
+	resetCovariance(haveHeading);
+	aligned = true;
+}
+
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::Predict(const float gyr[3], float dt)
+{
+	//Rotation over dt, 4th order series of (cos, sin) instead of libm
+	const float vx = (gyr[0] - bg[0]) * dt, vy = (gyr[1] - bg[1]) * dt, vz = (gyr[2] - bg[2]) * dt;
+	const float a2 = vx * vx + vy * vy + vz * vz;
+	const float c = 1.0f - a2 * (1.0f / 8.0f);
+	const float s = 0.5f - a2 * (1.0f / 48.0f);
+
+	const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+	const float dx = s * vx, dy = s * vy, dz = s * vz;
+
+	float w = q0 * c - q1 * dx - q2 * dy - q3 * dz;
+	float x = q1 * c + q0 * dx + q2 * dz - q3 * dy;
+	float y = q2 * c + q0 * dy - q1 * dz + q3 * dx;
+	float z = q3 * c + q0 * dz + q1 * dy - q2 * dx;
+	const float n = fusion::invSqrt(w * w + x * x + y * y + z * z);
+	q = Quaternion{w * n, x * n, y * n, z * n};
+
+	//Error dynamics, dtheta' = -[w x] dtheta - dbg, biases are random walks
+	la::Matrix<N, N> F = la::Matrix<N, N>::identity();
+	F(0, 1) = vz;  F(0, 2) = -vy;
+	F(1, 0) = -vz; F(1, 2) = vx;
+	F(2, 0) = vy;  F(2, 1) = -vx;
+	F(0, 3) = F(1, 4) = F(2, 5) = -dt;
+
+	float qd[N];
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		qd[i] = noise.gyro * noise.gyro * dt;
+		qd[3 + i] = noise.gyroBias * noise.gyroBias * dt;
+		if constexpr(AccelBias) qd[6 + i] = noise.accelBias * noise.accelBias * dt;
+	}
+
+	la::propagate(P, F, qd);
+}
+
+template<bool AccelBias>
+uint8_t AttitudeEKF<AccelBias>::UpdateAccel(const float acc[3])
+{
+	const float norm2 = acc[0] * acc[0] + acc[1] * acc[1] + acc[2] * acc[2];
+	const float dev = norm2 * fusion::invSqrt(norm2) - PHY_g;
+	if(dev > noise.accelTolerance || dev < -noise.accelTolerance) return 0;
+
+	//Predicted reaction to gravity in the body frame, g times the earth up axis seen from the body
+	float r[3][3];
+	rotation(r);
+	const float g = (earth == Earth::NED) ? -PHY_g : PHY_g;
+	const float h0[3] = {g * r[2][0], g * r[2][1], g * r[2][2]};
+
+	//d(R' g) / dtheta = [h0 x]
+	const float hx[3][3] = {{0.0f, -h0[2], h0[1]}, {h0[2], 0.0f, -h0[0]}, {-h0[1], h0[0], 0.0f}};
+
+	float h[3][N] = {};
+	float y[3];
+	la::ScalarUpdate<N> u;
+
+	//Gated as a whole on the prior: a linear acceleration spreads over the body axes with the attitude,
+	//a component taken alone would carry its share of it into the tilt
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		for(uint8_t j = 0; j < 3; j++) h[i][j] = hx[i][j];
+		if constexpr(AccelBias) h[i][6 + i] = 1.0f;
+
+		y[i] = acc[i] - h0[i] - ba[i];
+		if(u.prepare(P, h[i], noise.accel * noise.accel, y[i]) > noise.gate)
+		{
+			rejected += 3;
+			return 0;
+		}
+	}
+
+	float dx[N] = {};
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		for(uint8_t j = 0; j < N; j++) y[i] -= h[i][j] * dx[j];
+
+		u.prepare(P, h[i], noise.accel * noise.accel, y[i]);
+		u.apply(P, y[i], dx);
+	}
+
+	inject(dx);
+	return 3;
+}
+
+template<bool AccelBias>
+bool AttitudeEKF<AccelBias>::UpdateHeading(const float mag[3])
+{
+	float r[3][3];
+	rotation(r);
+
+	//Field in the earth frame with the current tilt, its horizontal angle is the heading error
+	const float ex = r[0][0] * mag[0] + r[0][1] * mag[1] + r[0][2] * mag[2];
+	const float ey = r[1][0] * mag[0] + r[1][1] * mag[1] + r[1][2] * mag[2];
+	if(ex * ex + ey * ey <= 0.0f) return false;
+
+	//Heading is about earth z, R dtheta projects the body error onto it
+	float h[N] = {};
+	for(uint8_t j = 0; j < 3; j++) h[j] = r[2][j];
+
+	const float y = -atan2f(ey, ex);
+
+	la::ScalarUpdate<N> u;
+	if(u.prepare(P, h, noise.heading * noise.heading, y) > noise.gate)
+	{
+		rejected++;
+		return false;
+	}
+
+	float dx[N] = {};
+	u.apply(P, y, dx);
+	inject(dx);
+
+	return true;
+}
+
+/*
+ * Folds the error into the nominal state, the error is zero again afterwards. The reset Jacobian
+ * is taken as identity, the attitude errors are small by then.
+ */
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::inject(const float dx[N])
+{
+	const float ex = 0.5f * dx[0], ey = 0.5f * dx[1], ez = 0.5f * dx[2];
+	const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+
+	float w = q0 - q1 * ex - q2 * ey - q3 * ez;
+	float x = q1 + q0 * ex + q2 * ez - q3 * ey;
+	float y = q2 + q0 * ey - q1 * ez + q3 * ex;
+	float z = q3 + q0 * ez + q1 * ey - q2 * ex;
+	const float n = fusion::invSqrt(w * w + x * x + y * y + z * z);
+	q = Quaternion{w * n, x * n, y * n, z * n};
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		bg[i] += dx[3 + i];
+		if constexpr(AccelBias) ba[i] += dx[6 + i];
+	}
+}
+
+template<bool AccelBias>
+bool AttitudeEKF<AccelBias>::Update(const MotionSample &s, bool useMag)
+{
+	float dt;
+	const bool step = clock.step(s.stamp, dt);
+	const float *mag = (useMag && !fusion::isZero(s.mag)) ? s.mag : nullptr;
+
+	if(!aligned)
+	{
+		if(!fusion::isZero(s.acc)) Align(s.acc, mag);
+		return false;
+	}
+
+	if(!step) return false;
+
+	Predict(s.gyr, dt);
+	UpdateAccel(s.acc);
+	if(mag != nullptr) UpdateHeading(mag);
+
+	return true;
+}
+
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::GetGyroBias(float out[3]) const
+{
+	for(uint8_t i = 0; i < 3; i++) out[i] = bg[i];
+}
+
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::GetAccelBias(float out[3]) const
+{
+	for(uint8_t i = 0; i < 3; i++) out[i] = ba[i];
+}
+
+template<bool AccelBias>
+void AttitudeEKF<AccelBias>::AttitudeSigma(float out[3]) const
+{
+	for(uint8_t i = 0; i < 3; i++) out[i] = sqrtf(P(i, i));
+}
+
+template class AttitudeEKF<false>;
+template class AttitudeEKF<true>;
+
+} /* namespace IMU */
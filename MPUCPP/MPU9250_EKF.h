@@ -0,0 +1,116 @@
+/*
+ * MPU9250_EKF.h
+ *
+ *  Error state Kalman filter for attitude and gyro bias, with the accel bias as an option.
+ *
+ *  The nominal state is a quaternion (body to earth, NWU or NED as in MPU9250_Fusion.h) and the biases,
+ *  the filter state is the small error around it: attitude error in the body frame, gyro bias error
+ *  and, for AttitudeEKF<true>, accel bias error. The gyro drives the prediction, the accel is a gravity
+ *  measurement and the mag only corrects the heading, a disturbed field never tilts the estimate.
+ *
+ *  Every measurement component is a scalar update, gated on its normalised innovation (chi^2, 1 DoF),
+ *  so a linear acceleration or a magnetic disturbance is rejected instead of pulling the estimate.
+ *  The accel is gated as a whole, one component out drops all three.
+ *  The covariance is the gate, AttitudeSigma gives it in rad for the application's own gating.
+ *
+ *  All matrices are la::Matrix on the stack or in the object, 6x6 or 9x9, no heap.
+ *
+ *  IMU::AttitudeEKF<> ekf(IMU::EKFNoise{}, 1.0f / SystemCoreClock, IMU::Earth::NED);
+ *  if(imu.GetLatest(s) && ekf.Update(s)) { ... ekf.GetQuaternion() ... }
+ */
+
+#ifndef MPU9250_EKF_H_
+#define MPU9250_EKF_H_
+
+#include <stdint.h>
+
+#include "MPU9250_Fusion.h"
+#include "MPU9250_Matrix.h"
+
+namespace IMU {
+
+/*
+ * Noise model. Densities are per sqrt(Hz), the filter scales them with the measured dt.
+ * The defaults are the MPU9250 datasheet figures with margin for the unmodelled (scale, misalignment).
+ */
+struct EKFNoise
+{
+	float gyro = 1e-3f;				/*rad/s/sqrt(Hz), white gyro noise*/
+	float gyroBias = 2e-5f;			/*rad/s^2/sqrt(Hz), gyro bias random walk*/
+	float accelBias = 1e-4f;		/*m/s^3/sqrt(Hz), accel bias random walk*/
+	float accel = 0.5f;				/*m/s^2 per sample, noise plus small linear accelerations*/
+	float heading = 0.05f;			/*rad per mag sample*/
+	float accelTolerance = 1.5f;	/*m/s^2, | |acc| - g | above this skips the accel update*/
+	float gate = 10.83f;			/*chi^2 threshold per component, 99.9 %*/
+
+	float initAttitude = 0.1f;		/*rad, after Align*/
+	float initHeading = 3.14159265f;/*rad, after an Align without mag*/
+	float initGyroBias = 0.05f;		/*rad/s*/
+	float initAccelBias = 0.3f;		/*m/s^2*/
+};
+
+template<bool AccelBias = false>
+class AttitudeEKF
+{
+public:
+	static constexpr uint8_t N = AccelBias ? 9 : 6;
+	using Covariance = la::Matrix<N, N>;
+
+	explicit AttitudeEKF(const EKFNoise &noise = EKFNoise(), float secondsPerTick = 1e-6f, Earth earth = Earth::NWU);
+
+	/*
+	 * Attitude from a gravity (and mag) direction, biases zero, covariance back to the initial one.
+	 * Without mag the heading is arbitrary and gets initHeading.
+	 */
+	void Align(const float acc[3], const float mag[3]);
+
+	/*
+	 * Strapdown step with the bias corrected gyro (rad/s) over dt seconds.
+	 */
+	void Predict(const float gyr[3], float dt);
+
+	/*
+	 * Accel in m/s^2 as a gravity measurement, returns the number of components taken (0 or 3).
+	 * Mag in any unit, only its tilt compensated direction is used, returns false if rejected.
+	 */
+	uint8_t UpdateAccel(const float acc[3]);
+	bool UpdateHeading(const float mag[3]);
+
+	/*
+	 * Aligns on the first sample, then Predict and the updates with dt from the stamps.
+	 * Returns false for samples that only (re)started the clock.
+	 */
+	bool Update(const MotionSample &s, bool useMag = true);
+
+	bool Aligned() const { return aligned; }
+	const Quaternion &GetQuaternion() const { return q; }
+	EulerAngles GetEuler() const { return fusion::toEuler(q); }
+	void GetGyroBias(float out[3]) const;
+	void GetAccelBias(float out[3]) const;		/*zero unless AccelBias*/
+
+	const Covariance &GetCovariance() const { return P; }
+	void AttitudeSigma(float out[3]) const;		/*1 sigma attitude error per body axis, rad*/
+
+	uint32_t Rejected() const { return rejected; }	/*gated out measurement components*/
+
+private:
+	void resetCovariance(bool haveHeading);
+	void inject(const float dx[N]);
+	void rotation(float r[3][3]) const;
+
+	EKFNoise noise;
+	Earth earth;
+
+	Quaternion q;
+	float bg[3];
+	float ba[3];
+	Covariance P;
+
+	fusion::Clock clock;
+	bool aligned;
+	uint32_t rejected;
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_EKF_H_ */
@@ -0,0 +1,181 @@
+/*
+ * MPU9250_Fixed.h
+ *
+ *  Fixed point sample pipeline for IMU::MPU9250T<Bus, fixed::Q16>.
+ *
+ *  Q16   Q16.16 in an int32_t, the sample type: m/s^2, rad/s, degC and mG.
+ *  Q15   Q1.15 in an int16_t, for coefficients in [-1, 1) (filter gains, trims).
+ *  QScale raw count to Q16 conversion, a mantissa and a compile time shift: q = (raw * mant) >> shift.
+ *         A QScale times a Q16 gain is again a QScale, calibration costs nothing per sample.
+ *
+ *  All arithmetic saturates instead of wrapping. Nothing in the acquisition path touches the FPU,
+ *  convert with toFloat only at the edges (logging, telemetry).
+ *  The mag in mG saturates at +-32767, well above the earth field.
+ *
+ *  Included from MPU9250.h.
+ */
+
+#ifndef MPU9250_FIXED_H_
+#define MPU9250_FIXED_H_
+
+#include <stdint.h>
+
+namespace IMU {
+namespace fixed {
+
+constexpr int32_t sat32(int64_t x)
+{
+	return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : int32_t(x));
+}
+
+constexpr int16_t sat16(int32_t x)
+{
+	return x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : int16_t(x));
+}
+
+/*
+ * Rounded arithmetic right shift, shift > 0.
+ */
+constexpr int64_t roundShift(int64_t x, uint8_t shift)
+{
+	return (x + (int64_t(1) << (shift - 1))) >> shift;
+}
+
+struct Q16
+{
+	int32_t v;
+
+	constexpr Q16() : v(0) {}
+
+	static constexpr Q16 fromRaw(int32_t raw) { Q16 q; q.v = raw; return q; }
+	static constexpr Q16 fromDouble(double x) { return fromRaw(sat32(int64_t(x * 65536.0 + (x < 0 ? -0.5 : 0.5)))); }
+};
+
+struct Q15
+{
+	int16_t v;
+
+	constexpr Q15() : v(0) {}
+
+	static constexpr Q15 fromRaw(int16_t raw) { Q15 q; q.v = raw; return q; }
+	static constexpr Q15 fromDouble(double x) { return fromRaw(sat16(int32_t(x * 32768.0 + (x < 0 ? -0.5 : 0.5)))); }
+};
+
+struct QScale
+{
+	int32_t mant;
+	uint8_t shift;
+};
+
+/*
+ * Picks the largest shift that keeps the mantissa below 2^30, so an int16 count times the mantissa
+ * always fits the 64 bit product (one SMULL on the M4).
+ */
+constexpr QScale makeScale(double perCount)
+{
+	double k = perCount * 65536.0;
+	uint8_t shift = 0;
+
+	while(shift < 46 && (k < 0 ? -k : k) * 2 < 1073741824.0)
+	{
+		k *= 2;
+		shift++;
+	}
+
+	return QScale{int32_t(k + (k < 0 ? -0.5 : 0.5)), shift};
+}
+
+//Q16
+constexpr Q16 operator+(Q16 a, Q16 b) { return Q16::fromRaw(sat32(int64_t(a.v) + b.v)); }
+constexpr Q16 operator-(Q16 a, Q16 b) { return Q16::fromRaw(sat32(int64_t(a.v) - b.v)); }
+constexpr Q16 operator-(Q16 a)		  { return Q16::fromRaw(sat32(-int64_t(a.v))); }
+constexpr Q16 operator*(Q16 a, Q16 b) { return Q16::fromRaw(sat32(roundShift(int64_t(a.v) * b.v, 16))); }
+constexpr bool operator==(Q16 a, Q16 b) { return a.v == b.v; }
+constexpr bool operator<(Q16 a, Q16 b)  { return a.v < b.v; }
+
+//Q15
+constexpr Q15 operator+(Q15 a, Q15 b) { return Q15::fromRaw(sat16(int32_t(a.v) + b.v)); }
+constexpr Q15 operator-(Q15 a, Q15 b) { return Q15::fromRaw(sat16(int32_t(a.v) - b.v)); }
+constexpr Q15 operator*(Q15 a, Q15 b) { return Q15::fromRaw(sat16(int32_t(roundShift(int32_t(a.v) * b.v, 15)))); }
+
+//Mixed, a Q15 gain on a Q16 value
+constexpr Q16 operator*(Q15 a, Q16 b) { return Q16::fromRaw(sat32(roundShift(int64_t(a.v) * b.v, 15))); }
+
+//Raw sensor counts to Q16
+constexpr Q16 operator*(int16_t raw, QScale s)
+{
+	int64_t p = int64_t(raw) * s.mant;
+	return Q16::fromRaw(sat32(s.shift ? roundShift(p, s.shift) : p));
+}
+
+/*
+ * A scale trimmed by a Q16 gain, for folding calibration into the conversion.
+ * Gives up shift while the mantissa would reach 2^30.
+ */
+constexpr QScale operator*(QScale s, Q16 gain)
+{
+	int64_t m = roundShift(int64_t(s.mant) * gain.v, 16);
+	uint8_t shift = s.shift;
+
+	while(shift > 0 && (m < 0 ? -m : m) >= 1073741824)
+	{
+		m = roundShift(m, 1);
+		shift--;
+	}
+
+	return QScale{sat32(m), shift};
+}
+
+/*
+ * Calibration, bias first then the scale factor trim (e.g. 1.0 +- a few %).
+ */
+constexpr Q16 calibrate(Q16 x, Q16 bias, Q16 gain) { return (x - bias) * gain; }
+
+/*
+ * First order low pass y += alpha * (x - y), alpha = dt / (RC + dt) in Q15.
+ */
+struct LowPass
+{
+	Q15 alpha;
+	Q16 y;
+
+	constexpr Q16 update(Q16 x)
+	{
+		y = y + alpha * (x - y);
+		return y;
+	}
+};
+
+//Edges only
+constexpr float toFloat(Q16 x) { return float(x.v) * (1.0f / 65536.0f); }
+constexpr float toFloat(Q15 x) { return float(x.v) * (1.0f / 32768.0f); }
+
+} /* namespace fixed */
+
+
+/*
+ * What the driver's conversion path needs from its sample type.
+ * Scale is what a raw count is multiplied with, value builds a constant and fromFixed converts an
+ * integer with frac fractional bits (frac <= 16) without going through floating point.
+ */
+template<typename Real>
+struct ScalarTraits
+{
+	using Scale = Real;
+	static constexpr Scale scale(double perCount) { return Real(perCount); }
+	static constexpr Real value(double x) { return Real(x); }
+	static constexpr Real fromFixed(int32_t x, uint8_t frac) { return Real(x) / Real(int32_t(1) << frac); }
+};
+
+template<>
+struct ScalarTraits<fixed::Q16>
+{
+	using Scale = fixed::QScale;
+	static constexpr Scale scale(double perCount) { return fixed::makeScale(perCount); }
+	static constexpr fixed::Q16 value(double x) { return fixed::Q16::fromDouble(x); }
+	static constexpr fixed::Q16 fromFixed(int32_t x, uint8_t frac) { return fixed::Q16::fromRaw(fixed::sat32(int64_t(x) << (16 - frac))); }
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_FIXED_H_ */
@@ -0,0 +1,273 @@
+/*
+ * MPU9250_Fusion.cpp
+ *
+ *  Attitude filters, see MPU9250_Fusion.h.
+ */
+
+#include "MPU9250_Fusion.h"
+
+#include <math.h>
+
+namespace IMU {
+
+namespace fusion {
+
+EulerAngles toEuler(const Quaternion &q)
+{
+	EulerAngles e;
+
+	float sp = 2.0f * (q.w * q.y - q.z * q.x);
+	if(sp > 1.0f) sp = 1.0f;
+	if(sp < -1.0f) sp = -1.0f;
+
+	e.roll = atan2f(2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+	e.pitch = asinf(sp);
+	e.yaw = atan2f(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z));
+
+	return e;
+}
+
+} /* namespace fusion */
+
+
+/*
+ * Madgwick, An efficient orientation filter for inertial and inertial/magnetic sensor arrays, 2010.
+ */
+Madgwick::Madgwick(float beta, float secondsPerTick, Earth earth)
+: beta(beta), earth(earth), q{1.0f, 0.0f, 0.0f, 0.0f}, clock(secondsPerTick)
+{
+}
+
+void Madgwick::Reset()
+{
+	q = Quaternion{1.0f, 0.0f, 0.0f, 0.0f};
+	clock.reset();
+}
+
+bool Madgwick::Update(const MotionSample &s, bool useMag)
+{
+	float dt;
+	if(!clock.step(s.stamp, dt)) return false;
+
+	Update(s.gyr, s.acc, useMag ? s.mag : nullptr, dt);
+	return true;
+}
+
+void Madgwick::Update(const float gyr[3], const float acc[3], const float mag[3], float dt)
+{
+	const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+	const float gx = gyr[0], gy = gyr[1], gz = gyr[2];
+
+	//Rate of change from the gyro, qDot = 0.5 * q x (0, w)
+	float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+	float qDot1 = 0.5f * ( q0 * gx + q2 * gz - q3 * gy);
+	float qDot2 = 0.5f * ( q0 * gy - q1 * gz + q3 * gx);
+	float qDot3 = 0.5f * ( q0 * gz + q1 * gy - q2 * gx);
+
+	//NED: the reaction to gravity is -z, flip it so the objective below holds in both frames
+	const float as = (earth == Earth::NED) ? -1.0f : 1.0f;
+	float ax = as * acc[0], ay = as * acc[1], az = as * acc[2];
+
+	const bool hasMag = mag != nullptr && !fusion::isZero(mag);
+
+	//A free falling sample has no direction, gyro only
+	if(ax != 0.0f || ay != 0.0f || az != 0.0f)
+	{
+		float n = fusion::invSqrt(ax * ax + ay * ay + az * az);
+		ax *= n;
+		ay *= n;
+		az *= n;
+
+		const float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+		float s0, s1, s2, s3;
+
+		if(hasMag)
+		{
+			float mx = mag[0], my = mag[1], mz = mag[2];
+			n = fusion::invSqrt(mx * mx + my * my + mz * mz);
+			mx *= n;
+			my *= n;
+			mz *= n;
+
+			const float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+			const float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+			const float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+			//Earth field in the horizontal x and vertical z, the reference direction of the mag
+			const float _2q0mx = _2q0 * mx, _2q0my = _2q0 * my, _2q0mz = _2q0 * mz, _2q1mx = _2q1 * mx;
+			const float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+			const float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+			const float _2bx = sqrtf(hx * hx + hy * hy);
+			const float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+			const float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+			//Gradient of the accel and mag objectives
+			const float fax = 2.0f * (q1q3 - q0q2) - ax;
+			const float fay = 2.0f * (q0q1 + q2q3) - ay;
+			const float fmx = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+			const float fmy = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+			const float fmz = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+			const float faz = 1.0f - 2.0f * (q1q1 + q2q2) - az;
+
+			s0 = -_2q2 * fax + _2q1 * fay - _2bz * q2 * fmx + (-_2bx * q3 + _2bz * q1) * fmy + _2bx * q2 * fmz;
+			s1 = _2q3 * fax + _2q0 * fay - 4.0f * q1 * faz + _2bz * q3 * fmx + (_2bx * q2 + _2bz * q0) * fmy + (_2bx * q3 - _4bz * q1) * fmz;
+			s2 = -_2q0 * fax + _2q3 * fay - 4.0f * q2 * faz + (-_4bx * q2 - _2bz * q0) * fmx + (_2bx * q1 + _2bz * q3) * fmy + (_2bx * q0 - _4bz * q2) * fmz;
+			s3 = _2q1 * fax + _2q2 * fay + (-_4bx * q3 + _2bz * q1) * fmx + (-_2bx * q0 + _2bz * q2) * fmy + _2bx * q1 * fmz;
+		}
+		else
+		{
+			const float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+			const float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+			const float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+			s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+			s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+			s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+			s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+		}
+
+		//Step against the normalised gradient
+		const float ss = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+		if(ss > 0.0f)
+		{
+			n = beta * fusion::invSqrt(ss);
+			qDot0 -= n * s0;
+			qDot1 -= n * s1;
+			qDot2 -= n * s2;
+			qDot3 -= n * s3;
+		}
+	}
+
+	float w = q0 + qDot0 * dt, x = q1 + qDot1 * dt, y = q2 + qDot2 * dt, z = q3 + qDot3 * dt;
+	const float n = fusion::invSqrt(w * w + x * x + y * y + z * z);
+
+	q = Quaternion{w * n, x * n, y * n, z * n};
+}
+
+
+/*
+ * Mahony, Hamel, Pflimlin, Nonlinear complementary filters on the special orthogonal group, 2008.
+ * The error is the cross product of the measured and the predicted accel/mag directions, it is
+ * fed back into the gyro through a PI controller before the integration.
+ */
+Mahony::Mahony(float kp, float ki, float secondsPerTick, Earth earth)
+: kp(kp), ki(ki), earth(earth), q{1.0f, 0.0f, 0.0f, 0.0f}, integral{0.0f, 0.0f, 0.0f}, clock(secondsPerTick)
+{
+}
+
+void Mahony::Reset()
+{
+	q = Quaternion{1.0f, 0.0f, 0.0f, 0.0f};
+	clock.reset();
+}
+
+void Mahony::ResetBias()
+{
+	for(uint8_t i = 0; i < 3; i++) integral[i] = 0.0f;
+}
+
+void Mahony::GetGyroBias(float out[3]) const
+{
+	for(uint8_t i = 0; i < 3; i++) out[i] = -integral[i];
+}
+
+bool Mahony::Update(const MotionSample &s, bool useMag)
+{
+	float dt;
+	if(!clock.step(s.stamp, dt)) return false;
+
+	Update(s.gyr, s.acc, useMag ? s.mag : nullptr, dt);
+	return true;
+}
+
+void Mahony::Update(const float gyr[3], const float acc[3], const float mag[3], float dt)
+{
+	const float q0 = q.w, q1 = q.x, q2 = q.y, q3 = q.z;
+	float gx = gyr[0], gy = gyr[1], gz = gyr[2];
+
+	const float as = (earth == Earth::NED) ? -1.0f : 1.0f;
+	float ax = as * acc[0], ay = as * acc[1], az = as * acc[2];
+
+	if(ax != 0.0f || ay != 0.0f || az != 0.0f)
+	{
+		float n = fusion::invSqrt(ax * ax + ay * ay + az * az);
+		ax *= n;
+		ay *= n;
+		az *= n;
+
+		const float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+		const float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+		const float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+		//Predicted up in the body frame, the third row of the rotation matrix
+		const float vx = 2.0f * (q1q3 - q0q2);
+		const float vy = 2.0f * (q0q1 + q2q3);
+		const float vz = q0q0 - q1q1 - q2q2 + q3q3;
+
+		float ex = ay * vz - az * vy;
+		float ey = az * vx - ax * vz;
+		float ez = ax * vy - ay * vx;
+
+		if(mag != nullptr && !fusion::isZero(mag))
+		{
+			float mx = mag[0], my = mag[1], mz = mag[2];
+			n = fusion::invSqrt(mx * mx + my * my + mz * mz);
+			mx *= n;
+			my *= n;
+			mz *= n;
+
+			//Measured field rotated into earth, its horizontal part becomes north
+			const float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+			const float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+			const float bx = sqrtf(hx * hx + hy * hy);
+			const float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+			//And back into the body as the predicted field
+			const float wx = 2.0f * (bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2));
+			const float wy = 2.0f * (bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3));
+			const float wz = 2.0f * (bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2));
+
+			ex += my * wz - mz * wy;
+			ey += mz * wx - mx * wz;
+			ez += mx * wy - my * wx;
+		}
+
+		if(ki > 0.0f)
+		{
+			integral[0] += ki * ex * dt;
+			integral[1] += ki * ey * dt;
+			integral[2] += ki * ez * dt;
+
+			for(uint8_t i = 0; i < 3; i++)
+			{
+				if(integral[i] > MAHONY_MAX_BIAS) integral[i] = MAHONY_MAX_BIAS;
+				if(integral[i] < -MAHONY_MAX_BIAS) integral[i] = -MAHONY_MAX_BIAS;
+			}
+		}
+
+		gx += kp * ex + integral[0];
+		gy += kp * ey + integral[1];
+		gz += kp * ez + integral[2];
+	}
+	else
+	{
+		gx += integral[0];
+		gy += integral[1];
+		gz += integral[2];
+	}
+
+	//q += 0.5 * q x (0, w) * dt
+	gx *= 0.5f * dt;
+	gy *= 0.5f * dt;
+	gz *= 0.5f * dt;
+
+	float w = q0 - q1 * gx - q2 * gy - q3 * gz;
+	float x = q1 + q0 * gx + q2 * gz - q3 * gy;
+	float y = q2 + q0 * gy - q1 * gz + q3 * gx;
+	float z = q3 + q0 * gz + q1 * gy - q2 * gx;
+	const float n = fusion::invSqrt(w * w + x * x + y * y + z * z);
+
+	q = Quaternion{w * n, x * n, y * n, z * n};
+}
+
+} /* namespace IMU */
@@ -0,0 +1,248 @@
+/*
+ * MPU9250_Fusion.h
+ *
+ *  Attitude estimation on the driver's samples, single precision throughout (M4F FPU).
+ *
+ *  Madgwick   gradient descent AHRS, 9 DoF, falls back to 6 DoF for a sample without mag.
+ *  Mahony     PI feedback on the accel/mag direction error, the integral is the gyro bias estimate.
+ *             Cheaper per update than Madgwick, the one for the low power boards. Same 6 DoF fallback.
+ *
+ *  The filters run in the body frame the driver was built with (Mount), gyro in rad/s, accel and mag
+ *  in any unit, only their direction is used. dt is measured from the sample stamps, secondsPerTick
+ *  is the Bus::ticks() period (1 / SystemCoreClock for the DWT buses, 1e-6 for LinuxI2CBus and SimBus).
+ *
+ *  The quaternion rotates body into earth, the earth frame is NWU (x magnetic north, z up) or NED
+ *  for a NED mounting, Euler angles are Z-Y-X in rad:
+ *
+ *  IMU::Madgwick ahrs(0.04f, 1.0f / SystemCoreClock, IMU::Earth::NED);
+ *  if(imu.GetLatest(s) && ahrs.Update(s)) { IMU::EulerAngles e = ahrs.GetEuler(); ... }
+ *
+ *  Polled, with the mag only where ReadMag had a new one:
+ *
+ *  bool fresh = imu.ReadMag(imu);
+ *  ahrs.Update(imu.ReadSample(), fresh);
+ */
+
+#ifndef MPU9250_FUSION_H_
+#define MPU9250_FUSION_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "MPU9250.h"
+
+/*
+ * Madgwick gain, ~ sqrt(3/4) * gyro noise in rad/s. Larger converges faster and trusts the gyro less.
+ */
+#ifndef MADGWICK_DEFAULT_BETA
+#define MADGWICK_DEFAULT_BETA	0.1f
+#endif
+
+/*
+ * A gap between two stamps longer than this is not integrated, the filter just restarts its clock.
+ */
+#ifndef FUSION_MAX_DT
+#define FUSION_MAX_DT			0.1f
+#endif
+
+/*
+ * Mahony gains, proportional in rad/s per unit direction error and integral in rad/s^2.
+ * The integral is clamped to MAHONY_MAX_BIAS (rad/s), above the MPU9250 zero rate offset (+-5 dps).
+ */
+#ifndef MAHONY_DEFAULT_KP
+#define MAHONY_DEFAULT_KP		1.0f
+#endif
+
+#ifndef MAHONY_DEFAULT_KI
+#define MAHONY_DEFAULT_KI		0.05f
+#endif
+
+#ifndef MAHONY_MAX_BIAS
+#define MAHONY_MAX_BIAS			0.175f
+#endif
+
+namespace IMU {
+
+struct Quaternion
+{
+	float w, x, y, z;
+};
+
+struct EulerAngles
+{
+	float roll, pitch, yaw;		/*rad*/
+};
+
+/*
+ * Earth frame of the estimate. Accel measures the reaction to gravity, up in NWU and -z in NED.
+ */
+enum class Earth : uint8_t
+{
+	NWU = 0,
+	NED
+};
+
+namespace fusion {
+
+/*
+ * 1/sqrt(x) for x > 0, bit trick seed plus one Newton step with tuned constants, relative error < 0.07%.
+ * VSQRT + VDIV cost ~28 cycles on the M4F, this is a handful of VMULs.
+ */
+inline float invSqrt(float x)
+{
+	uint32_t i;
+	float y;
+
+	memcpy(&i, &x, 4);
+	i = 0x5F1FFFF9u - (i >> 1);
+	memcpy(&y, &i, 4);
+
+	return y * 0.703952253f * (2.38924456f - x * y * y);
+}
+
+/*
+ * atan2 with a minimax odd polynomial on [0, 1] and octant folding, |error| < 1e-5 rad. One VDIV.
+ * atan2(0, 0) is 0.
+ */
+inline float fastAtan2(float y, float x)
+{
+	const float ax = x < 0.0f ? -x : x;
+	const float ay = y < 0.0f ? -y : y;
+	const float hi = ax > ay ? ax : ay;
+	const float lo = ax > ay ? ay : ax;
+
+	if(hi == 0.0f) return 0.0f;
+
+	const float t = lo / hi;
+	const float t2 = t * t;
+	float r = t * (0.99997726f + t2 * (-0.33262347f + t2 * (0.19354346f + t2 * (-0.11643287f + t2 * (0.05265332f + t2 * -0.01172120f)))));
+
+	if(ay > ax) r = 1.57079633f - r;
+	if(x < 0.0f) r = 3.14159265f - r;
+	return y < 0.0f ? -r : r;
+}
+
+/*
+ * asin, Abramowitz and Stegun 4.4.45, |error| < 7e-5 rad. x is clamped to [-1, 1].
+ */
+inline float fastAsin(float x)
+{
+	const bool neg = x < 0.0f;
+	float a = neg ? -x : x;
+	if(a > 1.0f) a = 1.0f;
+
+	const float r = 1.57079633f - sqrtf(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f + a * -0.0187293f)));
+	return neg ? -r : r;
+}
+
+EulerAngles toEuler(const Quaternion &q);
+
+/*
+ * Seconds between two stamps, wrap safe for one counter period.
+ */
+inline float elapsed(uint32_t from, uint32_t to, float secondsPerTick) { return float(uint32_t(to - from)) * secondsPerTick; }
+
+/*
+ * dt from consecutive sample stamps. step is false for the first stamp and after a gap
+ * longer than FUSION_MAX_DT (or a repeated stamp), that sample only restarts the clock.
+ */
+struct Clock
+{
+	float secondsPerTick;
+	uint32_t last;
+	bool set;
+
+	explicit Clock(float secondsPerTick) : secondsPerTick(secondsPerTick), last(0), set(false) {}
+
+	bool step(uint32_t stamp, float &dt)
+	{
+		dt = elapsed(last, stamp, secondsPerTick);
+		const bool ok = set && dt > 0.0f && dt <= FUSION_MAX_DT;
+
+		last = stamp;
+		set = true;
+
+		return ok;
+	}
+
+	void reset() { set = false; }
+};
+
+inline bool isZero(const float v[3]) { return v[0] == 0.0f && v[1] == 0.0f && v[2] == 0.0f; }
+
+} /* namespace fusion */
+
+
+class Madgwick
+{
+public:
+	explicit Madgwick(float beta = MADGWICK_DEFAULT_BETA, float secondsPerTick = 1e-6f, Earth earth = Earth::NWU);
+
+	/*
+	 * One step over dt seconds. mag may be nullptr or all zero, that step is accel and gyro only.
+	 */
+	void Update(const float gyr[3], const float acc[3], const float mag[3], float dt);
+
+	/*
+	 * dt from the stamp of the previous sample. The first sample, and the first after a gap longer
+	 * than FUSION_MAX_DT, only sets the clock and returns false. useMag = false ignores s.mag.
+	 */
+	bool Update(const MotionSample &s, bool useMag = true);
+
+	void Reset();
+	void SetBeta(float b) { beta = b; }
+
+	const Quaternion &GetQuaternion() const { return q; }
+	EulerAngles GetEuler() const { return fusion::toEuler(q); }
+
+private:
+	float beta;
+	Earth earth;
+
+	Quaternion q;
+	fusion::Clock clock;
+};
+
+
+class Mahony
+{
+public:
+	explicit Mahony(float kp = MAHONY_DEFAULT_KP, float ki = MAHONY_DEFAULT_KI, float secondsPerTick = 1e-6f, Earth earth = Earth::NWU);
+
+	/*
+	 * As Madgwick::Update. mag nullptr or all zero is the 6 DoF step, the accel only corrects roll and
+	 * pitch and the bias about the vertical is not observable, it keeps its last estimate.
+	 */
+	void Update(const float gyr[3], const float acc[3], const float mag[3], float dt);
+	bool Update(const MotionSample &s, bool useMag = true);
+
+	/*
+	 * Reset keeps the bias estimate, a restart converges faster with it. ResetBias clears it.
+	 */
+	void Reset();
+	void ResetBias();
+	void SetGains(float p, float i) { kp = p; ki = i; }
+
+	const Quaternion &GetQuaternion() const { return q; }
+	EulerAngles GetEuler() const { return fusion::toEuler(q); }
+
+	/*
+	 * Estimated gyro bias in rad/s, body frame. Subtract it from the driver's gyro or fold it into SetGyroCalibration.
+	 * At the default gains a constant bias is within 1e-3 rad/s after 100 s (test/test_mahony.cpp).
+	 */
+	void GetGyroBias(float out[3]) const;
+
+private:
+	float kp;
+	float ki;
+	Earth earth;
+
+	Quaternion q;
+	float integral[3];		/*added to the gyro, i.e. -bias*/
+	fusion::Clock clock;
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_FUSION_H_ */
@@ -0,0 +1,75 @@
+/*
+ * MPU9250_Heading.cpp
+ *
+ *  Tilt compensated heading, see MPU9250_Heading.h.
+ */
+
+#include "MPU9250_Heading.h"
+
+namespace IMU {
+
+static constexpr float TWO_PI = 6.28318531f;
+
+static float wrap(float a)
+{
+	if(a < 0.0f) a += TWO_PI;
+	if(a >= TWO_PI) a -= TWO_PI;
+	return a;
+}
+
+HeadingService::HeadingService(float declination, Earth earth)
+: declination(declination), earth(earth), accSum{0.0f, 0.0f, 0.0f}, accCount(0),
+  valid(false), magHeading(0.0f), heading(0.0f), roll(0.0f), pitch(0.0f), updates(0)
+{
+}
+
+void HeadingService::SetDeclination(float rad)
+{
+	declination = rad;
+	heading = wrap(magHeading + declination);
+}
+
+void HeadingService::Update(const float acc[3], const float mag[3], bool newMag)
+{
+	//Mean accel since the last mag sample, restarted if the mag stays away for too long
+	if(accCount == UINT16_MAX)
+	{
+		for(uint8_t i = 0; i < 3; i++) accSum[i] = 0.0f;
+		accCount = 0;
+	}
+
+	for(uint8_t i = 0; i < 3; i++) accSum[i] += acc[i];
+	accCount++;
+
+	if(!newMag || fusion::isZero(mag)) return;
+
+	const float a2 = accSum[0] * accSum[0] + accSum[1] * accSum[1] + accSum[2] * accSum[2];
+	if(a2 <= 0.0f) return;
+
+	//Up, the reaction to gravity points up whatever the body frame. Once per mag sample, so an exact
+	//normalisation, invSqrt's 0.07 % would show up in the asin near +-90 deg pitch.
+	const float n = 1.0f / sqrtf(a2);
+	const float u[3] = {accSum[0] * n, accSum[1] * n, accSum[2] * n};
+
+	for(uint8_t i = 0; i < 3; i++) accSum[i] = 0.0f;
+	accCount = 0;
+
+	//East = mag x up, north = up x east, both scaled by the horizontal field
+	const float e[3] = {mag[1] * u[2] - mag[2] * u[1], mag[2] * u[0] - mag[0] * u[2], mag[0] * u[1] - mag[1] * u[0]};
+	if(e[0] * e[0] + e[1] * e[1] + e[2] * e[2] <= 0.0f) return;
+
+	const float northX = u[1] * e[2] - u[2] * e[1];
+
+	magHeading = wrap(fusion::fastAtan2(e[0], northX));
+	heading = wrap(magHeading + declination);
+
+	//Earth z in the body, up for NWU and down for NED
+	const float zs = (earth == Earth::NED) ? -1.0f : 1.0f;
+	pitch = fusion::fastAsin(-zs * u[0]);
+	roll = fusion::fastAtan2(zs * u[1], zs * u[2]);
+
+	valid = true;
+	updates++;
+}
+
+} /* namespace IMU */
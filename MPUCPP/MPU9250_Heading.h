@@ -0,0 +1,73 @@
+/*
+ * MPU9250_Heading.h
+ *
+ *  Tilt compensated compass heading from accel and mag, no attitude filter needed.
+ *
+ *  The accel gives the up direction, the mag crossed with it gives east and up crossed with east
+ *  gives north, the heading is the body x axis against those, clockwise from north in [0, 2pi).
+ *  Roll and pitch come out alongside (Z-Y-X as in MPU9250_Fusion.h). All trig is fusion::fastAtan2 /
+ *  fusion::fastAsin, no libm.
+ *
+ *  The mag only changes at its ODR (100 Hz) while the navigation loop asks far more often, so the
+ *  result is computed once per new mag sample and cached. The accel in between is averaged, which
+ *  also takes the edge off vibration in the tilt:
+ *
+ *  IMU::HeadingService compass(IMU::HeadingService::degrees(4.5f));	//declination, east positive
+ *  bool fresh = imu.ReadMag(imu);
+ *  compass.Update(imu.ReadSample(), fresh);
+ *  float h = compass.Heading();
+ */
+
+#ifndef MPU9250_HEADING_H_
+#define MPU9250_HEADING_H_
+
+#include <stdint.h>
+
+#include "MPU9250_Fusion.h"
+
+namespace IMU {
+
+class HeadingService
+{
+public:
+	/*
+	 * Declination in rad, east positive. 0 gives magnetic heading.
+	 */
+	explicit HeadingService(float declination = 0.0f, Earth earth = Earth::NWU);
+
+	static constexpr float degrees(float deg) { return deg * 0.0174532925f; }
+
+	/*
+	 * Call with every sample, newMag = ReadMag's result (or SAMPLE_MAG for a batch). The heading is
+	 * only recomputed when newMag is set, otherwise the accel just goes into the average.
+	 */
+	void Update(const float acc[3], const float mag[3], bool newMag);
+	void Update(const MotionSample &s, bool newMag) { Update(s.acc, s.mag, newMag); }
+
+	/*
+	 * Applies to the cached heading right away, no new mag needed.
+	 */
+	void SetDeclination(float rad);
+
+	bool Valid() const { return valid; }
+	float Heading() const { return heading; }			/*rad, [0, 2pi)*/
+	float MagneticHeading() const { return magHeading; }	/*rad, [0, 2pi), without declination*/
+	float Roll() const { return roll; }					/*rad, of the last computation*/
+	float Pitch() const { return pitch; }
+	uint32_t Updates() const { return updates; }			/*number of recomputations*/
+
+private:
+	float declination;
+	Earth earth;
+
+	float accSum[3];
+	uint16_t accCount;
+
+	bool valid;
+	float magHeading, heading, roll, pitch;
+	uint32_t updates;
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_HEADING_H_ */
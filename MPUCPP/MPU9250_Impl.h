@@ -0,0 +1,886 @@
+/*
+ * MPU9250_Impl.h
+ *
+ *  Member definitions of IMU::MPU9250T, included at the end of MPU9250.h.
+ *
+ *  In the header so every Bus / Real / Mount / QueueLen / FifoBytes combination an application
+ *  names is instantiated where it is used, nothing has to be listed in MPU9250.cpp.
+ */
+
+#ifndef MPU9250_IMPL_H_
+#define MPU9250_IMPL_H_
+
+namespace IMU {
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::MPU9250T(Bus bus, MagMode magMode)
+:bus(std::move(bus)), acc{}, gyr{}, mag{}, temp(), magMode(Bus::isSPI ? MagMode::Master : magMode), aScale(MPU9250_DEFAULT_INIT.ascale), gScale(MPU9250_DEFAULT_INIT.gscale), mScale(MPU9250_DEFAULT_INIT.mscale), startupTicks(0), aCal{}, gCal{}, mCal{}, shadow{}, fifoBuf{}, fifoFrameSize(0), fifoOverflow(false),
+ dmaBuf{}, dmaSample{}, dmaFront(0), dmaSeq(0), dmaSeqRead(0), dmaState(DMAState::Idle),
+ intPin(0), irqMode(false), pendingStamp(0), deferred(false), deferredStamp(0), queue{}, qHead(0), qTail(0), dropped(0), roll_offset(), pitch_offset()
+{
+	const Real unity[3] = { Traits::value(1.0), Traits::value(1.0), Traits::value(1.0) };
+	const Real none[3] = {};
+	setCal(aCal, unity, none);
+	setCal(gCal, unity, none);
+	setCal(mCal, unity, none);
+	for(uint8_t i = 0; i < 3; i++) aCal.sens[i] = gCal.sens[i] = mCal.sens[i] = unity[i];
+	updateRes();
+
+#ifdef MPU9250_NO_HEAP
+	static_assert(std::is_trivially_destructible<MPU9250T>::value, "a static instance would register its destructor with atexit");
+#endif
+#ifdef MPU9250_RAM_BUDGET
+	static_assert(detail::RamBudget<sizeof(MPU9250T), MPU9250_RAM_BUDGET>::ok, "see detail::RamBudget");
+#endif
+
+	Init();
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::Init(){
+
+	bus.startTicks();
+	const uint32_t start = bus.ticks();
+	startupTicks = 0;
+
+	/*0-6. WHO_AM_I, reset, clock, 200Hz sample rate, 41/42Hz DLPFs, scales and the interrupt pin
+	 * from the compile time script, see makeInitScript for the register level comments.
+	 *7.Configure the magnetometer, RunInitScript follows the script with AK8963_Init
+	 */
+	if(!RunInitScript(initScripts[magMode == MagMode::Master])) return false;
+	//self_calibrate_accel_pressure(imu, 1000);
+
+	/*8.Wait for the first sample instead of assuming the gyro has started up*/
+	for(uint8_t waited = 0; !(readByte(MPU9250_ADDRESS, INT_STATUS) & INT_RAW_DATA_RDY); waited++)
+	{
+		if(waited >= MPU9250_BOOT_TIMEOUT_MS) return false;
+		bus.delayMs(1);
+	}
+
+	startupTicks = bus.ticks() - start;
+
+	return true;
+
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::RunInitScript(const InitScript &script)
+{
+	/*INT_PIN_CFG bypass and the SPI lock out come from the script, the mag path is fixed at construction*/
+	if(script.options.magMode != magMode || script.options.spi != Bus::isSPI) return false;
+
+	for(uint8_t i = 0; i < script.count; i++)
+	{
+		const InitStep &step = script.steps[i];
+		if(step.len) writeBytes(MPU9250_ADDRESS, step.subAddress, step.data, step.len);
+
+		if(step.pollMask == 0)
+		{
+			if(step.delayMs) bus.delayMs(step.delayMs);
+			continue;
+		}
+
+		/*A NACK (part still in reset) is not ready, whatever the buffer holds*/
+		uint8_t waited = 0, value = 0;
+		while(!readByte(MPU9250_ADDRESS, step.subAddress, value) || (value & step.pollMask) != step.pollValue)
+		{
+			if(waited++ >= step.delayMs) return false;
+			bus.delayMs(1);
+		}
+	}
+
+	aScale = script.options.ascale;
+	gScale = script.options.gscale;
+	mScale = script.options.mscale;
+	updateRes();
+
+	/*The script reset the part: pull SMPLRT_DIV .. INT_ENABLE into the shadow in one burst, runtime
+	 *changes are then a single write, and bring the AK8963 (and SLV0) back up at the script's mag scale
+	 */
+	SyncShadow();
+
+	return AK8963_Init();
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::AK8963_Init()
+{
+	/* 4.Mscale enable the 16bit resolution mode
+	 * Enable continous mode data acquisition Mmode = b'0110 @refer data sheet
+	 */
+	const uint8_t cntl = uint8_t((scaleIndex(mScale) << 4) | 0x06);
+
+	if(magMode == MagMode::Master)
+	{
+		/*0.Enable the internal I2C master at 400KHz, bypass is already off (intPinCfgBase)
+		 *  Shadow EXT_SENS_DATA so the host never sees half of a mag sample
+		 */
+		writeByte(MPU9250_ADDRESS, USER_CTRL, userCtrlBase());
+		writeByte(MPU9250_ADDRESS, I2C_MST_CTRL, I2C_MST_CLK_400KHZ);
+		writeByte(MPU9250_ADDRESS, I2C_MST_DELAY_CTRL, I2C_MST_DELAY_ES_SHADOW);
+	}
+
+	/*1.Make sure it is an AK8963 that answers*/
+	uint8_t id = 0;
+	if(magMode == MagMode::Master) readAK8963(AK8963_WHO_AM_I, id);
+	else id = readByte(AK8963_ADDRESS, AK8963_WHO_AM_I);
+
+	if(id != AK8963_WHO_AM_I_VALUE) return false;
+
+	/*2.Reset the Mag sensor
+	 *3.Fuse rom access mode
+	 */
+	if(!setAK8963Mode(0x00) || !setAK8963Mode(0x0F)) return false;
+
+	/*  Factory sensitivity adjustment, only readable in fuse ROM mode. Read once and folded into the
+	 *  mag scale factors: Hadj = H * ((ASA - 128) * 0.5 / 128 + 1) = H * (ASA + 128) / 256
+	 *  @refer register map pg 53
+	 */
+	uint8_t asa[3] = {128, 128, 128};
+	if(magMode == MagMode::Master)
+	{
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			if(!readAK8963(uint8_t(AK8963_ASAX + i), asa[i])) return false;
+		}
+	}
+	else if(!readBytes(AK8963_ADDRESS, AK8963_ASAX, asa, 3)) return false;
+
+	for(uint8_t i = 0; i < 3; i++) mCal.sens[i] = Traits::fromFixed(asa[magAxes.axis[i]] + 128, 8);
+	foldCal(mCal, mTable[scaleIndex(mScale)], magAxes);
+
+	/*4.Power doen Magnetometer
+	 *5.Continuous mode
+	 */
+	if(!setAK8963Mode(0x00) || !setAK8963Mode(cntl)) return false;
+
+	if(magMode == MagMode::Master)
+	{
+		/*6.SLV0 reads ST1..ST2 every sample into EXT_SENS_DATA_00..07, reading ST2 also releases the AK8963 data latch*/
+		writeByte(MPU9250_ADDRESS, I2C_SLV0_ADDR, I2C_SLV_READ | AK8963_ADDRESS_7BIT);
+		writeByte(MPU9250_ADDRESS, I2C_SLV0_REG, AK8963_ST1);
+		writeByte(MPU9250_ADDRESS, I2C_SLV0_CTRL, I2C_SLV_EN | AK8963_FETCH_LEN);
+	}
+
+	return true;
+}
+
+/*
+* NED system. Since positive Z axis points down aka fighitng against the gravity, use a negative sign or 
+* North, East, Down (NED), therefore up is -ve in z axis. Used specially in aerospace
+*/
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadAccel(MPU9250T &imu)
+{
+	uint8_t rawdata[6];
+	readBytes(MPU9250_ADDRESS, ACCEL_XOUT_H, rawdata, 6);
+
+	int16_t accX = (int16_t)((int16_t)rawdata[0] << 8 | rawdata[1]);
+	int16_t accY = (int16_t)((int16_t)rawdata[2] << 8 | rawdata[3]);
+	int16_t accZ = (int16_t)((int16_t)rawdata[4] << 8 | rawdata[5]);
+
+	//Follows the NED coordinate frame.
+	imu.acc[0] = pick(accAxes, 0, accX, accY, accZ) * aCal.k[0] + aCal.offset[0];
+	imu.acc[1] = pick(accAxes, 1, accX, accY, accZ) * aCal.k[1] + aCal.offset[1];
+	imu.acc[2] = pick(accAxes, 2, accX, accY, accZ) * aCal.k[2] + aCal.offset[2];
+	
+
+}
+
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadGyro(MPU9250T &imu)
+{
+	uint8_t rawdata[6];
+	readBytes(MPU9250_ADDRESS, GYRO_XOUT_H, rawdata, 6);
+
+	int16_t gyrX = (int16_t)((int16_t)rawdata[0] << 8 | rawdata[1]);
+	int16_t gyrY = (int16_t)((int16_t)rawdata[2] << 8 | rawdata[3]);
+	int16_t gyrZ = (int16_t)((int16_t)rawdata[4] << 8 | rawdata[5]);
+
+	imu.gyr[0] = pick(gyrAxes, 0, gyrX, gyrY, gyrZ) * gCal.k[0] + gCal.offset[0];
+	imu.gyr[1] = pick(gyrAxes, 1, gyrX, gyrY, gyrZ) * gCal.k[1] + gCal.offset[1];
+	imu.gyr[2] = pick(gyrAxes, 2, gyrX, gyrY, gyrZ) * gCal.k[2] + gCal.offset[2];
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadAll(MPU9250T &imu)
+{
+	uint8_t rawdata[MPU9250_MOTION_MAG_BURST_LEN];
+	readBytes(MPU9250_ADDRESS, ACCEL_XOUT_H, rawdata, motionBurstLen());
+
+	int16_t accX = (int16_t)((int16_t)rawdata[0] << 8 | rawdata[1]);
+	int16_t accY = (int16_t)((int16_t)rawdata[2] << 8 | rawdata[3]);
+	int16_t accZ = (int16_t)((int16_t)rawdata[4] << 8 | rawdata[5]);
+
+	int16_t tempRaw = (int16_t)((int16_t)rawdata[6] << 8 | rawdata[7]);
+
+	int16_t gyrX = (int16_t)((int16_t)rawdata[8] << 8 | rawdata[9]);
+	int16_t gyrY = (int16_t)((int16_t)rawdata[10] << 8 | rawdata[11]);
+	int16_t gyrZ = (int16_t)((int16_t)rawdata[12] << 8 | rawdata[13]);
+
+	imu.acc[0] = pick(accAxes, 0, accX, accY, accZ) * aCal.k[0] + aCal.offset[0];
+	imu.acc[1] = pick(accAxes, 1, accX, accY, accZ) * aCal.k[1] + aCal.offset[1];
+	imu.acc[2] = pick(accAxes, 2, accX, accY, accZ) * aCal.k[2] + aCal.offset[2];
+
+	imu.temp = tempRaw * tempRes + tempOffset;
+
+	imu.gyr[0] = pick(gyrAxes, 0, gyrX, gyrY, gyrZ) * gCal.k[0] + gCal.offset[0];
+	imu.gyr[1] = pick(gyrAxes, 1, gyrX, gyrY, gyrZ) * gCal.k[1] + gCal.offset[1];
+	imu.gyr[2] = pick(gyrAxes, 2, gyrX, gyrY, gyrZ) * gCal.k[2] + gCal.offset[2];
+
+	if(magMode == MagMode::Master)
+	{
+		decodeMag(&rawdata[MPU9250_MOTION_BURST_LEN], imu.mag);
+	}
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+typename MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::Sample MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::Snapshot() const
+{
+	Sample out{};
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		out.acc[i] = acc[i];
+		out.gyr[i] = gyr[i];
+		out.mag[i] = mag[i];
+	}
+	out.temp = temp;
+
+	return out;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+typename MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::Sample MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadSample()
+{
+	const uint32_t stamp = bus.ticks();
+	ReadAll(*this);
+
+	Sample out = Snapshot();
+	out.stamp = stamp;
+
+	return out;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SyncShadow()
+{
+	readBytes(MPU9250_ADDRESS, MPU9250_SHADOW_BASE, shadow, MPU9250_SHADOW_LEN);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetGyroScale(Gscale scale)
+{
+	gScale = scale;
+	foldCal(gCal, gTable[scaleIndex(scale)], gyrAxes);
+	updateReg(GYRO_CONFIG, 0x18 | 0x03, uint8_t(scaleIndex(scale) << 3)); //GFS, clears fchoice_b
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetAccelScale(Ascale scale)
+{
+	aScale = scale;
+	foldCal(aCal, aTable[scaleIndex(scale)], accAxes);
+	updateReg(ACCEL_CONFIG, 0x18, uint8_t(scaleIndex(scale) << 3));
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetAccelCalibration(const Real gain[3], const Real bias[3])
+{
+	setCal(aCal, gain, bias);
+	foldCal(aCal, aTable[scaleIndex(aScale)], accAxes);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetGyroCalibration(const Real gain[3], const Real bias[3])
+{
+	setCal(gCal, gain, bias);
+	foldCal(gCal, gTable[scaleIndex(gScale)], gyrAxes);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetMagCalibration(const Real gain[3], const Real bias[3])
+{
+	setCal(mCal, gain, bias);
+	foldCal(mCal, mTable[scaleIndex(mScale)], magAxes);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetGyroDLPF(uint8_t dlpfCfg)
+{
+	updateReg(CONFIG, 0x07, dlpfCfg & 0x07);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetAccelDLPF(uint8_t dlpfCfg)
+{
+	updateReg(ACCEL_CONFIG2, 0x0F, dlpfCfg & 0x0F); //accel_fchoice_b cleared, DLPF in use
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetSampleRateDiv(uint8_t div)
+{
+	updateReg(SMPLRT_DIV, 0xFF, div);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::SetDataReadyInt(bool enable)
+{
+	updateReg(INT_ENABLE, 0x01, enable ? 0x01 : 0x00);
+}
+
+/*
+ * FIFO frames are written in register order, ACCEL(6) TEMP(2) GYRO(6) @refer register map pg 16
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::EnableFIFO(bool withTemp)
+{
+	/*1.Stop the FIFO and flush whatever is left in it*/
+	writeByte(MPU9250_ADDRESS, FIFO_EN, 0x00);
+	writeByte(MPU9250_ADDRESS, USER_CTRL, userCtrlBase() | USER_CTRL_FIFO_RST);
+
+	/*2.Select the sensors that go into the FIFO*/
+	uint8_t sources = FIFO_EN_ACCEL | FIFO_EN_GYRO;
+	if(withTemp) sources |= FIFO_EN_TEMP;
+
+	fifoFrameSize = withTemp ? 14 : 12;
+	fifoOverflow = false;
+
+	/*3.Enable the FIFO overflow interrupt along with raw data ready so INT_STATUS reports it*/
+	writeByte(MPU9250_ADDRESS, INT_ENABLE, 0x01 | INT_FIFO_OFLOW);
+
+	writeByte(MPU9250_ADDRESS, USER_CTRL, userCtrlBase() | USER_CTRL_FIFO_EN);
+	writeByte(MPU9250_ADDRESS, FIFO_EN, sources);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::DisableFIFO()
+{
+	writeByte(MPU9250_ADDRESS, FIFO_EN, 0x00);
+	writeByte(MPU9250_ADDRESS, USER_CTRL, userCtrlBase() | USER_CTRL_FIFO_RST);
+	writeByte(MPU9250_ADDRESS, INT_ENABLE, 0x01);
+
+	fifoFrameSize = 0;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+uint16_t MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadFIFO(Sample *batch, uint16_t maxSamples)
+{
+	if(batch == nullptr) return 0;
+
+	uint16_t frames = drainFIFO(maxSamples);
+
+	for(uint16_t i = 0; i < frames; i++)
+	{
+		decodeFrame(&fifoBuf[i * fifoFrameSize], fifoFrameSize == 14, batch[i]);
+	}
+
+	return frames;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+uint16_t MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadFIFO(const batch::Columns<Real> &out, uint16_t maxSamples)
+{
+	uint16_t frames = drainFIFO(maxSamples);
+	if(frames) batch::decode(fifoBuf, frames, fifoFrameSize == 14, GetConversion(), out);
+
+	return frames;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+batch::Conversion<Real, typename MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::Scale> MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::GetConversion() const
+{
+	batch::Conversion<Real, Scale> conv{};
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		conv.k[batch::AX + i] = aCal.k[i];
+		conv.offset[batch::AX + i] = aCal.offset[i];
+		conv.src[batch::AX + i] = uint8_t(batch::AX + accAxes.axis[i]);
+		conv.k[batch::GX + i] = gCal.k[i];
+		conv.offset[batch::GX + i] = gCal.offset[i];
+		conv.src[batch::GX + i] = uint8_t(batch::GX + gyrAxes.axis[i]);
+	}
+	conv.k[batch::TEMP] = tempRes;
+	conv.offset[batch::TEMP] = tempOffset;
+
+	return conv;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+uint16_t MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::drainFIFO(uint16_t maxSamples)
+{
+	if(fifoFrameSize == 0 || maxSamples == 0) return 0;
+
+	/*1.Overflow check, the oldest frames were already overwritten so the stream is not contiguous*/
+	if(readByte(MPU9250_ADDRESS, INT_STATUS) & INT_FIFO_OFLOW)
+	{
+		writeByte(MPU9250_ADDRESS, USER_CTRL, userCtrlBase() | USER_CTRL_FIFO_EN | USER_CTRL_FIFO_RST);
+		fifoOverflow = true;
+		return 0;
+	}
+
+	/*2.Number of bytes available, FIFO_COUNTH holds bits 12:8*/
+	uint8_t count[2];
+	readBytes(MPU9250_ADDRESS, FIFO_COUNTH, count, 2);
+	uint16_t available = (uint16_t)(((count[0] & 0x1F) << 8) | count[1]);
+
+	/*3.Only drain whole frames, the partial one stays in the FIFO for the next call*/
+	uint16_t frames = available / fifoFrameSize;
+	if(frames > maxSamples) frames = maxSamples;
+	if(frames > FifoBytes / fifoFrameSize) frames = FifoBytes / fifoFrameSize;
+	if(frames == 0) return 0;
+
+	readBytes(MPU9250_ADDRESS, FIFO_R_W, fifoBuf, frames * fifoFrameSize);
+
+	fifoOverflow = false;
+	return frames;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::StartReadDMA()
+{
+	if constexpr (!Bus::hasAsync) return false;
+
+	if(dmaState == DMAState::Busy) return false;
+
+	registerIrqHook();
+	dmaState = DMAState::Busy;
+
+	if(!bus.startRead(MPU9250_ADDRESS, ACCEL_XOUT_H, dmaBuf, motionBurstLen()))
+	{
+		dmaState = DMAState::Error;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Runs in interrupt context. The back buffer is never the one GetLatest is pointed at,
+ * so the decode can take its time, the publish itself is a single index store.
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::OnDMAComplete()
+{
+	publishMotion();
+
+	if(irqMode && deferred)
+	{
+		deferred = false;
+		pendingStamp = deferredStamp;
+		irqRead();
+	}
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::publishMotion()
+{
+	uint8_t back = dmaFront ^ 1;
+	decodeFrame(dmaBuf, true, dmaSample[back]);
+	dmaSample[back].stamp = pendingStamp;
+
+	/*Mag only changes at its own ODR, carry the last one over when ST1 says nothing new*/
+	if(magMode == MagMode::Master && !decodeMag(&dmaBuf[MPU9250_MOTION_BURST_LEN], dmaSample[back].mag))
+	{
+		for(uint8_t i = 0; i < 3; i++) dmaSample[back].mag[i] = dmaSample[dmaFront].mag[i];
+	}
+	std::atomic_signal_fence(std::memory_order_release);
+
+	if(irqMode)
+	{
+		uint16_t next = (qHead + 1) & (QueueLen - 1);
+		if(next == qTail)
+		{
+			dropped = dropped + 1;
+		}
+		else
+		{
+			queue[qHead] = dmaSample[back];
+			std::atomic_signal_fence(std::memory_order_release);
+			qHead = next;
+		}
+	}
+
+	dmaFront = back;
+	dmaSeq = dmaSeq + 1;
+	dmaState = DMAState::Idle;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::OnDMAError()
+{
+	dmaState = DMAState::Error;
+	if(!irqMode) return;
+
+	/*Whether the failed burst got far enough to clear the latch is unknown, make sure*/
+	dropped = dropped + (deferred ? 2 : 1);
+	deferred = false;
+	readByte(MPU9250_ADDRESS, INT_STATUS);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::GetLatest(Sample &out)
+{
+	uint32_t seq;
+
+	/*Retry if a completion landed while copying, it may have reused the buffer being read*/
+	do
+	{
+		seq = dmaSeq;
+		std::atomic_signal_fence(std::memory_order_acquire);
+		out = dmaSample[dmaFront];
+		std::atomic_signal_fence(std::memory_order_acquire);
+	} while(seq != dmaSeq);
+
+	bool fresh = (seq != dmaSeqRead);
+	dmaSeqRead = seq;
+
+	return fresh;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::EnableDataReadyIRQ(uint16_t intPin)
+{
+	/*1.Counter for the sample stamps*/
+	bus.startTicks();
+
+	this->intPin = intPin;
+	qHead = qTail = 0;
+	dropped = 0;
+	deferred = false;
+	registerIrqHook();
+	irqMode = true;
+
+	/*2.Latched, active high, cleared by the motion burst itself @refer register map pg 29*/
+	writeByte(MPU9250_ADDRESS, INT_PIN_CFG, intPinCfgBase() | INT_PIN_CFG_ANYRD_2CLEAR);
+	writeByte(MPU9250_ADDRESS, INT_ENABLE, 0x01);
+
+	/*3.Clear whatever is latched so the next sample produces an edge*/
+	readByte(MPU9250_ADDRESS, INT_STATUS);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::DisableDataReadyIRQ()
+{
+	irqMode = false;
+	writeByte(MPU9250_ADDRESS, INT_PIN_CFG, intPinCfgBase());
+}
+
+/*
+ * Runs in the EXTI interrupt.
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::OnDataReady(uint16_t GPIO_Pin, uint32_t stamp)
+{
+	if(!irqMode || GPIO_Pin != intPin) return;
+
+	if(dmaState == DMAState::Busy)
+	{
+		/*The data registers only hold the newest sample, an older deferred edge is lost*/
+		if(deferred) dropped = dropped + 1;
+		deferredStamp = stamp;
+		deferred = true;
+		return;
+	}
+
+	pendingStamp = stamp;
+
+	/*At SPI data speed the whole burst is a few us, cheaper than setting up a DMA.
+	 *Buses without an async read take the same blocking path*/
+	if constexpr (Bus::isSPI || !Bus::hasAsync)
+	{
+		readBytes(MPU9250_ADDRESS, ACCEL_XOUT_H, dmaBuf, motionBurstLen());
+		publishMotion();
+		return;
+	}
+
+	else
+	{
+		irqRead();
+	}
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::irqRead()
+{
+	if(StartReadDMA()) return;
+
+	dropped = dropped + 1;
+	readByte(MPU9250_ADDRESS, INT_STATUS);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::PopSample(Sample &out)
+{
+	if(qTail == qHead) return false;
+
+	std::atomic_signal_fence(std::memory_order_acquire);
+	out = queue[qTail];
+	std::atomic_signal_fence(std::memory_order_release);
+	qTail = (qTail + 1) & (QueueLen - 1);
+
+	return true;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::ReadMag(MPU9250T &imu)
+{
+	/*Master mode, the MPU already fetched ST1..ST2, one read and no polling*/
+	if(magMode == MagMode::Master)
+	{
+		uint8_t ext[AK8963_FETCH_LEN];
+		readBytes(MPU9250_ADDRESS, EXT_SENS_DATA_00, ext, AK8963_FETCH_LEN);
+		return decodeMag(ext, imu.mag);
+	}
+
+	uint8_t rawdata[6];
+	/*Wait for Mag to be ready*/
+	if(readByte(AK8963_ADDRESS, AK8963_ST1) & 0x01)
+	{
+		readBytes(AK8963_ADDRESS, AK8963_XOUT_L, rawdata, 6);
+
+		/*Check the Overflow flag in the SR of AK8963
+		 * wait until it gets cleared
+		 * refer @ reference manual pg 50*/
+
+		if( !(readByte(AK8963_ADDRESS, AK8963_ST2) & 0x08))
+		{
+
+			int16_t magX = (int16_t)((int16_t)rawdata[1] << 8 | rawdata[0]);
+			int16_t magY = (int16_t)((int16_t)rawdata[3] << 8 | rawdata[2]);
+			int16_t magZ = (int16_t)((int16_t)rawdata[5] << 8 | rawdata[4]);
+
+			imu.mag[0] = pick(magAxes, 0, magX, magY, magZ) * mCal.k[0] + mCal.offset[0];
+			imu.mag[1] = pick(magAxes, 1, magX, magY, magZ) * mCal.k[1] + mCal.offset[1];
+			imu.mag[2] = pick(magAxes, 2, magX, magY, magZ) * mCal.k[2] + mCal.offset[2];
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////{HELPER_FUNCTIONS}/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Read-modify-write against the shadow, the device is only touched when the value actually changes.
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::updateReg(uint8_t subAddress, uint8_t clearMask, uint8_t setBits)
+{
+	uint8_t value = uint8_t((shadow[subAddress - MPU9250_SHADOW_BASE] & ~clearMask) | setBits);
+
+	if(value != shadow[subAddress - MPU9250_SHADOW_BASE]) writeByte(MPU9250_ADDRESS, subAddress, value);
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::writeAK8963(uint8_t subAddress, uint8_t data)
+{
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_ADDR, AK8963_ADDRESS_7BIT);
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_REG, subAddress);
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_DO, data);
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_CTRL, I2C_SLV_EN);
+
+	/*SLV4 runs once per sample period, give it a few*/
+	for(uint8_t i = 0; i < 20; i++)
+	{
+		if(readByte(MPU9250_ADDRESS, I2C_MST_STATUS) & I2C_MST_SLV4_DONE) return true;
+		bus.delayMs(1);
+	}
+
+	return false;
+}
+
+/*
+ * st1 points at ST1, HXL .. HZH, ST2 as fetched by SLV0 @refer reference manual pg 50
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::readAK8963(uint8_t subAddress, uint8_t &data)
+{
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_ADDR, I2C_SLV4_READ | AK8963_ADDRESS_7BIT);
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_REG, subAddress);
+	writeByte(MPU9250_ADDRESS, I2C_SLV4_CTRL, I2C_SLV_EN);
+
+	for(uint8_t i = 0; i < 20; i++)
+	{
+		if(readByte(MPU9250_ADDRESS, I2C_MST_STATUS) & I2C_MST_SLV4_DONE)
+		{
+			return readByte(MPU9250_ADDRESS, I2C_SLV4_DI, data);
+		}
+		bus.delayMs(1);
+	}
+
+	return false;
+}
+
+/*
+ * Writes CNTL and reads it back until the new mode shows up, instead of a fixed 1ms per change.
+ * The read back itself takes longer than the 100us the AK8963 needs between two modes.
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::setAK8963Mode(uint8_t mode)
+{
+	if(magMode == MagMode::Master)
+	{
+		if(!writeAK8963(AK8963_CNTL, mode)) return false;
+	}
+	else
+	{
+		writeByte(AK8963_ADDRESS, AK8963_CNTL, mode);
+	}
+
+	for(uint8_t waited = 0; waited < 10; waited++)
+	{
+		uint8_t readBack = 0;
+		const bool ok = (magMode == MagMode::Master) ? readAK8963(AK8963_CNTL, readBack)
+													 : readByte(AK8963_ADDRESS, AK8963_CNTL, readBack);
+
+		if(ok && readBack == mode) return true;
+		bus.delayMs(1);
+	}
+
+	return false;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+bool MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::decodeMag(const uint8_t *st1, Real *out)
+{
+	if(!(st1[0] & 0x01)) return false;	// DRDY
+	if(st1[7] & 0x08) return false;		// HOFL, magnetic sensor overflow
+
+	int16_t magX = (int16_t)((int16_t)st1[2] << 8 | st1[1]);
+	int16_t magY = (int16_t)((int16_t)st1[4] << 8 | st1[3]);
+	int16_t magZ = (int16_t)((int16_t)st1[6] << 8 | st1[5]);
+
+	out[0] = pick(magAxes, 0, magX, magY, magZ) * mCal.k[0] + mCal.offset[0];
+	out[1] = pick(magAxes, 1, magX, magY, magZ) * mCal.k[1] + mCal.offset[1];
+	out[2] = pick(magAxes, 2, magX, magY, magZ) * mCal.k[2] + mCal.offset[2];
+
+	return true;
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::decodeFrame(const uint8_t *raw, bool hasTemp, Sample &out)
+{
+	int16_t accX = (int16_t)((int16_t)raw[0] << 8 | raw[1]);
+	int16_t accY = (int16_t)((int16_t)raw[2] << 8 | raw[3]);
+	int16_t accZ = (int16_t)((int16_t)raw[4] << 8 | raw[5]);
+
+	out.acc[0] = pick(accAxes, 0, accX, accY, accZ) * aCal.k[0] + aCal.offset[0];
+	out.acc[1] = pick(accAxes, 1, accX, accY, accZ) * aCal.k[1] + aCal.offset[1];
+	out.acc[2] = pick(accAxes, 2, accX, accY, accZ) * aCal.k[2] + aCal.offset[2];
+
+	out.stamp = 0;
+	out.mag[0] = out.mag[1] = out.mag[2] = Real();
+
+	out.temp = Real();
+	if(hasTemp)
+	{
+		int16_t tempRaw = (int16_t)((int16_t)raw[6] << 8 | raw[7]);
+		out.temp = tempRaw * tempRes + tempOffset;
+		raw += 2;
+	}
+
+	int16_t gyrX = (int16_t)((int16_t)raw[6] << 8 | raw[7]);
+	int16_t gyrY = (int16_t)((int16_t)raw[8] << 8 | raw[9]);
+	int16_t gyrZ = (int16_t)((int16_t)raw[10] << 8 | raw[11]);
+
+	out.gyr[0] = pick(gyrAxes, 0, gyrX, gyrY, gyrZ) * gCal.k[0] + gCal.offset[0];
+	out.gyr[1] = pick(gyrAxes, 1, gyrX, gyrY, gyrZ) * gCal.k[1] + gCal.offset[1];
+	out.gyr[2] = pick(gyrAxes, 2, gyrX, gyrY, gyrZ) * gCal.k[2] + gCal.offset[2];
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::updateRes()
+{
+	foldCal(aCal, aTable[scaleIndex(aScale)], accAxes);
+	foldCal(gCal, gTable[scaleIndex(gScale)], gyrAxes);
+	foldCal(mCal, mTable[scaleIndex(mScale)], magAxes);
+}
+
+/*
+ * (sign * raw * res * sens - bias) * gain = raw * (res * sign * sens * gain) - bias * gain,
+ * the mounting sign and the factory trim cost nothing per sample
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::foldCal(AxisCal &cal, const Scale res, const AxisMap &axes)
+{
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		const Real g = cal.gain[i] * cal.sens[i];
+		cal.k[i] = res * (axes.sign[i] < 0 ? -g : g);
+		cal.offset[i] = -(cal.bias[i] * cal.gain[i]);
+	}
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::setCal(AxisCal &cal, const Real gain[3], const Real bias[3])
+{
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		cal.gain[i] = gain[i];
+		cal.bias[i] = bias[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////{IRQ_HOOKS}/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The HAL callbacks are plain C and shared by every instantiation, so the driver that armed
+ * an interrupt registers itself here. One indirect call per interrupt, none on the data path.
+ */
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::registerIrqHook()
+{
+	detail::irqHook.rxComplete = &MPU9250T::rxCompleteHook;
+	detail::irqHook.rxError = &MPU9250T::rxErrorHook;
+	detail::irqHook.dataReady = &MPU9250T::dataReadyHook;
+	std::atomic_signal_fence(std::memory_order_release);
+	detail::irqHook.owner = this;
+}
+
+#ifndef MPU9250_NO_HEAP
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::~MPU9250T()
+{
+	/*Another driver may have armed the interrupts since, its registration stays*/
+	if(detail::irqHook.owner == this) detail::irqHook.owner = nullptr;
+	std::atomic_signal_fence(std::memory_order_release);
+}
+#endif
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::rxCompleteHook(void *owner, const void *handle)
+{
+	MPU9250T *self = static_cast<MPU9250T*>(owner);
+
+	if constexpr (Bus::hasAsync)
+	{
+		if(self->bus.owns(handle)) self->OnDMAComplete();
+	}
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::rxErrorHook(void *owner, const void *handle)
+{
+	MPU9250T *self = static_cast<MPU9250T*>(owner);
+
+	if constexpr (Bus::hasAsync)
+	{
+		if(self->bus.owns(handle)) self->OnDMAError();
+	}
+}
+
+template<class Bus, typename Real, class Mount, uint16_t QueueLen, uint16_t FifoBytes>
+void MPU9250T<Bus, Real, Mount, QueueLen, FifoBytes>::dataReadyHook(void *owner, uint16_t GPIO_Pin, uint32_t stamp)
+{
+	static_cast<MPU9250T*>(owner)->OnDataReady(GPIO_Pin, stamp);
+}
+
+} /* namespace IMU */
+
+#endif /* MPU9250_IMPL_H_ */
@@ -0,0 +1,170 @@
+/*
+ * MPU9250_Init.h
+ *
+ *  Declarative init script for IMU::MPU9250T<Bus>.
+ *
+ *  The configuration is built at compile time from typed options into a list of
+ *  (register, data, post delay / poll condition) steps. Consecutive registers without a delay in
+ *  between are merged into one burst write, so SMPLRT_DIV .. ACCEL_CONFIG2 (0x19 - 0x1D) and
+ *  INT_PIN_CFG .. INT_ENABLE (0x37 - 0x38) each cost a single transaction.
+ *
+ *  static constexpr auto cfg = IMU::makeInitScript({Ascale::AFS_4G, Gscale::GFS_500DPS, Mscale::MFS_16BITS, 3, 3, 4, MagMode::Bypass, false});
+ *  imu.RunInitScript(cfg);
+ *
+ *  Included from MPU9250.h after the register map and the scale enums.
+ */
+
+#ifndef MPU9250_INIT_H_
+#define MPU9250_INIT_H_
+
+#include <stdint.h>
+
+#define MPU9250_INIT_MAX_STEPS 16
+#define MPU9250_INIT_MAX_BURST 8
+
+namespace IMU {
+
+/*
+ * Typed configuration the script is generated from.
+ */
+struct InitOptions
+{
+	Ascale ascale;
+	Gscale gscale;
+	Mscale mscale;
+	uint8_t gyroDLPF;		/*CONFIG DLPF_CFG, 0 - 7*/
+	uint8_t accelDLPF;		/*ACCEL_CONFIG2 A_DLPFCFG, 0 - 7*/
+	uint8_t sampleRateDiv;	/*Sample_rate = 1KHz/(1 + SMPLRT_DIV)*/
+	MagMode magMode;
+	bool spi;				/*Lock out the I2C slave interface first*/
+};
+
+/*
+ * len registers written from subAddress on in one burst, len 0 only polls.
+ * With pollMask set, subAddress is read back until (value & pollMask) == pollValue for at most delayMs ms,
+ * otherwise the step just waits delayMs after the write.
+ */
+struct InitStep
+{
+	uint8_t subAddress;
+	uint8_t len;
+	uint8_t data[MPU9250_INIT_MAX_BURST];
+	uint8_t pollMask;
+	uint8_t pollValue;
+	uint8_t delayMs;
+};
+
+struct InitScript
+{
+	InitStep steps[MPU9250_INIT_MAX_STEPS];
+	uint8_t count;
+	InitOptions options;	/*What the script was generated from, the driver decodes with these scales*/
+};
+
+/*
+ * 200Hz, 41/42Hz DLPF, +-250dps, +-2G, 16 bit mag. What the driver always used.
+ */
+inline constexpr InitOptions MPU9250_DEFAULT_INIT = {
+	Ascale::AFS_2G, Gscale::GFS_250DPS, Mscale::MFS_16BITS, 0x03, 0x03, 0x04, MagMode::Bypass, false
+};
+
+namespace detail {
+
+constexpr InitStep initWrite(uint8_t subAddress, uint8_t data, uint8_t delayMs = 0)
+{
+	InitStep step{};
+	step.subAddress = subAddress;
+	step.len = 1;
+	step.data[0] = data;
+	step.delayMs = delayMs;
+	return step;
+}
+
+/*
+ * Poll subAddress until (read & mask) == value, after writing data when write is set.
+ */
+constexpr InitStep initPoll(uint8_t subAddress, uint8_t mask, uint8_t value, bool write = false, uint8_t data = 0)
+{
+	InitStep step{};
+	step.subAddress = subAddress;
+	step.len = write ? 1 : 0;
+	step.data[0] = data;
+	step.pollMask = mask;
+	step.pollValue = value;
+	step.delayMs = MPU9250_BOOT_TIMEOUT_MS;
+	return step;
+}
+
+/*
+ * Appends a step, folding it into the previous one when it writes the next register up and
+ * nothing has to happen in between.
+ */
+constexpr void initAppend(InitScript &script, const InitStep &step)
+{
+	if(script.count > 0)
+	{
+		InitStep &last = script.steps[script.count - 1];
+
+		if(last.delayMs == 0 && last.pollMask == 0 && last.len > 0 && step.pollMask == 0 && step.len == 1 &&
+		   last.len < MPU9250_INIT_MAX_BURST && step.subAddress == last.subAddress + last.len)
+		{
+			last.data[last.len++] = step.data[0];
+			last.delayMs = step.delayMs;
+			return;
+		}
+	}
+
+	script.steps[script.count++] = step;
+}
+
+} /* namespace detail */
+
+constexpr InitScript makeInitScript(const InitOptions &opt)
+{
+	InitScript script{};
+	script.options = opt;
+
+	/* 0.Wait for the part to answer and be a MPU9250, instead of sleeping through the start-up time*/
+	detail::initAppend(script, detail::initPoll(WHO_AM_I_MPU9250, 0xFF, MPU9250_WHO_AM_I_VALUE));
+
+	/* 1.Reset all the sensors, H_RESET clears itself when done*/
+	detail::initAppend(script, detail::initPoll(PWR_MGMT_1, PWR_MGMT_1_H_RESET, 0x00, true, PWR_MGMT_1_H_RESET));
+
+	/* 2.On SPI lock out the I2C slave interface so a glitch on NCS can not switch the bus back,
+	 *   the reset cleared it. USER_CTRL and PWR_MGMT_1 are neighbours, one burst.
+	 */
+	if(opt.spi) detail::initAppend(script, detail::initWrite(USER_CTRL, USER_CTRL_I2C_IF_DIS));
+
+	/*   Power management and Crystal clock settings*/
+	detail::initAppend(script, detail::initWrite(PWR_MGMT_1, PWR_MGMT_1_CLKSEL_PLL));
+
+	/* 3.Configure the accel and gyro
+	 *   Sample_rate = gyro_output_rate/(1 + SMPLRT_DIV), DLPF_CFG sets the bandwidth @refer_datasheet pg 15
+	 * 4.Gyro/Accel scale with Fchoice = b'11 aka f_choice_b = b'00
+	 *   @refer register map pg 14.
+	 * 5.Accel DLPF, accel_fchoice_b = 0 @refer data_sheet pg 17
+	 */
+	detail::initAppend(script, detail::initWrite(SMPLRT_DIV, opt.sampleRateDiv));
+	detail::initAppend(script, detail::initWrite(CONFIG, opt.gyroDLPF & 0x07));
+	detail::initAppend(script, detail::initWrite(GYRO_CONFIG, uint8_t(scaleIndex(opt.gscale) << 3)));
+	detail::initAppend(script, detail::initWrite(ACCEL_CONFIG, uint8_t(scaleIndex(opt.ascale) << 3)));
+	detail::initAppend(script, detail::initWrite(ACCEL_CONFIG2, opt.accelDLPF & 0x0F));
+
+	/* 6.Configure the interrupt pins
+	 *   Interrupt for rasing edge and clears on read, bypass to the AK8963 unless the MPU's master reads it
+	 *   @refer reference manual pg 29
+	 */
+	detail::initAppend(script, detail::initWrite(INT_PIN_CFG, opt.magMode == MagMode::Master ? INT_PIN_CFG_LATCH_EN : (INT_PIN_CFG_LATCH_EN | INT_PIN_CFG_BYPASS_EN)));
+	detail::initAppend(script, detail::initWrite(INT_ENABLE, 0x01));
+
+	return script;
+}
+
+//WHO_AM_I, reset and clock stay separate, 0x19 - 0x1D and 0x37 - 0x38 are one burst each
+static_assert(makeInitScript(MPU9250_DEFAULT_INIT).count == 5, "init script did not coalesce");
+static_assert(makeInitScript(MPU9250_DEFAULT_INIT).steps[3].subAddress == SMPLRT_DIV &&
+			  makeInitScript(MPU9250_DEFAULT_INIT).steps[3].len == ACCEL_CONFIG2 - SMPLRT_DIV + 1, "config block is not one burst");
+
+} /* namespace IMU */
+
+#endif /* MPU9250_INIT_H_ */
@@ -0,0 +1,171 @@
+/*
+ * MPU9250_Matrix.h
+ *
+ *  Fixed size single precision matrices for the filters, sized at compile time and held by value.
+ *
+ *  No heap and no loops with run time bounds, every product unrolls to straight FPU code for the
+ *  sizes used (<= 9). Covariances are symmetric, the routines that produce one only compute the
+ *  upper triangle and mirror it, which also keeps them exactly symmetric in float.
+ *
+ *  la::Matrix<6, 6> P = la::Matrix<6, 6>::identity();
+ *  la::propagate(P, F, qDiag);				//P = F P F' + diag(q)
+ *  la::ScalarUpdate<6> u;
+ *  if(u.prepare(P, h, r, y) < gate) u.apply(P, y, dx);	//one measurement, P and the correction dx
+ */
+
+#ifndef MPU9250_MATRIX_H_
+#define MPU9250_MATRIX_H_
+
+#include <stdint.h>
+
+namespace IMU {
+namespace la {
+
+template<uint8_t R, uint8_t C>
+struct Matrix
+{
+	float m[R][C];
+
+	float &operator()(uint8_t r, uint8_t c) { return m[r][c]; }
+	float operator()(uint8_t r, uint8_t c) const { return m[r][c]; }
+
+	static Matrix zero()
+	{
+		Matrix a;
+		for(uint8_t r = 0; r < R; r++)
+			for(uint8_t c = 0; c < C; c++) a.m[r][c] = 0.0f;
+		return a;
+	}
+
+	static Matrix identity()
+	{
+		static_assert(R == C, "identity of a non square matrix");
+		Matrix a = zero();
+		for(uint8_t i = 0; i < R; i++) a.m[i][i] = 1.0f;
+		return a;
+	}
+};
+
+template<uint8_t R, uint8_t K, uint8_t C>
+Matrix<R, C> operator*(const Matrix<R, K> &a, const Matrix<K, C> &b)
+{
+	Matrix<R, C> out;
+
+	for(uint8_t r = 0; r < R; r++)
+	{
+		for(uint8_t c = 0; c < C; c++)
+		{
+			float s = 0.0f;
+			for(uint8_t k = 0; k < K; k++) s += a.m[r][k] * b.m[k][c];
+			out.m[r][c] = s;
+		}
+	}
+
+	return out;
+}
+
+template<uint8_t R, uint8_t C>
+Matrix<R, C> operator+(const Matrix<R, C> &a, const Matrix<R, C> &b)
+{
+	Matrix<R, C> out;
+	for(uint8_t r = 0; r < R; r++)
+		for(uint8_t c = 0; c < C; c++) out.m[r][c] = a.m[r][c] + b.m[r][c];
+	return out;
+}
+
+template<uint8_t R, uint8_t C>
+Matrix<R, C> operator-(const Matrix<R, C> &a, const Matrix<R, C> &b)
+{
+	Matrix<R, C> out;
+	for(uint8_t r = 0; r < R; r++)
+		for(uint8_t c = 0; c < C; c++) out.m[r][c] = a.m[r][c] - b.m[r][c];
+	return out;
+}
+
+template<uint8_t R, uint8_t C>
+Matrix<C, R> transpose(const Matrix<R, C> &a)
+{
+	Matrix<C, R> out;
+	for(uint8_t r = 0; r < R; r++)
+		for(uint8_t c = 0; c < C; c++) out.m[c][r] = a.m[r][c];
+	return out;
+}
+
+/*
+ * Upper triangle to lower.
+ */
+template<uint8_t N>
+void mirrorUpper(Matrix<N, N> &p)
+{
+	for(uint8_t r = 1; r < N; r++)
+		for(uint8_t c = 0; c < r; c++) p.m[r][c] = p.m[c][r];
+}
+
+/*
+ * P = F P F' + diag(q) for a symmetric P, half of the second product is skipped.
+ */
+template<uint8_t N>
+void propagate(Matrix<N, N> &p, const Matrix<N, N> &f, const float q[N])
+{
+	const Matrix<N, N> fp = f * p;
+
+	for(uint8_t r = 0; r < N; r++)
+	{
+		for(uint8_t c = r; c < N; c++)
+		{
+			float s = 0.0f;
+			for(uint8_t k = 0; k < N; k++) s += fp.m[r][k] * f.m[c][k];
+			p.m[r][c] = s;
+		}
+		p.m[r][r] += q[r];
+	}
+
+	mirrorUpper(p);
+}
+
+/*
+ * Kalman update for one scalar measurement with row h, noise variance r and innovation y.
+ * prepare returns the normalised innovation squared y^2 / s, the caller gates on it. apply adds the
+ * correction to dx and downdates P -= (P h')(P h')' / s over the upper triangle.
+ * A diagonal R processed one component at a time gives exactly the batch update, without an inverse,
+ * as long as each y is taken after the corrections of the components before it (y - h dx).
+ */
+template<uint8_t N>
+struct ScalarUpdate
+{
+	float ph[N];	/*P h'*/
+	float s;		/*innovation variance*/
+
+	float prepare(const Matrix<N, N> &p, const float h[N], float r, float y)
+	{
+		s = r;
+		for(uint8_t i = 0; i < N; i++)
+		{
+			float v = 0.0f;
+			for(uint8_t k = 0; k < N; k++) v += p.m[i][k] * h[k];
+			ph[i] = v;
+			s += h[i] * v;
+		}
+
+		return y * y / s;
+	}
+
+	void apply(Matrix<N, N> &p, float y, float dx[N]) const
+	{
+		const float inv = 1.0f / s;
+
+		for(uint8_t r = 0; r < N; r++)
+		{
+			const float k = ph[r] * inv;
+			dx[r] += k * y;
+			for(uint8_t c = r; c < N; c++) p.m[r][c] -= k * ph[c];
+		}
+
+		mirrorUpper(p);
+	}
+};
+
+} /* namespace la */
+} /* namespace IMU */
+
+#endif /* MPU9250_MATRIX_H_ */
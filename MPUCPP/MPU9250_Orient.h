@@ -0,0 +1,96 @@
+/*
+ * MPU9250_Orient.h
+ *
+ *  Board mounting for IMU::MPU9250T<Bus, Real, Mount>.
+ *
+ *  An AxisMap picks and signs the sensor axes, body[i] = sign[i] * sensor[axis[i]]. The driver takes
+ *  Mount::axes at compile time, folds the signs into its per axis scale factors and the permutation
+ *  into the decode indices, so a remapped sample costs exactly what an unmapped one does.
+ *  The mag gets the AK8963 to MPU alignment on top, it comes out in the same frame as accel and gyro.
+ *
+ *  A new mounting is a struct with a static constexpr AxisMap axes, it must be a rotation (checked):
+ *
+ *  struct RotatedZ90 { static constexpr IMU::AxisMap axes = {{1, 0, 2}, {-1, 1, 1}}; };
+ *  IMU::MPU9250T<IMU::I2CDMABus, float, RotatedZ90> imu(hi2c1);
+ *
+ *  Included from MPU9250.h.
+ */
+
+#ifndef MPU9250_ORIENT_H_
+#define MPU9250_ORIENT_H_
+
+#include <stdint.h>
+
+namespace IMU {
+
+struct AxisMap
+{
+	uint8_t axis[3];
+	int8_t sign[3];
+};
+
+/*
+ * outer after inner, out[i] = outer.sign[i] * inner.sign[outer.axis[i]] * in[inner.axis[outer.axis[i]]]
+ */
+constexpr AxisMap compose(const AxisMap &outer, const AxisMap &inner)
+{
+	AxisMap m{};
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		m.axis[i] = inner.axis[outer.axis[i]];
+		m.sign[i] = int8_t(outer.sign[i] * inner.sign[outer.axis[i]]);
+	}
+
+	return m;
+}
+
+/*
+ * +1 for a rotation, -1 for a mirror image, 0 if the axes are not a permutation.
+ */
+constexpr int determinant(const AxisMap &m)
+{
+	if(m.axis[0] > 2 || m.axis[1] > 2 || m.axis[2] > 2 ||
+	   m.axis[0] == m.axis[1] || m.axis[1] == m.axis[2] || m.axis[0] == m.axis[2]) return 0;
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		if(m.sign[i] != 1 && m.sign[i] != -1) return 0;
+	}
+
+	//Even permutations are the cyclic shifts of 0, 1, 2
+	const int parity = (m.axis[1] == (m.axis[0] + 1) % 3) ? 1 : -1;
+	return parity * m.sign[0] * m.sign[1] * m.sign[2];
+}
+
+inline constexpr AxisMap AXIS_IDENTITY = {{0, 1, 2}, {1, 1, 1}};
+
+/*
+ * AK8963 X and Y are swapped and Z points the other way compared to the accel/gyro @refer datasheet pg 38
+ */
+inline constexpr AxisMap AK8963_TO_MPU = {{1, 0, 2}, {1, 1, -1}};
+
+static_assert(determinant(AK8963_TO_MPU) == 1 && determinant(AXIS_IDENTITY) == 1, "alignment is not a rotation");
+
+/*
+ * Mountings. SensorFrame leaves the accel/gyro axes as they are.
+ * The NED ones are for a board with the chip X pointing forward, body z down.
+ */
+struct SensorFrame
+{
+	static constexpr AxisMap axes = AXIS_IDENTITY;
+};
+
+struct NEDFaceUp
+{
+	static constexpr AxisMap axes = {{0, 1, 2}, {1, -1, -1}};
+};
+
+struct NEDFaceDown
+{
+	static constexpr AxisMap axes = AXIS_IDENTITY;
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_ORIENT_H_ */
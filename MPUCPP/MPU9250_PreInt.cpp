@@ -0,0 +1,126 @@
+/*
+ * MPU9250_PreInt.cpp
+ *
+ *  Pre-integration, see MPU9250_PreInt.h.
+ */
+
+#include "MPU9250_PreInt.h"
+
+namespace IMU {
+
+static inline void cross(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+PreIntegrator::PreIntegrator(uint16_t decimation, float secondsPerTick)
+: decimation(decimation ? decimation : 1), count(0), elapsed(0.0f), stamp(0), havePrev(false), clock(secondsPerTick)
+{
+	Restart();
+}
+
+void PreIntegrator::Restart()
+{
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		alpha[i] = beta[i] = vel[i] = scul[i] = 0.0f;
+		lastDTheta[i] = lastDVel[i] = 0.0f;
+	}
+
+	count = 0;
+	elapsed = 0.0f;
+	havePrev = false;
+}
+
+bool PreIntegrator::Add(const MotionSample &s, Increment &out)
+{
+	float dt;
+	if(!clock.step(s.stamp, dt)) Restart();
+
+	stamp = s.stamp;
+	return Add(s.gyr, s.acc, dt, out);
+}
+
+bool PreIntegrator::Add(const float gyr[3], const float acc[3], float dt, Increment &out)
+{
+	if(!havePrev)
+	{
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			lastGyr[i] = gyr[i];
+			lastAcc[i] = acc[i];
+		}
+		havePrev = true;
+		return false;
+	}
+
+	float dTheta[3], dVel[3];
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		dTheta[i] = 0.5f * (gyr[i] + lastGyr[i]) * dt;
+		dVel[i] = 0.5f * (acc[i] + lastAcc[i]) * dt;
+	}
+
+	/*
+	 * Savage's two sample forms with the previous increment (rate and accel linear over two samples):
+	 * coning    beta += 1/2 (alpha + dTheta_prev / 6) x dTheta
+	 * sculling  scul += 1/2 ((alpha + dTheta_prev / 6) x dVel + (vel + dVel_prev / 6) x dTheta)
+	 */
+	float a[3], v[3];
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		a[i] = alpha[i] + lastDTheta[i] * (1.0f / 6.0f);
+		v[i] = vel[i] + lastDVel[i] * (1.0f / 6.0f);
+	}
+
+	float c[3], s1[3], s2[3];
+	cross(a, dTheta, c);
+	cross(a, dVel, s1);
+	cross(v, dTheta, s2);
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		beta[i] += 0.5f * c[i];
+		scul[i] += 0.5f * (s1[i] + s2[i]);
+
+		alpha[i] += dTheta[i];
+		vel[i] += dVel[i];
+
+		lastDTheta[i] = dTheta[i];
+		lastDVel[i] = dVel[i];
+		lastGyr[i] = gyr[i];
+		lastAcc[i] = acc[i];
+	}
+
+	elapsed += dt;
+	if(++count < decimation) return false;
+
+	emit(out);
+	return true;
+}
+
+void PreIntegrator::emit(Increment &out)
+{
+	//Rotation correction, the velocity sum is in the rotating frame, 1/2 alpha x vel brings it to the start
+	float rot[3];
+	cross(alpha, vel, rot);
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		out.dTheta[i] = alpha[i] + beta[i];
+		out.dVel[i] = vel[i] + 0.5f * rot[i] + scul[i];
+
+		alpha[i] = beta[i] = vel[i] = scul[i] = 0.0f;
+	}
+
+	out.dt = elapsed;
+	out.stamp = stamp;
+	out.samples = count;
+
+	count = 0;
+	elapsed = 0.0f;
+}
+
+} /* namespace IMU */
@@ -0,0 +1,113 @@
+/*
+ * MPU9250_PreInt.h
+ *
+ *  Gyro/accel pre-integration, full rate samples in, decimated delta angle / delta velocity out.
+ *
+ *  Every sample is integrated (trapezoidal) into the increment of the current interval with the
+ *  coning correction on the angle and the rotation plus sculling corrections on the velocity
+ *  (Savage, Strapdown Inertial Navigation Integration Algorithm Design, 1998). The increments are
+ *  exact under vibration that a plain sum of rates would turn into drift, so fusion and telemetry
+ *  can run at the output rate:
+ *
+ *  IMU::PreIntegrator pre(10, 1.0f / SystemCoreClock);		//1 kHz in, 100 Hz out
+ *  IMU::Increment inc;
+ *  if(imu.GetLatest(s) && pre.Add(s, inc)) ekf.Predict(rate, inc.dt);	//rate = inc.dTheta / inc.dt
+ *
+ *  dTheta is the rotation vector from the body at the start of the interval to the body at its end,
+ *  dVel the specific force velocity change in the start body frame (gravity is not removed).
+ */
+
+#ifndef MPU9250_PREINT_H_
+#define MPU9250_PREINT_H_
+
+#include <stdint.h>
+
+#include "MPU9250_Fusion.h"
+
+/*
+ * Samples per increment.
+ */
+#ifndef PREINT_DEFAULT_DECIMATION
+#define PREINT_DEFAULT_DECIMATION	10
+#endif
+
+namespace IMU {
+
+struct Increment
+{
+	float dTheta[3];	/*rad, coning corrected*/
+	float dVel[3];		/*m/s, rotation and sculling corrected*/
+	float dt;			/*s, interval length*/
+	uint32_t stamp;		/*stamp of the last sample in the interval*/
+	uint16_t samples;
+};
+
+class PreIntegrator
+{
+public:
+	explicit PreIntegrator(uint16_t decimation = PREINT_DEFAULT_DECIMATION, float secondsPerTick = 1e-6f);
+
+	/*
+	 * One sample, gyro in rad/s and accel in m/s^2, dt since the previous one. Returns true when
+	 * this sample completed an increment, it is in out and the next interval starts.
+	 */
+	bool Add(const float gyr[3], const float acc[3], float dt, Increment &out);
+
+	/*
+	 * dt from the stamps as in the filters. A gap restarts the current interval from scratch.
+	 */
+	bool Add(const MotionSample &s, Increment &out);
+
+	/*
+	 * A FIFO drain, the samples share their stamp so dt is the sample period. Walks the batch
+	 * columns in place, writes up to maxOut increments and returns how many.
+	 */
+	template<uint16_t Capacity>
+	uint16_t Add(const batch::SampleBatch<float, Capacity> &b, float samplePeriod, Increment *out, uint16_t maxOut)
+	{
+		uint16_t n = 0;
+
+		for(uint16_t i = 0; i < b.count && n < maxOut; i++)
+		{
+			if(b.flags[i] & batch::SAMPLE_GAP) Restart();
+
+			const float gyr[3] = {b.gyr[0][i], b.gyr[1][i], b.gyr[2][i]};
+			const float acc[3] = {b.acc[0][i], b.acc[1][i], b.acc[2][i]};
+
+			stamp = b.stamp[i];
+			if(Add(gyr, acc, samplePeriod, out[n])) n++;
+		}
+
+		return n;
+	}
+
+	/*
+	 * Drops the partial interval and the previous sample, the next sample starts fresh.
+	 */
+	void Restart();
+
+	void SetDecimation(uint16_t d) { decimation = d ? d : 1; }
+
+private:
+	void emit(Increment &out);
+
+	uint16_t decimation;
+	uint16_t count;
+	float elapsed;
+	uint32_t stamp;
+
+	float alpha[3];		/*sum of delta angles*/
+	float beta[3];		/*coning*/
+	float vel[3];		/*sum of delta velocities*/
+	float scul[3];		/*sculling*/
+
+	float lastGyr[3], lastAcc[3];		/*previous sample for the trapezoid*/
+	float lastDTheta[3], lastDVel[3];	/*previous increments for the 1/6 terms*/
+	bool havePrev;
+
+	fusion::Clock clock;
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_PREINT_H_ */
@@ -0,0 +1,90 @@
+/*
+ * MPU9250_Scale.h
+ *
+ *  Datasheet sensitivities for IMU::MPU9250T<Bus>, indexed by the full scale register field.
+ *
+ *  Everything here is constexpr, the driver builds its per count tables from it at compile time
+ *  and a scale change at run time is a table lookup. The static_asserts pin the tables to the
+ *  datasheet so a typo can not ship.
+ *
+ *  Included from MPU9250.h after the register map and the scale enums.
+ */
+
+#ifndef MPU9250_SCALE_H_
+#define MPU9250_SCALE_H_
+
+#include <stdint.h>
+
+namespace IMU {
+
+/*
+ * Accelerometer, LSB/g for +-2, 4, 8, 16 g (ACCEL_FS_SEL 00 - 11) @refer datasheet pg 9
+ */
+inline constexpr double ACCEL_LSB_PER_G[4] = {16384.0, 8192.0, 4096.0, 2048.0};
+inline constexpr uint16_t ACCEL_FULL_SCALE_G[4] = {2, 4, 8, 16};
+
+/*
+ * Gyro, LSB/(deg/s) for +-250, 500, 1000, 2000 dps (GYRO_FS_SEL 00 - 11) @refer datasheet pg 8
+ */
+inline constexpr double GYRO_LSB_PER_DPS[4] = {131.0, 65.5, 32.8, 16.4};
+inline constexpr uint16_t GYRO_FULL_SCALE_DPS[4] = {250, 500, 1000, 2000};
+
+/*
+ * Magnetometer, +-4912 uT over 8190 (14 bit) or 32760 (16 bit) counts (CNTL1 BIT) @refer datasheet pg 10, 50
+ */
+inline constexpr double MAG_FULL_SCALE_UT = 4912.0;
+inline constexpr double MAG_FULL_SCALE_LSB[2] = {8190.0, 32760.0};
+
+/*
+ * In double, not the float PI macro: the gyro tables are folded from it at compile time.
+ */
+inline constexpr double RAD_PER_DEG = 3.14159265358979323846 / 180.0;
+
+/*
+ * The enums run on from each other (0 - 3, 4 - 7, 8 - 9), this is the register field.
+ */
+constexpr uint8_t scaleIndex(Ascale scale) { return uint8_t(uint16_t(scale) - uint16_t(Ascale::AFS_2G)); }
+constexpr uint8_t scaleIndex(Gscale scale) { return uint8_t(uint16_t(scale) - uint16_t(Gscale::GFS_250DPS)); }
+constexpr uint8_t scaleIndex(Mscale scale) { return uint8_t(uint16_t(scale) - uint16_t(Mscale::MFS_14BITS)); }
+
+/*
+ * Output unit per count: m/s^2, rad/s and mG (1 uT = 10 mG).
+ */
+constexpr double perCount(Ascale scale) { return PHY_g / ACCEL_LSB_PER_G[scaleIndex(scale)]; }
+constexpr double perCount(Gscale scale) { return RAD_PER_DEG / GYRO_LSB_PER_DPS[scaleIndex(scale)]; }
+constexpr double perCount(Mscale scale) { return 10.0 * MAG_FULL_SCALE_UT / MAG_FULL_SCALE_LSB[scaleIndex(scale)]; }
+
+namespace detail {
+
+constexpr bool scaleNear(double x, double ref, double tol)
+{
+	return (x > ref ? x - ref : ref - x) <= tol * ref;
+}
+
+constexpr bool scaleTablesMatch()
+{
+	for(uint8_t i = 0; i < 4; i++)
+	{
+		//Full scale times sensitivity is the int16 range, exact for the accel, rounded in the datasheet for the gyro
+		if(ACCEL_LSB_PER_G[i] * ACCEL_FULL_SCALE_G[i] != 32768.0) return false;
+		if(!scaleNear(GYRO_LSB_PER_DPS[i] * GYRO_FULL_SCALE_DPS[i], 32768.0, 0.001)) return false;
+		if(i > 0 && ACCEL_LSB_PER_G[i - 1] != 2 * ACCEL_LSB_PER_G[i]) return false;
+	}
+
+	return scaleNear(MAG_FULL_SCALE_UT / MAG_FULL_SCALE_LSB[0], 0.6, 0.001) &&
+		   scaleNear(MAG_FULL_SCALE_UT / MAG_FULL_SCALE_LSB[1], 0.15, 0.001);
+}
+
+} /* namespace detail */
+
+static_assert(detail::scaleTablesMatch(), "sensitivity tables do not match the datasheet");
+static_assert(scaleIndex(Ascale::AFS_16G) == 3 && scaleIndex(Gscale::GFS_2000DPS) == 3 && scaleIndex(Mscale::MFS_16BITS) == 1,
+			  "scale enums no longer line up with the register fields");
+static_assert(detail::scaleNear(perCount(Ascale::AFS_2G), 9.80665 / 16384, 1e-6) &&
+			  detail::scaleNear(perCount(Mscale::MFS_16BITS), 1.5, 0.001), "unit conversion is off");
+static_assert(detail::scaleNear(perCount(Gscale::GFS_250DPS), 1.3323124061025417e-4, 1e-12) &&
+			  detail::scaleNear(perCount(Gscale::GFS_2000DPS) * 32768.0, 2000.0 * RAD_PER_DEG, 0.002), "gyro conversion is off");
+
+} /* namespace IMU */
+
+#endif /* MPU9250_SCALE_H_ */
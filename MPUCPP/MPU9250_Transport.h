@@ -0,0 +1,530 @@
+/*
+ * MPU9250_Transport.h
+ *
+ *  Transport policies for IMU::MPU9250T<Bus>.
+ *
+ *  Every policy provides the same non virtual interface, resolved at compile time:
+ *
+ *	void     write(Address, subAddress, data)				single register write
+ *	void     write(Address, subAddress, data, len)			burst write to consecutive registers
+ *	uint8_t  readByte(Address, subAddress)					single register read, 0 if the bus failed
+ *	bool     read(Address, subAddress, data, len)			burst read, false and data zeroed if the bus failed
+ *	bool     startRead(Address, subAddress, data, len)		async burst, only when hasAsync
+ *	void     delayMs(ms)
+ *	void     startTicks()									start the timestamp counter
+ *	uint32_t ticks()										free running timestamp counter
+ *
+ *	static constexpr bool isSPI		AK8963 is only reachable through the MPU's I2C master
+ *	static constexpr bool hasAsync	startRead completes via the driver's OnDMAComplete
+ *
+ *  Addresses are the left shifted 8 bit addresses used all over the driver (MPU9250_ADDRESS, AK8963_ADDRESS).
+ *  Included from MPU9250.h after the register map.
+ */
+
+#ifndef MPU9250_TRANSPORT_H_
+#define MPU9250_TRANSPORT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__) && !defined(USE_HAL_DRIVER)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#endif
+
+namespace IMU {
+
+#ifdef USE_HAL_DRIVER
+
+/*
+ * STM32 HAL, blocking I2C.
+ */
+class I2CBus {
+
+public:
+
+	static constexpr bool isSPI = false;
+	static constexpr bool hasAsync = false;
+
+	I2CBus(I2C_HandleTypeDef &hi2c) : hi2c(&hi2c) {}
+
+	void write(const uint8_t Address, const uint8_t subAddress, uint8_t data)
+	{
+		uint8_t txData[] = {subAddress, data};
+		HAL_I2C_Master_Transmit(hi2c, Address, txData, 2, MPU9250_I2C_TIMEOUT);
+	}
+
+	void write(const uint8_t Address, const uint8_t subAddress, const uint8_t *data, const uint16_t len)
+	{
+		HAL_I2C_Mem_Write(hi2c, Address, subAddress, I2C_MEMADD_SIZE_8BIT, const_cast<uint8_t*>(data), len, MPU9250_I2C_TIMEOUT);
+	}
+
+	uint8_t readByte(const uint8_t Address, const uint8_t subAddress)
+	{
+		uint8_t rxData[1] = {0};
+		uint8_t txData[] = {subAddress};
+		if(HAL_I2C_Master_Transmit(hi2c, Address, txData, 1, MPU9250_I2C_TIMEOUT) != HAL_OK) return 0;
+
+		if(HAL_I2C_Master_Receive(hi2c, Address, rxData, 1, MPU9250_I2C_TIMEOUT) != HAL_OK) return 0;
+
+		return rxData[0];
+	}
+
+	bool read(const uint8_t Address, const uint8_t subAddress, uint8_t *data, const uint16_t len)
+	{
+		if(HAL_I2C_Mem_Read(hi2c, Address, subAddress, I2C_MEMADD_SIZE_8BIT, data, len, MPU9250_I2C_TIMEOUT) == HAL_OK) return true;
+
+		memset(data, 0, len);
+		return false;
+	}
+
+	bool startRead(const uint8_t, const uint8_t, uint8_t *, const uint16_t) { return false; }
+
+	void delayMs(uint32_t ms) { HAL_Delay(ms); }
+
+	void startTicks()
+	{
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	uint32_t ticks() const { return DWT->CYCCNT; } /* core clock cycles */
+
+	bool owns(const void *handle) const { return handle == hi2c; }
+
+protected:
+
+	I2C_HandleTypeDef *hi2c; /* Handle to the I2C peripheral */
+};
+
+/*
+ * STM32 HAL, I2C with the motion burst on DMA (HAL_I2C_Mem_Read_DMA).
+ * Needs the I2C1_RX stream linked in HAL_I2C_MspInit.
+ */
+class I2CDMABus : public I2CBus {
+
+public:
+
+	static constexpr bool hasAsync = true;
+
+	I2CDMABus(I2C_HandleTypeDef &hi2c) : I2CBus(hi2c) {}
+
+	bool startRead(const uint8_t Address, const uint8_t subAddress, uint8_t *data, const uint16_t len)
+	{
+		return HAL_I2C_Mem_Read_DMA(hi2c, Address, subAddress, I2C_MEMADD_SIZE_8BIT, data, len) == HAL_OK;
+	}
+};
+
+#ifdef HAL_SPI_MODULE_ENABLED
+/*
+ * STM32 HAL, SPI.
+ *
+ * NCS (csPort/csPin) is driven here, configure it as a push-pull output, idle high.
+ * Configuration registers run on slowPrescaler (<= 1MHz), bursts of the sensor/interrupt registers
+ * (INT_STATUS .. EXT_SENS_DATA, FIFO) on fastPrescaler (<= 20MHz) @refer datasheet pg 10.
+ * Pick them for the SPI kernel clock e.g. APB2 84MHz -> /128 = 656KHz and /8 = 10.5MHz.
+ *
+ * Only built with HAL_SPI_MODULE_ENABLED. The Cube project in MPU9250/ has SPI off and does not ship
+ * the driver. Enable the SPI peripheral in the .ioc, or by hand: add stm32f4xx_hal_spi.c/.h from
+ * STM32CubeF4 to Drivers/STM32F4xx_HAL_Driver and uncomment HAL_SPI_MODULE_ENABLED in
+ * stm32f4xx_hal_conf.h. test/hal stands in for it on the host (test_spi).
+ */
+class SPIBus {
+
+public:
+
+	static constexpr bool isSPI = true;
+	static constexpr bool hasAsync = false;
+
+	SPIBus(SPI_HandleTypeDef &hspi, GPIO_TypeDef *csPort, uint16_t csPin,
+		   uint32_t slowPrescaler = SPI_BAUDRATEPRESCALER_128, uint32_t fastPrescaler = SPI_BAUDRATEPRESCALER_8)
+	: hspi(&hspi), csPort(csPort), csPin(csPin), slowPrescaler(slowPrescaler), fastPrescaler(fastPrescaler), fast(true)
+	{
+		HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
+		setSpeed(false);
+	}
+
+	void write(const uint8_t, const uint8_t subAddress, uint8_t data)
+	{
+		transfer(subAddress & ~MPU9250_SPI_READ, &data, 1, false);
+	}
+
+	void write(const uint8_t, const uint8_t subAddress, const uint8_t *data, const uint16_t len)
+	{
+		transfer(subAddress & ~MPU9250_SPI_READ, const_cast<uint8_t*>(data), len, false);
+	}
+
+	uint8_t readByte(const uint8_t, const uint8_t subAddress)
+	{
+		uint8_t rxData[1] = {0};
+		read(MPU9250_ADDRESS, subAddress, rxData, 1);
+		return rxData[0];
+	}
+
+	bool read(const uint8_t, const uint8_t subAddress, uint8_t *data, const uint16_t len)
+	{
+		if(transfer(subAddress | MPU9250_SPI_READ, data, len, true)) return true;
+
+		memset(data, 0, len);
+		return false;
+	}
+
+	bool startRead(const uint8_t, const uint8_t, uint8_t *, const uint16_t) { return false; }
+
+	void delayMs(uint32_t ms) { HAL_Delay(ms); }
+
+	void startTicks()
+	{
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	uint32_t ticks() const { return DWT->CYCCNT; } /* core clock cycles */
+
+	static bool isDataRegister(const uint8_t subAddress)
+	{
+		return (subAddress >= INT_STATUS && subAddress <= EXT_SENS_DATA_23) || subAddress == FIFO_COUNTH || subAddress == FIFO_R_W;
+	}
+
+private:
+
+	/*
+	 * One NCS framed transaction, first byte is the register address with bit 7 set for reads.
+	 * The register address is clocked with HAL_SPI_TransmitReceive, the payload follows in the same frame.
+	 * False if either half failed, NCS is released in any case.
+	 */
+	bool transfer(uint8_t first, uint8_t *data, const uint16_t len, bool isRead)
+	{
+		setSpeed(isRead && isDataRegister(first & ~MPU9250_SPI_READ));
+
+		uint8_t status;
+		HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_RESET);
+		bool ok = HAL_SPI_TransmitReceive(hspi, &first, &status, 1, MPU9250_SPI_TIMEOUT) == HAL_OK;
+
+		if(ok && isRead) ok = HAL_SPI_Receive(hspi, data, len, MPU9250_SPI_TIMEOUT) == HAL_OK;
+		else if(ok)		 ok = HAL_SPI_Transmit(hspi, data, len, MPU9250_SPI_TIMEOUT) == HAL_OK;
+
+		HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
+		return ok;
+	}
+
+	/*
+	 * Reprograms the baud rate prescaler only when it changes, BR can only be written with SPE cleared.
+	 */
+	void setSpeed(bool toFast)
+	{
+		if(toFast == fast) return;
+
+		__HAL_SPI_DISABLE(hspi);
+		MODIFY_REG(hspi->Instance->CR1, SPI_CR1_BR, toFast ? fastPrescaler : slowPrescaler);
+		__HAL_SPI_ENABLE(hspi);
+
+		fast = toFast;
+	}
+
+	SPI_HandleTypeDef *hspi;
+	GPIO_TypeDef *csPort;
+	uint16_t csPin;
+	uint32_t slowPrescaler;
+	uint32_t fastPrescaler;
+	bool fast;		/*Prescaler currently programmed*/
+};
+#endif /* HAL_SPI_MODULE_ENABLED */
+
+#endif /* USE_HAL_DRIVER */
+
+
+#if defined(__linux__) && !defined(USE_HAL_DRIVER)
+/*
+ * Linux i2c-dev, e.g. LinuxI2CBus("/dev/i2c-1").
+ * Register reads use a single I2C_RDWR with a repeated start, same as HAL_I2C_Mem_Read.
+ *
+ * Owns the file descriptor, closed in the destructor, so it is move only. Hand it to the driver
+ * as an rvalue: MPU9250T<LinuxI2CBus> imu(LinuxI2CBus("/dev/i2c-1")).
+ * A device that does not open leaves isOpen() false and error() at the errno of open(), every access
+ * then fails without touching the bus (reads return 0, Init returns false on WHO_AM_I).
+ * error() keeps the errno of the last failed access, EMSGSIZE for a burst write over MPU9250_INIT_MAX_BURST.
+ */
+class LinuxI2CBus {
+
+public:
+
+	static constexpr bool isSPI = false;
+	static constexpr bool hasAsync = false;
+
+	explicit LinuxI2CBus(const char *device) : fd(open(device, O_RDWR)), err(fd < 0 ? errno : 0) {}
+
+	~LinuxI2CBus() { if(fd >= 0) close(fd); }
+
+	LinuxI2CBus(const LinuxI2CBus &) = delete;
+	LinuxI2CBus& operator=(const LinuxI2CBus &) = delete;
+
+	LinuxI2CBus(LinuxI2CBus &&other) : fd(other.fd), err(other.err) { other.fd = -1; }
+
+	LinuxI2CBus& operator=(LinuxI2CBus &&other)
+	{
+		if(this != &other)
+		{
+			if(fd >= 0) close(fd);
+			fd = other.fd;
+			err = other.err;
+			other.fd = -1;
+		}
+		return *this;
+	}
+
+	void write(const uint8_t Address, const uint8_t subAddress, uint8_t data)
+	{
+		uint8_t txData[] = {subAddress, data};
+		i2c_msg msg = {uint16_t(Address >> 1), 0, 2, txData};
+		transfer(&msg, 1);
+	}
+
+	void write(const uint8_t Address, const uint8_t subAddress, const uint8_t *data, const uint16_t len)
+	{
+		//Nothing of a too long burst is written, a truncated one would leave the registers half set
+		if(len > MPU9250_INIT_MAX_BURST)
+		{
+			err = EMSGSIZE;
+			return;
+		}
+
+		uint8_t txData[1 + MPU9250_INIT_MAX_BURST];
+		txData[0] = subAddress;
+		memcpy(txData + 1, data, len);
+		i2c_msg msg = {uint16_t(Address >> 1), 0, uint16_t(1 + len), txData};
+		transfer(&msg, 1);
+	}
+
+	uint8_t readByte(const uint8_t Address, const uint8_t subAddress)
+	{
+		uint8_t rxData = 0;
+		read(Address, subAddress, &rxData, 1);
+		return rxData;
+	}
+
+	bool read(const uint8_t Address, const uint8_t subAddress, uint8_t *data, const uint16_t len)
+	{
+		uint8_t reg = subAddress;
+		i2c_msg msgs[2] = {
+			{uint16_t(Address >> 1), 0, 1, &reg},
+			{uint16_t(Address >> 1), I2C_M_RD, len, data},
+		};
+		if(transfer(msgs, 2)) return true;
+
+		memset(data, 0, len);
+		return false;
+	}
+
+	bool startRead(const uint8_t, const uint8_t, uint8_t *, const uint16_t) { return false; }
+
+	void delayMs(uint32_t ms) { usleep(ms * 1000); }
+
+	void startTicks() {}
+
+	uint32_t ticks() const /* microseconds */
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return uint32_t(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+	}
+
+	bool isOpen() const { return fd >= 0; }
+	int error() const { return err; }	/*errno of the last failure, 0 if none*/
+
+private:
+
+	bool transfer(i2c_msg *msgs, uint32_t count)
+	{
+		if(fd < 0)
+		{
+			err = EBADF;
+			return false;
+		}
+
+		i2c_rdwr_ioctl_data xfer = {msgs, count};
+		if(ioctl(fd, I2C_RDWR, &xfer) < 0)
+		{
+			err = errno;
+			return false;
+		}
+		return true;
+	}
+
+	int fd;
+	int err;
+};
+#endif
+
+
+/*
+ * Simulated register file for host side runs and benchmarks.
+ *
+ * Holds the MPU9250 (128 registers) and the AK8963 (0x00 - 0x12) register banks, auto increments
+ * on burst reads like the real part (except FIFO_R_W, which pops the simulated FIFO) and counts
+ * transactions and bytes on the bus. Time only moves when the driver delays.
+ *
+ * Cold start timeline: H_RESET stays set for resetUs, RAW_DATA_RDY comes up startupUs after the reset
+ * is done. SLV4 transactions to the AK8963 complete at once. Both latencies are 0 unless a test sets them.
+ *
+ * A full FIFO keeps the newest bytes as the part does, the oldest are overwritten and FIFO_OFLOW_INT
+ * is set in INT_STATUS until INT_STATUS is read.
+ */
+class SimBus {
+
+public:
+
+	static constexpr bool isSPI = false;
+	static constexpr bool hasAsync = false;
+
+	SimBus() : mpu{}, ak{}, fifo{}, fifoLen(0), transactions(0), bytes(0), now(0),
+			   resetUs(0), startupUs(0), resetDoneAt(0), dataReadyAt(0)
+	{
+		mpu[WHO_AM_I_MPU9250] = MPU9250_WHO_AM_I_VALUE;
+		mpu[PWR_MGMT_1] = PWR_MGMT_1_CLKSEL_PLL;
+		ak[AK8963_WHO_AM_I] = AK8963_WHO_AM_I_VALUE;
+		ak[AK8963_ASAX] = ak[AK8963_ASAY] = ak[AK8963_ASAZ] = 128; // Neutral sensitivity trim
+	}
+
+	void write(const uint8_t Address, const uint8_t subAddress, uint8_t data)
+	{
+		transactions++;
+		bytes += 2;
+		store(Address, subAddress, data);
+	}
+
+	void write(const uint8_t Address, const uint8_t subAddress, const uint8_t *data, const uint16_t len)
+	{
+		transactions++;
+		bytes += 1 + len;
+		for(uint16_t i = 0; i < len; i++) store(Address, uint8_t(subAddress + i), data[i]);
+	}
+
+	uint8_t readByte(const uint8_t Address, const uint8_t subAddress)
+	{
+		uint8_t rxData = 0;
+		read(Address, subAddress, &rxData, 1);
+		return rxData;
+	}
+
+	bool read(const uint8_t Address, const uint8_t subAddress, uint8_t *data, const uint16_t len)
+	{
+		transactions++;
+		bytes += 1 + len;
+
+		if(Address == MPU9250_ADDRESS && subAddress == FIFO_R_W)
+		{
+			uint16_t n = len < fifoLen ? len : fifoLen;
+			memcpy(data, fifo, n);
+			memmove(fifo, fifo + n, fifoLen - n);
+			fifoLen -= n;
+			return true;
+		}
+
+		if(Address == MPU9250_ADDRESS)
+		{
+			mpu[FIFO_COUNTH] = uint8_t(fifoLen >> 8);
+			mpu[FIFO_COUNTL] = uint8_t(fifoLen);
+
+			if(now < resetDoneAt) mpu[PWR_MGMT_1] |= PWR_MGMT_1_H_RESET;
+			else				  mpu[PWR_MGMT_1] &= ~PWR_MGMT_1_H_RESET;
+			if(now >= dataReadyAt) mpu[INT_STATUS] |= INT_RAW_DATA_RDY;
+		}
+
+		for(uint16_t i = 0; i < len; i++) data[i] = reg(Address, uint8_t(subAddress + i));
+
+		if(Address == MPU9250_ADDRESS && subAddress <= INT_STATUS && subAddress + len > INT_STATUS) mpu[INT_STATUS] &= ~INT_FIFO_OFLOW;
+		return true;
+	}
+
+	bool startRead(const uint8_t, const uint8_t, uint8_t *, const uint16_t) { return false; }
+
+	void delayMs(uint32_t ms) { now += ms * 1000; }
+
+	void startTicks() {}
+	uint32_t ticks() const { return now; } /* microseconds of simulated time */
+
+	/*
+	 * Test side access, does not count as bus traffic.
+	 */
+	uint8_t &reg(const uint8_t Address, const uint8_t subAddress)
+	{
+		return Address == AK8963_ADDRESS ? ak[subAddress & 0x1F] : mpu[subAddress & 0x7F];
+	}
+
+	void pushFIFO(const uint8_t *data, uint16_t len)
+	{
+		if(len > sizeof(fifo))
+		{
+			data += len - sizeof(fifo);
+			len = sizeof(fifo);
+			mpu[INT_STATUS] |= INT_FIFO_OFLOW;
+		}
+
+		if(fifoLen + len > sizeof(fifo))
+		{
+			const uint16_t lost = uint16_t(fifoLen + len - sizeof(fifo));
+			memmove(fifo, fifo + lost, fifoLen - lost);
+			fifoLen -= lost;
+			mpu[INT_STATUS] |= INT_FIFO_OFLOW;
+		}
+
+		memcpy(fifo + fifoLen, data, len);
+		fifoLen += len;
+	}
+
+	uint8_t mpu[128];
+	uint8_t ak[32];
+	uint8_t fifo[MPU9250_FIFO_SIZE];
+	uint16_t fifoLen;
+
+	uint32_t transactions;	/*Bus transactions issued by the driver*/
+	uint32_t bytes;			/*Register address + payload bytes on the bus*/
+	uint32_t now;
+
+	uint32_t resetUs;		/*H_RESET busy time*/
+	uint32_t startupUs;		/*Reset done to first RAW_DATA_RDY*/
+	uint32_t resetDoneAt;
+	uint32_t dataReadyAt;
+
+private:
+
+	/*
+	 * One register write and its side effects on the model.
+	 */
+	void store(const uint8_t Address, const uint8_t subAddress, uint8_t data)
+	{
+		reg(Address, subAddress) = data;
+
+		if(Address != MPU9250_ADDRESS) return;
+
+		if(subAddress == PWR_MGMT_1 && (data & PWR_MGMT_1_H_RESET))
+		{
+			memset(mpu, 0, sizeof(mpu));
+			mpu[WHO_AM_I_MPU9250] = MPU9250_WHO_AM_I_VALUE;
+			mpu[PWR_MGMT_1] = PWR_MGMT_1_CLKSEL_PLL;
+			fifoLen = 0;
+			resetDoneAt = now + resetUs;
+			dataReadyAt = resetDoneAt + startupUs;
+		}
+
+		if(subAddress == USER_CTRL && (data & USER_CTRL_FIFO_RST)) fifoLen = 0;
+
+		if(subAddress == I2C_SLV4_CTRL && (data & I2C_SLV_EN) && (mpu[I2C_SLV4_ADDR] & 0x7F) == AK8963_ADDRESS_7BIT)
+		{
+			uint8_t &akReg = ak[mpu[I2C_SLV4_REG] & 0x1F];
+			if(mpu[I2C_SLV4_ADDR] & I2C_SLV4_READ) mpu[I2C_SLV4_DI] = akReg;
+			else								   akReg = mpu[I2C_SLV4_DO];
+			mpu[I2C_MST_STATUS] |= I2C_MST_SLV4_DONE;
+		}
+	}
+};
+
+} /* namespace IMU */
+
+#endif /* MPU9250_TRANSPORT_H_ */
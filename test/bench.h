@@ -0,0 +1,134 @@
+/*
+ * bench.h
+ *
+ *  Host microbenchmarks. Nothing is checked and ctest does not run them, each prints a table of
+ *  ns per item, on x86 TSC ticks per item (the constant rate TSC, not core cycles) and core cycles
+ *  per item where Linux exposes the hardware cycle counter (perf_event_open, "-" in a VM without
+ *  one). The best of a few repeats is taken, run on an idle machine. Built with MPU_BENCHMARKS (on by
+ *  default):
+ *
+ *  cmake -S test -B build && cmake --build build && ./build/bench_convert
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+struct BenchResult
+{
+	double ns;		/*per item*/
+	double ticks;	/*per item, 0 without a TSC*/
+	double cycles;	/*core cycles per item, 0 without a cycle counter*/
+};
+
+/*
+ * Keeps the compiler from dropping a result nobody reads.
+ */
+template<typename T>
+inline void keep(const T &value)
+{
+	__asm__ volatile("" : : "g"(&value) : "memory");
+}
+
+inline uint64_t benchTicks()
+{
+#if BENCH_HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Core cycles of this thread in user space, 0 when there is no counter.
+ */
+inline uint64_t benchCycles()
+{
+#if defined(__linux__)
+	static const int fd = [] {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}();
+
+	uint64_t cycles = 0;
+	if(fd < 0 || read(fd, &cycles, sizeof(cycles)) != sizeof(cycles)) return 0;
+	return cycles;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Runs body() repeats times, body processes items items per call. Best run per item.
+ */
+template<class Body>
+BenchResult measure(uint64_t items, Body &&body, uint8_t repeats = 5)
+{
+	BenchResult best = {1e300, 1e300, 1e300};
+
+	for(uint8_t r = 0; r < repeats; r++)
+	{
+		const uint64_t k0 = benchCycles();
+		const auto t0 = std::chrono::steady_clock::now();
+		const uint64_t c0 = benchTicks();
+		body();
+		const uint64_t c1 = benchTicks();
+		const auto t1 = std::chrono::steady_clock::now();
+		const uint64_t k1 = benchCycles();
+
+		const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / double(items);
+		if(ns < best.ns) best = {ns, double(c1 - c0) / double(items), double(k1 - k0) / double(items)};
+	}
+
+	return best;
+}
+
+/*
+ * Title and column heads, item names what one item is (sample, frame, update ...).
+ */
+inline void reportHeader(const char *title, const char *item)
+{
+	char ns[24], ticks[24], cycles[24], rate[24];
+	snprintf(ns, sizeof(ns), "ns/%s", item);
+	snprintf(ticks, sizeof(ticks), "ticks/%s", item);
+	snprintf(cycles, sizeof(cycles), "cycles/%s", item);
+	snprintf(rate, sizeof(rate), "%ss/s", item);
+
+	printf("\n%s\n%-40s %12s %12s %13s %14s\n", title, "", ns, ticks, cycles, rate);
+}
+
+/*
+ * One line, rate is items per second derived from ns.
+ */
+inline void report(const char *name, const BenchResult &r)
+{
+	char cycles[24] = "-";
+	if(r.cycles > 0) snprintf(cycles, sizeof(cycles), "%.1f", r.cycles);
+
+	printf("%-40s %12.2f %12.1f %13s %14.0f\n", name, r.ns, r.ticks, cycles, 1e9 / r.ns);
+}
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,75 @@
+/*
+ * bench_batch.cpp
+ *
+ *  batch::decode against batch::decodeReference over 1k, 64k and 1M frames with temperature, float and
+ *  Q16, the driver's own conversion. 1k is a FIFO drain sized buffer in cache, 1M (14 MB in, 28 MB out)
+ *  an offline reprocessing pass from memory.
+ *
+ *  decode swaps the buffer in place, every pass swaps it back the other way. The work is the same,
+ *  the values are not, nothing is checked here (test_batch does).
+ */
+
+#include <vector>
+
+#include "bench.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint32_t SIZES[] = {1024, 65536, 1048576};
+static constexpr uint64_t WORK = 16u << 20;		/*frames per measurement, split into passes*/
+
+template<typename Real>
+static void run(const char *type, const std::vector<uint8_t> &frames, uint32_t n)
+{
+	MPU9250T<SimBus, Real> imu{SimBus()};
+	const auto conv = imu.GetConversion();
+
+	std::vector<uint8_t> raw(frames.begin(), frames.begin() + 14 * n);
+	std::vector<Real> out(uint64_t(batch::COLUMNS) * n);
+	batch::Columns<Real> cols;
+	for(uint8_t c = 0; c < batch::COLUMNS; c++) cols.col[c] = &out[uint64_t(c) * n];
+
+	const uint32_t passes = uint32_t(WORK / n);
+	char name[48];
+
+	snprintf(name, sizeof(name), "%s decodeReference", type);
+	report(name, measure(uint64_t(n) * passes, [&] {
+		for(uint32_t p = 0; p < passes; p++)
+		{
+			batch::decodeReference(raw.data(), n, true, conv, cols);
+			keep(out[0]);
+		}
+	}, 3));
+
+	snprintf(name, sizeof(name), "%s decode", type);
+	report(name, measure(uint64_t(n) * passes, [&] {
+		for(uint32_t p = 0; p < passes; p++)
+		{
+			batch::decode(raw.data(), n, true, conv, cols);
+			keep(out[0]);
+		}
+	}, 3));
+}
+
+int main()
+{
+	std::vector<uint8_t> frames(14u * SIZES[2]);
+	uint32_t state = 2468;
+	for(uint8_t &b : frames)
+	{
+		state = state * 1664525u + 1013904223u;
+		b = uint8_t(state >> 24);
+	}
+
+	for(uint32_t n : SIZES)
+	{
+		char title[48];
+		snprintf(title, sizeof(title), "Batch decode, %u frames", n);
+		reportHeader(title, "frame");
+		run<float>("float", frames, n);
+		run<fixed::Q16>("Q16", frames, n);
+	}
+
+	return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * bench_convert.cpp
+ *
+ *  Raw counts to a sample in double, float and Q16.16: accel, temp and gyro (7 values), raw * k + offset
+ *  per value with each driver's own GetConversion. Then ReadAll on SimBus, the same decode plus the
+ *  driver around it (burst, mag, bus model). Then the acquisition pipeline per sample, float against
+ *  Q16: conversion, calibrate (bias, gain) and a first order low pass on all 6 motion axes.
+ *  Last the calibrated conversion of the 6 motion axes folded into raw * k + offset, against the
+ *  getScale switch per axis it replaced with the calibration applied after it.
+ *
+ *  The host has a double precision FPU, so double costs about what float does here. The M4F only
+ *  has single precision and every double multiply there is a libgcc call: time convert() with
+ *  bus.ticks() (DWT CYCCNT) on target for the cycle counts the Real parameter is about.
+ */
+
+#include "bench.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint32_t FRAMES = 4096;
+static constexpr uint32_t PASSES = 256;
+static constexpr uint32_t SAMPLES = 200000;
+
+static uint8_t raw[FRAMES * 14];
+
+/*
+ * Deterministic frames, full int16 range.
+ */
+static void fill()
+{
+	uint32_t state = 12345;
+	for(uint8_t &b : raw)
+	{
+		state = state * 1664525u + 1013904223u;
+		b = uint8_t(state >> 24);
+	}
+}
+
+/*
+ * PASSES passes over the frames, one output value per column and frame.
+ */
+template<typename Real>
+static BenchResult convert()
+{
+	MPU9250T<SimBus, Real> imu{SimBus()};
+	const auto conv = imu.GetConversion();
+
+	static Real out[batch::COLUMNS][FRAMES];
+	const batch::Columns<Real> cols = {{out[0], out[1], out[2], out[3], out[4], out[5], out[6]}};
+
+	return measure(uint64_t(FRAMES) * PASSES, [&] {
+		for(uint32_t p = 0; p < PASSES; p++)
+		{
+			batch::decodeReference(raw, FRAMES, true, conv, cols);
+			keep(out);
+		}
+	});
+}
+
+template<typename Real>
+static BenchResult readAll()
+{
+	MPU9250T<SimBus, Real> imu{SimBus()};
+	const int16_t acc[3] = {100, -200, 300}, gyr[3] = {-1, 2, -3}, mag[3] = {40, 50, 60};
+	setMotion(imu.GetBus(), acc, 25, gyr);
+	setMag(imu.GetBus(), mag);
+
+	return measure(SAMPLES, [&] {
+		for(uint32_t i = 0; i < SAMPLES; i++) imu.ReadAll(imu);
+		keep(imu.Snapshot());
+	});
+}
+
+/*
+ * Float versions of calibrate and LowPass in MPU9250_Fixed.h, the same formulas. Q16 finds
+ * fixed::calibrate by argument lookup.
+ */
+static float calibrate(float x, float bias, float gain) { return (x - bias) * gain; }
+
+struct FloatLowPass
+{
+	float alpha;
+	float y;
+
+	float update(float x)
+	{
+		y += alpha * (x - y);
+		return y;
+	}
+};
+
+static FloatLowPass lowPass(float, double alpha) { return FloatLowPass{float(alpha), 0.0f}; }
+static fixed::LowPass lowPass(fixed::Q16, double alpha) { return fixed::LowPass{fixed::Q15::fromDouble(alpha), fixed::Q16()}; }
+
+template<typename Real>
+static BenchResult pipeline()
+{
+	using Traits = ScalarTraits<Real>;
+	static constexpr uint8_t AXES[6] = {batch::AX, batch::AY, batch::AZ, batch::GX, batch::GY, batch::GZ};
+
+	MPU9250T<SimBus, Real> imu{SimBus()};
+	const auto conv = imu.GetConversion();
+
+	decltype(lowPass(Real(), 0.0)) lp[6];
+	for(auto &f : lp) f = lowPass(Real(), 0.1);
+	const Real bias = Traits::value(0.01), gain = Traits::value(1.002);
+
+	Real out[6];
+	return measure(uint64_t(FRAMES) * PASSES, [&] {
+		for(uint32_t p = 0; p < PASSES; p++)
+		{
+			const uint8_t *frame = raw;
+			for(uint32_t i = 0; i < FRAMES; i++, frame += 14)
+			{
+				for(uint8_t a = 0; a < 6; a++)
+				{
+					const uint8_t c = AXES[a], w = conv.src[c];
+					const int16_t v = (int16_t)((int16_t)frame[2 * w] << 8 | frame[2 * w + 1]);
+					out[a] = lp[a].update(calibrate(v * conv.k[c] + conv.offset[c], bias, gain));
+				}
+			}
+			keep(out);
+		}
+	});
+}
+
+/*
+ * The old MPU9250::getScale, out of line in MPU9250.cpp and switched on the mixed scale enums per axis.
+ */
+__attribute__((noinline)) static float getScale(uint16_t scale)
+{
+	switch(scale)
+	{
+	case uint16_t(Ascale::AFS_2G):		return float(perCount(Ascale::AFS_2G));
+	case uint16_t(Ascale::AFS_4G):		return float(perCount(Ascale::AFS_4G));
+	case uint16_t(Ascale::AFS_8G):		return float(perCount(Ascale::AFS_8G));
+	case uint16_t(Ascale::AFS_16G):		return float(perCount(Ascale::AFS_16G));
+	case uint16_t(Gscale::GFS_250DPS):	return float(perCount(Gscale::GFS_250DPS));
+	case uint16_t(Gscale::GFS_500DPS):	return float(perCount(Gscale::GFS_500DPS));
+	case uint16_t(Gscale::GFS_1000DPS):	return float(perCount(Gscale::GFS_1000DPS));
+	case uint16_t(Gscale::GFS_2000DPS):	return float(perCount(Gscale::GFS_2000DPS));
+	case uint16_t(Mscale::MFS_14BITS):	return float(perCount(Mscale::MFS_14BITS));
+	case uint16_t(Mscale::MFS_16BITS):	return float(perCount(Mscale::MFS_16BITS));
+	default:							return 0.0f;
+	}
+}
+
+template<bool Folded>
+static BenchResult calibrated()
+{
+	MPU9250T<SimBus> imu{SimBus()};
+	const float gain[3] = {1.01f, 0.98f, 1.003f}, bias[3] = {0.12f, -0.3f, 0.05f};
+	imu.SetAccelCalibration(gain, bias);
+	imu.SetGyroCalibration(gain, bias);
+	const auto conv = imu.GetConversion();
+
+	volatile uint16_t scales[2] = {uint16_t(Ascale::AFS_2G), uint16_t(Gscale::GFS_250DPS)};
+	static constexpr uint8_t WORDS[6] = {0, 1, 2, 4, 5, 6};
+
+	float out[6];
+	return measure(uint64_t(FRAMES) * PASSES, [&] {
+		const uint16_t sensor[2] = {scales[0], scales[1]};
+		for(uint32_t p = 0; p < PASSES; p++)
+		{
+			const uint8_t *frame = raw;
+			for(uint32_t i = 0; i < FRAMES; i++, frame += 14)
+			{
+				for(uint8_t a = 0; a < 6; a++)
+				{
+					const uint8_t w = WORDS[a];
+					const int16_t v = (int16_t)((int16_t)frame[2 * w] << 8 | frame[2 * w + 1]);
+					if(Folded) out[a] = v * conv.k[a < 3 ? a : a + 1] + conv.offset[a < 3 ? a : a + 1];
+					else	   out[a] = (v * getScale(sensor[a / 3]) - bias[a % 3]) * gain[a % 3];
+				}
+				keep(out);
+			}
+		}
+	});
+}
+
+int main()
+{
+	fill();
+
+	reportHeader("Conversion, accel + temp + gyro", "sample");
+	report("double", convert<double>());
+	report("float", convert<float>());
+	report("fixed::Q16", convert<fixed::Q16>());
+
+	reportHeader("ReadAll on SimBus, motion + mag", "sample");
+	report("double", readAll<double>());
+	report("float", readAll<float>());
+	report("fixed::Q16", readAll<fixed::Q16>());
+
+	reportHeader("Convert, calibrate and low pass, 6 axes", "sample");
+	report("float", pipeline<float>());
+	report("fixed::Q16", pipeline<fixed::Q16>());
+
+	reportHeader("Calibrated conversion, 6 axes, float", "sample");
+	report("getScale switch, then calibration", calibrated<false>());
+	report("folded raw * k + offset", calibrated<true>());
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * bench_ekf.cpp
+ *
+ *  AttitudeEKF<false> (6 states) and <true> (9 states), Predict and the two measurement updates
+ *  timed apart, then the whole Update(MotionSample) step, on the 1 kHz trajectory of bench_fusion.
+ *
+ *  Predict runs along the trajectory. The updates are repeated on the sample the filter was aligned
+ *  to, so every one passes the gate and runs the full gain and covariance step: a rejected update
+ *  stops after the innovation and would time the cheap path. The rejected count printed after each
+ *  filter has to stay 0.
+ */
+
+#include "bench.h"
+#include "motion.h"
+#include "MPU9250_EKF.h"
+
+using namespace IMU;
+
+static constexpr uint32_t N = 4096;
+static constexpr uint32_t PASSES = 20;
+static constexpr float DT = 1e-3f;
+
+static MotionSample samples[N];
+
+static void fill()
+{
+	double g[3], b[3];
+	earthFields(Earth::NWU, g, b);
+
+	Quat truth = fromEuler(0.3, -0.2, 1.0);
+	for(uint32_t i = 0; i < N; i++)
+	{
+		const double t = i * 1e-3;
+		const double w[3] = {0.3 * sin(0.5 * t), 0.2 * cos(0.3 * t), 0.25 * sin(0.2 * t + 1.0)};
+		truth = truth * rotation(w[0] * 1e-3, w[1] * 1e-3, w[2] * 1e-3);
+
+		MotionSample &s = samples[i];
+		s = MotionSample{};
+		toBody(truth, g, s.acc);
+		toBody(truth, b, s.mag);
+		for(uint8_t k = 0; k < 3; k++) s.gyr[k] = float(w[k] + 0.01);
+		s.stamp = i * 1000;
+	}
+}
+
+template<bool AccelBias>
+static void run(const char *name)
+{
+	char title[64];
+	snprintf(title, sizeof(title), "%s, %u error states", name, unsigned(AttitudeEKF<AccelBias>::N));
+	reportHeader(title, "call");
+
+	const MotionSample &s0 = samples[0];
+	uint32_t rejected = 0;
+
+	{
+		AttitudeEKF<AccelBias> f;
+		f.Align(s0.acc, s0.mag);
+		report("Predict(gyr, dt)", measure(uint64_t(N) * PASSES, [&] {
+			for(uint32_t p = 0; p < PASSES; p++)
+			{
+				for(const MotionSample &s : samples) f.Predict(s.gyr, DT);
+				keep(f.GetCovariance());
+			}
+		}));
+	}
+	{
+		AttitudeEKF<AccelBias> f;
+		f.Align(s0.acc, s0.mag);
+		report("UpdateAccel(acc)", measure(uint64_t(N) * PASSES, [&] {
+			for(uint32_t i = 0; i < N * PASSES; i++) f.UpdateAccel(s0.acc);
+			keep(f.GetCovariance());
+		}));
+		rejected += f.Rejected();
+	}
+	{
+		AttitudeEKF<AccelBias> f;
+		f.Align(s0.acc, s0.mag);
+		report("UpdateHeading(mag)", measure(uint64_t(N) * PASSES, [&] {
+			for(uint32_t i = 0; i < N * PASSES; i++) f.UpdateHeading(s0.mag);
+			keep(f.GetCovariance());
+		}));
+		rejected += f.Rejected();
+	}
+	{
+		AttitudeEKF<AccelBias> f;
+		report("Update(MotionSample), all three", measure(uint64_t(N) * PASSES, [&] {
+			for(uint32_t p = 0; p < PASSES; p++)
+			{
+				for(const MotionSample &s : samples) f.Update(s);
+				keep(f.GetCovariance());
+			}
+		}));
+	}
+
+	printf("%-40s %12u\n", "rejected in the update runs", unsigned(rejected));
+}
+
+int main()
+{
+	fill();
+
+	run<false>("AttitudeEKF<false>");
+	run<true>("AttitudeEKF<true>");
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * bench_fixfmt.cpp
+ *
+ *  fixfmt_float against snprintf("%.*f") with 2 and 4 decimals, then the whole ACCEL record of main.c
+ *  with fixfmt_str / fixfmt_axes against one snprintf. Accelerations in g, as the console prints them.
+ *
+ *  On the host this is glibc's printf. On the M4 it would be newlib's float printf (_printf_float),
+ *  which pulls in its code and can allocate, time it there with DWT CYCCNT.
+ */
+
+#include "bench.h"
+
+extern "C" {
+#include "fixfmt.h"
+}
+
+static constexpr uint32_t VALUES = 4096;
+static constexpr uint32_t PASSES = 50;
+static constexpr uint8_t DECIMALS[] = {2, 4};
+
+static float values[VALUES];
+
+template<class Format>
+static BenchResult run(Format format)
+{
+	static char out[64];
+	return measure(uint64_t(VALUES) * PASSES, [&] {
+		for(uint32_t p = 0; p < PASSES; p++)
+		{
+			for(uint32_t i = 0; i < VALUES; i++) format(out, values[i]);
+			keep(out);
+		}
+	});
+}
+
+int main()
+{
+	uint32_t state = 97531;
+	for(float &v : values)
+	{
+		state = state * 1664525u + 1013904223u;
+		v = (int32_t(state) >> 8) * (4.0f / 8388608.0f);		/*+-4 g*/
+	}
+
+	for(uint8_t decimals : DECIMALS)
+	{
+		char title[48];
+		snprintf(title, sizeof(title), "One value, %u decimals", decimals);
+		reportHeader(title, "value");
+		report("snprintf", run([=](char *out, float x) { snprintf(out, 64, "%.*f", decimals, double(x)); }));
+		report("fixfmt_float", run([=](char *out, float x) { fixfmt_float(out, x, decimals); }));
+	}
+
+	reportHeader("ACCEL record, 3 axes, 2 decimals", "record");
+	report("snprintf", run([](char *out, float x) {
+		snprintf(out, 64, "ACCEL:: X: %.2f g, Y: %.2f g, Z: %.2f g C\r\n", double(x), double(-x), double(x * 0.5f));
+	}));
+	report("fixfmt_str / fixfmt_axes", run([](char *out, float x) {
+		const float v[3] = {x, -x, x * 0.5f};
+		char *p = out;
+		p += fixfmt_str(p, "ACCEL:: ");
+		p += fixfmt_axes(p, v, "g", 2);
+		p += fixfmt_str(p, " C\r\n");
+	}));
+
+	return 0;
+}
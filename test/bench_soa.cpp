@@ -0,0 +1,118 @@
+/*
+ * bench_soa.cpp
+ *
+ *  The AoS copy out (ReadFIFO into MotionSample[], then a kernel walking the structs) against the
+ *  SoA SampleBatch (ReadFIFO straight into the columns, the kernel walks contiguous arrays).
+ *  The kernel is |acc|^2 and |gyr|^2 per sample into an array, what a still detector does ahead of
+ *  a bias estimate. First the kernel alone on 4096 samples, then drain + kernel on SimBus, 36 frames
+ *  a drain.
+ */
+
+#include "bench.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint16_t N = 4096;
+static constexpr uint32_t PASSES = 2000;
+static constexpr uint16_t DRAIN = 36;		/*504 bytes, the FIFO holds 512*/
+static constexpr uint32_t DRAINS = 20000;
+
+static MotionSample aos[N];
+static batch::SampleBatch<float, N> soa;
+
+static float accNorm[N], gyrNorm[N];
+
+static void kernelAoS(const MotionSample *s, uint16_t n)
+{
+	for(uint16_t i = 0; i < n; i++)
+	{
+		accNorm[i] = s[i].acc[0] * s[i].acc[0] + s[i].acc[1] * s[i].acc[1] + s[i].acc[2] * s[i].acc[2];
+		gyrNorm[i] = s[i].gyr[0] * s[i].gyr[0] + s[i].gyr[1] * s[i].gyr[1] + s[i].gyr[2] * s[i].gyr[2];
+	}
+}
+
+template<uint16_t Capacity>
+static void kernelSoA(const batch::SampleBatch<float, Capacity> &b)
+{
+	for(uint16_t i = 0; i < b.count; i++)
+	{
+		accNorm[i] = b.acc[0][i] * b.acc[0][i] + b.acc[1][i] * b.acc[1][i] + b.acc[2][i] * b.acc[2][i];
+		gyrNorm[i] = b.gyr[0][i] * b.gyr[0][i] + b.gyr[1][i] * b.gyr[1][i] + b.gyr[2][i] * b.gyr[2][i];
+	}
+}
+
+static void pushFrames(SimBus &bus)
+{
+	static uint8_t frames[DRAIN * 14];
+	static bool filled = false;
+	if(!filled)
+	{
+		for(uint16_t i = 0; i < sizeof(frames); i++) frames[i] = uint8_t(i * 37);
+		filled = true;
+	}
+	bus.pushFIFO(frames, sizeof(frames));
+}
+
+int main()
+{
+	for(uint16_t i = 0; i < N; i++)
+	{
+		MotionSample s{};
+		for(uint8_t a = 0; a < 3; a++)
+		{
+			s.acc[a] = float(i % 17) * 0.1f + a;
+			s.gyr[a] = float(i % 5) * 0.01f - a;
+		}
+		aos[i] = s;
+		soa.push(s, 0);
+	}
+
+	reportHeader("Kernel, |acc|^2 and |gyr|^2", "sample");
+	report("AoS MotionSample[]", measure(uint64_t(N) * PASSES, [&] {
+		for(uint32_t p = 0; p < PASSES; p++)
+		{
+			kernelAoS(aos, N);
+			keep(accNorm);
+		}
+	}));
+	report("SoA SampleBatch", measure(uint64_t(N) * PASSES, [&] {
+		for(uint32_t p = 0; p < PASSES; p++)
+		{
+			kernelSoA(soa);
+			keep(accNorm);
+		}
+	}));
+
+	reportHeader("FIFO drain + kernel on SimBus", "sample");
+	{
+		MPU9250T<SimBus> imu{SimBus()};
+		imu.EnableFIFO(true);
+		static MotionSample out[DRAIN];
+		report("AoS ReadFIFO(MotionSample *)", measure(uint64_t(DRAIN) * DRAINS, [&] {
+			for(uint32_t d = 0; d < DRAINS; d++)
+			{
+				pushFrames(imu.GetBus());
+				kernelAoS(out, imu.ReadFIFO(out, DRAIN));
+				keep(accNorm);
+			}
+		}));
+	}
+	{
+		MPU9250T<SimBus> imu{SimBus()};
+		imu.EnableFIFO(true);
+		static batch::SampleBatch<float, DRAIN> out;
+		report("SoA ReadFIFO(SampleBatch &)", measure(uint64_t(DRAIN) * DRAINS, [&] {
+			for(uint32_t d = 0; d < DRAINS; d++)
+			{
+				pushFrames(imu.GetBus());
+				out.clear();
+				imu.ReadFIFO(out);
+				kernelSoA(out);
+				keep(accNorm);
+			}
+		}));
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * bench_spi.cpp
+ *
+ *  ReadAll (motion and mag burst) over SPIBus and I2CBus against the HAL stand-in, mag behind the
+ *  I2C master on both. The host time is the driver's framing and decode around the HAL calls, the
+ *  wire time is what the bytes cost on the target bus: SPI at 84MHz / 8 = 10.5MHz, 8 clocks a byte,
+ *  I2C at 100KHz and 400KHz, 9 clocks a byte plus start, address and restart (3 bytes) per read.
+ */
+
+#include "bench.h"
+#include "sim.h"
+#include "hal_sim.h"
+
+using namespace IMU;
+
+static constexpr uint16_t NCS_PIN = 0x0010;
+static constexpr uint32_t SAMPLES = 200000;
+
+struct Wire
+{
+	const char *name;
+	double hz;
+};
+
+/*
+ * Host time per ReadAll, then the bus traffic of one and its wire time at each clock.
+ */
+template<class Driver, uint8_t N>
+static void run(const char *name, Driver &imu, double bitsPerByte, double overheadBytes, const Wire (&clocks)[N])
+{
+	SimBus &dev = halDevice();
+	const int16_t acc[3] = {100, -200, 300}, gyr[3] = {-1, 2, -3}, mag[3] = {40, 50, 60};
+	setMotion(dev, acc, 0, gyr);
+	setMag(dev, mag, true);
+
+	const uint32_t bytes = dev.bytes, transactions = dev.transactions;
+	imu.ReadAll(imu);
+	const double perSample = dev.bytes - bytes, frames = dev.transactions - transactions;
+
+	const BenchResult r = measure(SAMPLES, [&] {
+		for(uint32_t i = 0; i < SAMPLES; i++) imu.ReadAll(imu);
+		keep(imu.Snapshot());
+	});
+	report(name, r);
+
+	printf("    %.0f transaction(s), %.0f bytes\n", frames, perSample);
+	for(const Wire &w : clocks)
+		printf("    wire at %-10s %8.1f us\n", w.name, (perSample + overheadBytes * frames) * bitsPerByte / w.hz * 1e6);
+}
+
+int main()
+{
+	halReset();
+
+	GPIO_TypeDef gpioa{};
+	SPI_TypeDef spi1{SPI_CR1_SPE};
+	SPI_HandleTypeDef hspi1{&spi1};
+	halSelectCS(&gpioa, NCS_PIN);
+
+	I2C_HandleTypeDef hi2c1{1};
+
+	reportHeader("ReadAll, motion + mag burst", "sample");
+
+	MPU9250T<SPIBus> spi(SPIBus(hspi1, &gpioa, NCS_PIN));
+	const Wire spiClocks[] = {{"10.5MHz", 10.5e6}, {"20MHz", 20e6}};
+	run("SPIBus", spi, 8.0, 0.0, spiClocks);
+
+	halReset();
+	MPU9250T<I2CBus> i2c(I2CBus(hi2c1), MagMode::Master);
+	const Wire i2cClocks[] = {{"100KHz", 100e3}, {"400KHz", 400e3}};
+	run("I2CBus", i2c, 9.0, 3.0, i2cClocks);
+
+	return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * check.h
+ *
+ *  Assertions for the host tests. A failed check prints where and why and the test keeps going,
+ *  main returns checkResult() so ctest sees the failure.
+ */
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+#include <math.h>
+
+inline int checkFailures = 0;
+
+#define CHECK(cond) \
+	do { if(!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); checkFailures++; } } while(0)
+
+#define CHECK_NEAR(a, b, tol) \
+	do { const double a_ = (a), b_ = (b); \
+		 if(!(fabs(a_ - b_) <= (tol))) { printf("%s:%d: %s = %g, expected %g +- %g\n", __FILE__, __LINE__, #a, a_, b_, double(tol)); checkFailures++; } } while(0)
+
+inline int checkResult()
+{
+	if(checkFailures) printf("%d check(s) failed\n", checkFailures);
+	return checkFailures ? 1 : 0;
+}
+
+#endif /* CHECK_H_ */
@@ -0,0 +1,170 @@
+/*
+ * firmware_sim.cpp
+ *
+ *  See firmware_sim.h.
+ */
+
+#include <string.h>
+
+#include "firmware_sim.h"
+
+FirmwareSim fw;
+
+static uint8_t pointer[2];	/*Register pointer of the MPU9250 and the AK8963*/
+
+static uint8_t *bank(uint16_t address, uint8_t subAddress)
+{
+	return address == AK8963_ADDRESS ? &fw.ak[subAddress & 0x1F] : &fw.mpu[subAddress & 0x7F];
+}
+
+static void store(uint16_t address, uint8_t subAddress, uint8_t data)
+{
+	*bank(address, subAddress) = data;
+
+	//The reset is done by the next read
+	if(address == MPU9250_ADDRESS && subAddress == PWR_MGMT_1 && (data & 0x80))
+	{
+		memset(fw.mpu, 0, sizeof(fw.mpu));
+		fw.mpu[WHO_AM_I_MPU9250] = 0x71;
+		fw.nackUntil = fw.now + fw.nackMs;
+	}
+}
+
+static bool nacked(uint16_t address)
+{
+	return address == MPU9250_ADDRESS && fw.now < fw.nackUntil;
+}
+
+static void load(uint16_t address, uint8_t subAddress, uint8_t *data, uint16_t len)
+{
+	for(uint16_t i = 0; i < len; i++) data[i] = *bank(address, uint8_t(subAddress + i));
+
+	//The fuse ROM (ASAX..ASAZ) only reads in fuse ROM access mode
+	for(uint16_t i = 0; i < len; i++)
+	{
+		const uint8_t sub = uint8_t(subAddress + i);
+		if(address == AK8963_ADDRESS && sub >= AK8963_ASAX && sub <= AK8963_ASAZ && (fw.ak[AK8963_CNTL] & 0x0F) != 0x0F) data[i] = 0;
+	}
+
+	//A read releases the latched INT, any register with ANYRD_2CLEAR, INT_STATUS only otherwise
+	const bool status = subAddress <= INT_STATUS && subAddress + len > INT_STATUS;
+	if(address == MPU9250_ADDRESS && ((fw.mpu[INT_PIN_CFG] & INT_ANYRD_2CLEAR) || status)) fw.intLevel = false;
+}
+
+void fwReset()
+{
+	memset(&fw, 0, sizeof(fw));
+	fw.mpu[WHO_AM_I_MPU9250] = 0x71;
+	fw.ak[AK8963_WHO_AM_I] = 0x48;
+	fw.ak[AK8963_ASAX] = fw.ak[AK8963_ASAY] = fw.ak[AK8963_ASAZ] = 128;
+}
+
+bool fwCompleteDMA()
+{
+	if(!fw.dmaPending) return false;
+
+	fw.dmaPending = false;
+	load(MPU9250_ADDRESS, fw.dmaSubAddress, fw.dmaData, fw.dmaLen);
+	HAL_I2C_MemRxCpltCallback(fw.dmaHandle);
+
+	return true;
+}
+
+bool fwFailDMA()
+{
+	if(!fw.dmaPending) return false;
+
+	fw.dmaPending = false;
+	HAL_I2C_ErrorCallback(fw.dmaHandle);
+
+	return true;
+}
+
+void fwDataReady(uint16_t intPin)
+{
+	if(!(fw.mpu[INT_ENABLE] & 0x01)) return;
+	if(fw.intLevel && (fw.mpu[INT_PIN_CFG] & INT_LATCH_EN)) return;
+
+	fw.intLevel = (fw.mpu[INT_PIN_CFG] & INT_LATCH_EN) != 0;
+	fw.edges++;
+	HAL_GPIO_EXTI_Callback(intPin);
+}
+
+void fwSetMotion(const int16_t acc[3], int16_t temp, const int16_t gyr[3])
+{
+	const int16_t words[7] = {acc[0], acc[1], acc[2], temp, gyr[0], gyr[1], gyr[2]};
+
+	for(uint8_t i = 0; i < 7; i++)
+	{
+		fw.mpu[ACCEL_XOUT_H + 2 * i] = uint8_t(uint16_t(words[i]) >> 8);
+		fw.mpu[ACCEL_XOUT_H + 2 * i + 1] = uint8_t(words[i]);
+	}
+}
+
+extern "C" {
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(fw.dmaPending) return HAL_BUSY;
+	fw.transactions++;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	pointer[DevAddress == AK8963_ADDRESS] = pData[0];
+	for(uint16_t i = 1; i < Size; i++) store(DevAddress, uint8_t(pData[0] + i - 1), pData[i]);
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(fw.dmaPending) return HAL_BUSY;
+	fw.transactions++;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	load(DevAddress, pointer[DevAddress == AK8963_ADDRESS], pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *, uint16_t DevAddress, uint16_t MemAddress, uint16_t, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(fw.dmaPending) return HAL_BUSY;
+	fw.transactions++;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	for(uint16_t i = 0; i < Size; i++) store(DevAddress, uint8_t(MemAddress + i), pData[i]);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *, uint16_t DevAddress, uint16_t MemAddress, uint16_t, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(fw.dmaPending) return HAL_BUSY;
+	fw.transactions++;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	load(DevAddress, uint8_t(MemAddress), pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t, uint8_t *pData, uint16_t Size)
+{
+	if(fw.dmaPending || fw.refuseDMA || DevAddress != MPU9250_ADDRESS) return HAL_BUSY;
+	fw.transactions++;
+
+	fw.dmaPending = true;
+	fw.dmaHandle = hi2c;
+	fw.dmaSubAddress = uint8_t(MemAddress);
+	fw.dmaData = pData;
+	fw.dmaLen = Size;
+
+	return HAL_OK;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	fw.now += Delay;
+	fw.delays++;
+}
+
+uint32_t HAL_GetTick(void) { return fw.now; }
+
+}
@@ -0,0 +1,60 @@
+/*
+ * firmware_sim.h
+ *
+ *  HAL transfers for the C driver in MPU9250/Core, built against the real Cube headers.
+ *  A register array per device stands in for the MPU9250 and the AK8963, a DMA read is held until
+ *  the test completes it with fwCompleteDMA (HAL_I2C_MemRxCpltCallback, as the DMA interrupt would).
+ *
+ *  INT follows INT_PIN_CFG: latched (INT_LATCH_EN) it stays high from a sample until INT_STATUS, or
+ *  with INT_ANYRD_2CLEAR any register, is read, otherwise it pulses with every sample. A rising edge
+ *  calls HAL_GPIO_EXTI_Callback.
+ */
+
+#ifndef FIRMWARE_SIM_H_
+#define FIRMWARE_SIM_H_
+
+#include <stdint.h>
+
+extern "C" {
+#include "MPU9250.h"
+}
+
+struct FirmwareSim
+{
+	uint8_t mpu[128];
+	uint8_t ak[32];
+	uint32_t now;			/*ms*/
+	uint32_t delays;		/*HAL_Delay calls*/
+	uint32_t transactions;
+
+	uint32_t nackMs;		/*the MPU9250 NACKs (HAL_ERROR, buffer untouched) this long after H_RESET*/
+	uint32_t nackUntil;
+
+	bool dmaPending;
+	bool refuseDMA;			/*HAL_I2C_Mem_Read_DMA answers HAL_BUSY*/
+	I2C_HandleTypeDef *dmaHandle;
+	uint8_t dmaSubAddress;
+	uint8_t *dmaData;
+	uint16_t dmaLen;
+
+	bool intLevel;
+	uint32_t edges;
+};
+
+extern FirmwareSim fw;
+
+void fwReset();
+bool fwCompleteDMA();
+bool fwFailDMA();		/*HAL_I2C_ErrorCallback instead*/
+
+/*
+ * The part has a new sample, INT rises (if enabled and not still latched) on intPin.
+ */
+void fwDataReady(uint16_t intPin);
+
+/*
+ * Big endian accel, temp and gyro counts from ACCEL_XOUT_H on.
+ */
+void fwSetMotion(const int16_t acc[3], int16_t temp, const int16_t gyr[3]);
+
+#endif /* FIRMWARE_SIM_H_ */
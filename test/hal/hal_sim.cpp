@@ -0,0 +1,261 @@
+/*
+ * hal_sim.cpp
+ *
+ *  HAL stand-in on a SimBus, see hal_sim.h.
+ */
+
+#include "hal_sim.h"
+
+using IMU::SimBus;
+
+static SimBus device;
+
+static struct
+{
+	bool pending;
+	bool refuse;
+	I2C_HandleTypeDef *hi2c;
+	uint16_t address;
+	uint16_t subAddress;
+	uint8_t *data;
+	uint16_t len;
+} dma;
+
+static struct
+{
+	GPIO_TypeDef *csPort;
+	uint16_t csPin;
+	bool haveAddress;
+	uint8_t address;
+	HalSPIStats stats;
+} spi;
+
+static HalInt intLine;
+
+static struct
+{
+	uint32_t ms;
+	uint32_t until;		/*device.now, us*/
+} nack;
+
+static uint8_t pointer[256];	/*Register pointer per device for Master_Transmit / Master_Receive*/
+
+static DWT_Type dwtRegs;
+static CoreDebug_Type coreDebugRegs;
+DWT_Type *DWT = &dwtRegs;
+CoreDebug_Type *CoreDebug = &coreDebugRegs;
+
+SimBus &halDevice() { return device; }
+
+void halReset()
+{
+	device = SimBus();
+	dma = {};
+	spi = {};
+	intLine = {};
+	nack = {};
+	dwtRegs.CYCCNT = 0;
+}
+
+void halNackAfterReset(uint32_t ms) { nack.ms = ms; }
+
+static bool nacked(uint16_t DevAddress)
+{
+	return uint8_t(DevAddress) == MPU9250_ADDRESS && device.now < nack.until;
+}
+
+/*
+ * Every write to the part, H_RESET opens the NACK window.
+ */
+static void deviceWrite(uint8_t address, uint8_t subAddress, const uint8_t *data, uint16_t len)
+{
+	device.write(address, subAddress, data, len);
+
+	const bool reset = subAddress <= PWR_MGMT_1 && subAddress + len > PWR_MGMT_1 && (data[PWR_MGMT_1 - subAddress] & PWR_MGMT_1_H_RESET);
+	if(address == MPU9250_ADDRESS && reset) nack.until = device.now + nack.ms * 1000;
+}
+
+/*
+ * Every read of the part, a read releases the latched INT.
+ */
+static void deviceRead(uint8_t address, uint8_t subAddress, uint8_t *data, uint16_t len)
+{
+	device.read(address, subAddress, data, len);
+
+	const bool status = subAddress <= INT_STATUS && subAddress + len > INT_STATUS;
+	if(address == MPU9250_ADDRESS && ((device.mpu[INT_PIN_CFG] & INT_PIN_CFG_ANYRD_2CLEAR) || status)) intLine.level = false;
+}
+
+void halDataReady(uint16_t intPin)
+{
+	const bool latch = device.mpu[INT_PIN_CFG] & INT_PIN_CFG_LATCH_EN;
+	if(!(device.mpu[INT_ENABLE] & 0x01) || (latch && intLine.level)) return;
+
+	intLine.level = latch;
+	intLine.edges++;
+	HAL_GPIO_EXTI_Callback(intPin);
+}
+
+HalInt &halInt() { return intLine; }
+
+void halRefuseDMA(bool refuse) { dma.refuse = refuse; }
+
+bool halDMAPending() { return dma.pending; }
+
+bool halCompleteDMA()
+{
+	if(!dma.pending) return false;
+
+	dma.pending = false;
+	deviceRead(uint8_t(dma.address), uint8_t(dma.subAddress), dma.data, dma.len);
+	HAL_I2C_MemRxCpltCallback(dma.hi2c);
+
+	return true;
+}
+
+bool halFailDMA()
+{
+	if(!dma.pending) return false;
+
+	dma.pending = false;
+	HAL_I2C_ErrorCallback(dma.hi2c);
+
+	return true;
+}
+
+void halSelectCS(GPIO_TypeDef *port, uint16_t pin)
+{
+	spi.csPort = port;
+	spi.csPin = pin;
+}
+
+const HalSPIStats &halSPIStats() { return spi.stats; }
+
+static bool spiSelected(SPI_HandleTypeDef *hspi)
+{
+	return spi.csPort && !(spi.csPort->ODR & spi.csPin) && (hspi->Instance->CR1 & SPI_CR1_SPE);
+}
+
+/*
+ * Payload of the frame opened by the address byte, bit 7 of the address has to match the direction.
+ */
+static HAL_StatusTypeDef spiPayload(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, bool isRead)
+{
+	if(!spiSelected(hspi) || !spi.haveAddress || bool(spi.address & MPU9250_SPI_READ) != isRead)
+	{
+		spi.stats.errors++;
+		return HAL_ERROR;
+	}
+
+	spi.haveAddress = false;
+	if(isRead) deviceRead(MPU9250_ADDRESS, uint8_t(spi.address & ~MPU9250_SPI_READ), pData, Size);
+	else	   deviceWrite(MPU9250_ADDRESS, uint8_t(spi.address & ~MPU9250_SPI_READ), pData, Size);
+
+	return HAL_OK;
+}
+
+extern "C" {
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(dma.pending) return HAL_BUSY;
+	if(Size == 0 || nacked(DevAddress)) return HAL_ERROR;
+
+	pointer[DevAddress & 0xFF] = pData[0];
+	if(Size > 1) deviceWrite(uint8_t(DevAddress), pData[0], pData + 1, uint16_t(Size - 1));
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(dma.pending) return HAL_BUSY;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	deviceRead(uint8_t(DevAddress), pointer[DevAddress & 0xFF], pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *, uint16_t DevAddress, uint16_t MemAddress, uint16_t, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(dma.pending) return HAL_BUSY;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	deviceWrite(uint8_t(DevAddress), uint8_t(MemAddress), pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *, uint16_t DevAddress, uint16_t MemAddress, uint16_t, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	if(dma.pending) return HAL_BUSY;
+	if(nacked(DevAddress)) return HAL_ERROR;
+
+	deviceRead(uint8_t(DevAddress), uint8_t(MemAddress), pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t, uint8_t *pData, uint16_t Size)
+{
+	if(dma.pending || dma.refuse) return HAL_BUSY;
+
+	dma.pending = true;
+	dma.hi2c = hi2c;
+	dma.address = DevAddress;
+	dma.subAddress = MemAddress;
+	dma.data = pData;
+	dma.len = Size;
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t)
+{
+	if(!spiSelected(hspi) || spi.haveAddress || Size != 1)
+	{
+		spi.stats.errors++;
+		return HAL_ERROR;
+	}
+
+	spi.haveAddress = true;
+	spi.address = pTxData[0];
+	pRxData[0] = 0x00;
+
+	const uint32_t br = hspi->Instance->CR1 & SPI_CR1_BR;
+	const bool dataRead = (spi.address & MPU9250_SPI_READ) && IMU::SPIBus::isDataRegister(uint8_t(spi.address & ~MPU9250_SPI_READ));
+
+	spi.stats.frames++;
+	if(br == SPI_BAUDRATEPRESCALER_128) spi.stats.slowFrames++;
+	else if(br == SPI_BAUDRATEPRESCALER_8 && dataRead) spi.stats.fastReads++;
+	else spi.stats.errors++;
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	return spiPayload(hspi, pData, Size, false);
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t)
+{
+	return spiPayload(hspi, pData, Size, true);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	if(PinState == GPIO_PIN_SET) GPIOx->ODR |= GPIO_Pin;
+	else						 GPIOx->ODR &= ~uint32_t(GPIO_Pin);
+
+	//NCS released, a frame without payload ends here
+	if(GPIOx == spi.csPort && (GPIO_Pin & spi.csPin) && PinState == GPIO_PIN_SET) spi.haveAddress = false;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	device.delayMs(Delay);
+	dwtRegs.CYCCNT += Delay * 1000;
+}
+
+uint32_t HAL_GetTick(void) { return device.now / 1000; }
+
+}
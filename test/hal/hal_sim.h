@@ -0,0 +1,80 @@
+/*
+ * hal_sim.h
+ *
+ *  Test side of the HAL stand-in. Every HAL transfer goes to halDevice(), a SimBus holding the
+ *  MPU9250 and AK8963 registers. A DMA read is only started, the test decides when it completes
+ *  (or fails), which runs the HAL callback the driver overrides as the DMA interrupt would.
+ *
+ *  SPI loops back to the same device: the address byte and the payload of one NCS low period are
+ *  one register access on MPU9250_ADDRESS, as the MPU9250 decodes it in SPI mode.
+ *
+ *  INT follows INT_PIN_CFG: latched it stays high from a sample until INT_STATUS, or with ANYRD_2CLEAR
+ *  any register, is read, otherwise it pulses with every sample. A rising edge calls HAL_GPIO_EXTI_Callback.
+ */
+
+#ifndef HAL_SIM_H_
+#define HAL_SIM_H_
+
+#include "MPU9250.h"
+
+IMU::SimBus &halDevice();
+
+/*
+ * Resets the device model and the DMA state, latencies as in SimBus.
+ */
+void halReset();
+
+/*
+ * The MPU9250 NACKs every I2C transfer for ms after an H_RESET write: HAL_ERROR, the read buffer
+ * untouched and the write lost. 0 (the default) answers at once.
+ */
+void halNackAfterReset(uint32_t ms);
+
+/*
+ * HAL_I2C_Mem_Read_DMA answers HAL_BUSY while set, as the HAL does with the bus taken.
+ */
+void halRefuseDMA(bool refuse);
+
+bool halDMAPending();
+
+/*
+ * Finishes the transfer in flight, copies the registers and calls HAL_I2C_MemRxCpltCallback.
+ * halFailDMA calls HAL_I2C_ErrorCallback instead. Both return false with nothing in flight.
+ */
+bool halCompleteDMA();
+bool halFailDMA();
+
+/*
+ * The part has a new sample, INT rises (if enabled and not still latched) on intPin.
+ */
+void halDataReady(uint16_t intPin);
+
+struct HalInt
+{
+	bool level;
+	uint32_t edges;
+};
+
+HalInt &halInt();
+
+/*
+ * NCS of the simulated MPU9250, the SPI functions only answer while it is low.
+ */
+void halSelectCS(GPIO_TypeDef *port, uint16_t pin);
+
+/*
+ * Per frame, counted at its address byte. errors are frames the part would not take: NCS high,
+ * SPE cleared, payload without an address byte, and anything but a data register read above
+ * the slow prescaler (datasheet pg 10, 1MHz for the configuration registers).
+ */
+struct HalSPIStats
+{
+	uint32_t frames;
+	uint32_t fastReads;		/*data register reads on SPI_BAUDRATEPRESCALER_8*/
+	uint32_t slowFrames;	/*everything on SPI_BAUDRATEPRESCALER_128*/
+	uint32_t errors;
+};
+
+const HalSPIStats &halSPIStats();
+
+#endif /* HAL_SIM_H_ */
@@ -0,0 +1,103 @@
+/*
+ * main.h
+ *
+ *  HAL stand-in for the host tests. What MPUCPP includes through "main.h" with USE_HAL_DRIVER,
+ *  the functions are implemented in hal_sim.cpp on top of a SimBus (see hal_sim.h).
+ *  Only the parts of the STM32F4 HAL the driver touches.
+ */
+
+#ifndef HAL_STANDIN_MAIN_H_
+#define HAL_STANDIN_MAIN_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+	HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+	uint32_t Instance;
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+#define HAL_MAX_DELAY        0xFFFFFFFFU
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+typedef struct
+{
+	uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum
+{
+	GPIO_PIN_RESET = 0, GPIO_PIN_SET
+} GPIO_PinState;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+//SPI, frames are decoded by the stand-in while the NCS pin set with halSelectCS is low
+#define HAL_SPI_MODULE_ENABLED
+
+typedef struct
+{
+	volatile uint32_t CR1;
+} SPI_TypeDef;
+
+typedef struct
+{
+	SPI_TypeDef *Instance;
+} SPI_HandleTypeDef;
+
+#define SPI_CR1_BR                 (0x7UL << 3)
+#define SPI_CR1_SPE                (1UL << 6)
+#define SPI_BAUDRATEPRESCALER_8    0x00000010U
+#define SPI_BAUDRATEPRESCALER_128  0x00000030U
+
+#define MODIFY_REG(REG, CLEARMASK, SETMASK)  ((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+#define __HAL_SPI_ENABLE(__HANDLE__)         ((__HANDLE__)->Instance->CR1 |= SPI_CR1_SPE)
+#define __HAL_SPI_DISABLE(__HANDLE__)        ((__HANDLE__)->Instance->CR1 &= (~SPI_CR1_SPE))
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout);
+
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+
+//Cycle counter, DWT->CYCCNT advances with HAL_Delay, 1 count per simulated us
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+
+#define DWT_CTRL_CYCCNTENA_Msk        (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk    (1UL << 24)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_STANDIN_MAIN_H_ */
@@ -0,0 +1,92 @@
+/*
+ * motion.h
+ *
+ *  Attitude truth for the filter tests. Quaternions rotate body into earth as in MPU9250_Fusion.h,
+ *  the truth is kept in double so its own error stays out of the bounds under test.
+ */
+
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include <math.h>
+
+#include "MPU9250_Fusion.h"
+
+struct Quat
+{
+	double w, x, y, z;
+};
+
+inline Quat operator*(const Quat &a, const Quat &b)
+{
+	return Quat{a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+				a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+				a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+				a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w};
+}
+
+/*
+ * Z-Y-X Euler angles in rad, the convention of fusion::toEuler.
+ */
+inline Quat fromEuler(double roll, double pitch, double yaw)
+{
+	const Quat qz{cos(yaw / 2), 0, 0, sin(yaw / 2)}, qy{cos(pitch / 2), 0, sin(pitch / 2), 0}, qx{cos(roll / 2), sin(roll / 2), 0, 0};
+	return qz * qy * qx;
+}
+
+/*
+ * Rotation vector (rad) as a quaternion, an exact step of a constant body rate is q * rotation(w * dt).
+ */
+inline Quat rotation(double rx, double ry, double rz)
+{
+	const double a = sqrt(rx * rx + ry * ry + rz * rz);
+	if(a == 0.0) return Quat{1, 0, 0, 0};
+
+	const double s = sin(a / 2) / a;
+	return Quat{cos(a / 2), rx * s, ry * s, rz * s};
+}
+
+/*
+ * An earth frame vector seen from the body, q* v q.
+ */
+inline void toBody(const Quat &q, const double v[3], float out[3])
+{
+	const Quat r = Quat{q.w, -q.x, -q.y, -q.z} * Quat{0, v[0], v[1], v[2]} * q;
+	out[0] = float(r.x);
+	out[1] = float(r.y);
+	out[2] = float(r.z);
+}
+
+/*
+ * Angle of the rotation between the two, in deg. The estimate is normalised first, the filters keep
+ * it at unit length only to invSqrt's accuracy.
+ */
+inline double angleDeg(const IMU::Quaternion &est, const Quat &truth)
+{
+	const double n = sqrt(double(est.w) * est.w + double(est.x) * est.x + double(est.y) * est.y + double(est.z) * est.z);
+	double d = fabs(est.w * truth.w + est.x * truth.x + est.y * truth.y + est.z * truth.z) / n;
+	if(d > 1.0) d = 1.0;
+	return 2.0 * acos(d) * 180.0 / M_PI;
+}
+
+/*
+ * Difference of two angles in deg, wrapped to [0, 180].
+ */
+inline double wrapDeg(double a, double b)
+{
+	double d = fmod(fabs(a - b), 2 * M_PI);
+	if(d > M_PI) d = 2 * M_PI - d;
+	return d * 180.0 / M_PI;
+}
+
+/*
+ * Gravity reaction and a 60 deg dip earth field in the filter's earth frame (x magnetic north).
+ */
+inline void earthFields(IMU::Earth earth, double g[3], double b[3])
+{
+	const double s = (earth == IMU::Earth::NED) ? -1.0 : 1.0;
+	g[0] = 0.0; g[1] = 0.0; g[2] = s * 9.80665;
+	b[0] = 200.0; b[1] = 0.0; b[2] = -s * 346.0;
+}
+
+#endif /* MOTION_H_ */
@@ -0,0 +1,47 @@
+/*
+ * sim.h
+ *
+ *  SimBus helpers shared by the host tests.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "MPU9250.h"
+
+/*
+ * Big endian accel, temp and gyro counts into ACCEL_XOUT_H .. GYRO_ZOUT_L, as the burst returns them.
+ */
+inline void setMotion(IMU::SimBus &bus, const int16_t acc[3], int16_t temp, const int16_t gyr[3])
+{
+	const int16_t words[7] = {acc[0], acc[1], acc[2], temp, gyr[0], gyr[1], gyr[2]};
+
+	for(uint8_t i = 0; i < 7; i++)
+	{
+		bus.reg(MPU9250_ADDRESS, uint8_t(ACCEL_XOUT_H + 2 * i)) = uint8_t(uint16_t(words[i]) >> 8);
+		bus.reg(MPU9250_ADDRESS, uint8_t(ACCEL_XOUT_H + 2 * i + 1)) = uint8_t(words[i]);
+	}
+}
+
+/*
+ * A new AK8963 sample, little endian. In bypass mode into the AK8963 registers, in master mode into
+ * EXT_SENS_DATA as SLV0 would have fetched it.
+ */
+inline void setMag(IMU::SimBus &bus, const int16_t mag[3], bool master = false)
+{
+	uint8_t block[AK8963_FETCH_LEN] = {0x01};
+
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		block[1 + 2 * i] = uint8_t(mag[i]);
+		block[2 + 2 * i] = uint8_t(uint16_t(mag[i]) >> 8);
+	}
+
+	for(uint8_t i = 0; i < AK8963_FETCH_LEN; i++)
+	{
+		if(master) bus.reg(MPU9250_ADDRESS, uint8_t(EXT_SENS_DATA_00 + i)) = block[i];
+		else	   bus.reg(AK8963_ADDRESS, uint8_t(AK8963_ST1 + i)) = block[i];
+	}
+}
+
+#endif /* SIM_H_ */
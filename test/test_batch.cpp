@@ -0,0 +1,117 @@
+/*
+ * test_batch.cpp
+ *
+ *  batch::decode against batch::decodeReference on random frames, with and without temperature,
+ *  frame counts that do not fill the SSE2 / REV16 steps, a remapped source column and skipped
+ *  columns. Both run the same operations, the results have to be identical, for float (the SSE2
+ *  conversion), double and Q16.
+ */
+
+#include <vector>
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static uint32_t state = 1357;
+
+static uint8_t next()
+{
+	state = state * 1664525u + 1013904223u;
+	return uint8_t(state >> 24);
+}
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+static bool same(double a, double b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+static bool same(fixed::Q16 a, fixed::Q16 b) { return a == b; }
+
+template<typename Real>
+static void run(uint32_t frames, bool hasTemp, const batch::Conversion<Real, typename ScalarTraits<Real>::Scale> &conv)
+{
+	const uint8_t stride = batch::frameWords(hasTemp);
+	std::vector<uint8_t> raw(2u * stride * frames);
+	for(uint8_t &b : raw) b = next();
+
+	//Column TEMP stays unset without temperature, GY is skipped
+	std::vector<Real> ref(batch::COLUMNS * frames), out(batch::COLUMNS * frames);
+	batch::Columns<Real> refCols, outCols;
+	for(uint8_t c = 0; c < batch::COLUMNS; c++)
+	{
+		refCols.col[c] = c == batch::GY ? nullptr : &ref[c * frames];
+		outCols.col[c] = c == batch::GY ? nullptr : &out[c * frames];
+	}
+
+	const std::vector<uint8_t> original = raw;
+	batch::decodeReference(raw.data(), frames, hasTemp, conv, refCols);
+	CHECK(raw == original);
+	batch::decode(raw.data(), frames, hasTemp, conv, outCols);
+
+	uint32_t differ = 0;
+	for(uint8_t c = 0; c < batch::COLUMNS; c++)
+	{
+		if(c == batch::GY || (c == batch::TEMP && !hasTemp)) continue;
+		for(uint32_t i = 0; i < frames; i++) differ += !same(out[c * frames + i], ref[c * frames + i]);
+	}
+	CHECK(differ == 0);
+
+	//The skipped columns were not written
+	for(uint32_t i = 0; i < frames; i++)
+	{
+		CHECK(same(out[batch::GY * frames + i], Real()));
+		if(!hasTemp) CHECK(same(out[batch::TEMP * frames + i], Real()));
+	}
+}
+
+template<typename Real>
+static void runAll()
+{
+	//Calibrated, and with accel x and y swapped as a mounting would
+	MPU9250T<SimBus, Real> imu{SimBus()};
+	const Real gain[3] = {ScalarTraits<Real>::value(1.01), ScalarTraits<Real>::value(0.97), ScalarTraits<Real>::value(1.2)};
+	const Real bias[3] = {ScalarTraits<Real>::value(0.1), ScalarTraits<Real>::value(-0.25), ScalarTraits<Real>::value(0.03)};
+	imu.SetAccelCalibration(gain, bias);
+	imu.SetGyroCalibration(gain, bias);
+
+	auto conv = imu.GetConversion();
+	conv.src[batch::AX] = batch::AY;
+	conv.src[batch::AY] = batch::AX;
+
+	for(uint32_t frames : {1u, 2u, 3u, 5u, 7u, 8u, 9u, 31u, 1001u, 4096u})
+	{
+		run<Real>(frames, true, conv);
+		run<Real>(frames, false, conv);
+	}
+}
+
+int main()
+{
+	runAll<float>();
+	runAll<double>();
+	runAll<fixed::Q16>();
+
+	//Full int16 range, every word value once per column, straight through
+	std::vector<uint8_t> raw(14u * 65536);
+	for(uint32_t i = 0; i < 65536; i++)
+	{
+		for(uint8_t w = 0; w < 7; w++)
+		{
+			raw[14 * i + 2 * w] = uint8_t(i >> 8);
+			raw[14 * i + 2 * w + 1] = uint8_t(i);
+		}
+	}
+	MPU9250T<SimBus> imu{SimBus()};
+	const auto conv = imu.GetConversion();
+	std::vector<float> ref(7u * 65536), out(7u * 65536);
+	batch::Columns<float> refCols, outCols;
+	for(uint8_t c = 0; c < batch::COLUMNS; c++)
+	{
+		refCols.col[c] = &ref[c * 65536u];
+		outCols.col[c] = &out[c * 65536u];
+	}
+	batch::decodeReference(raw.data(), 65536, true, conv, refCols);
+	batch::decode(raw.data(), 65536, true, conv, outCols);
+	CHECK(memcmp(ref.data(), out.data(), ref.size() * sizeof(float)) == 0);
+
+	return checkResult();
+}
@@ -0,0 +1,61 @@
+/*
+ * test_buffers.cpp
+ *
+ *  Non default QueueLen / FifoBytes instantiate from the header and bound the data ready queue and
+ *  the FIFO drain.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint16_t INT_PIN = 0x0100;
+
+int main()
+{
+	using Small = MPU9250T<SimBus, float, SensorFrame, 4, 28>;
+	static_assert(sizeof(Small) < sizeof(MPU9250T<SimBus>), "the buffers did not shrink");
+
+	Small imu{SimBus()};
+
+	//Queue of 4 holds 3 samples, the rest of the burst is dropped
+	const int16_t acc[3] = {100, 200, 300}, gyr[3] = {-1, -2, -3};
+	setMotion(imu.GetBus(), acc, 0, gyr);
+	imu.EnableDataReadyIRQ(INT_PIN);
+
+	for(uint32_t i = 1; i <= 5; i++) imu.OnDataReady(INT_PIN, i);
+
+	MotionSample s;
+	uint32_t popped = 0;
+	while(imu.PopSample(s))
+	{
+		popped++;
+		CHECK(s.stamp == popped);
+	}
+	CHECK(popped == 3);
+	CHECK(imu.DroppedSamples() == 2);
+	imu.DisableDataReadyIRQ();
+
+	//28 bytes drain 2 frames of accel + temp + gyro per call, the rest stays in the FIFO
+	imu.EnableFIFO(true);
+	uint8_t frame[14] = {};
+	for(uint8_t i = 0; i < 5; i++)
+	{
+		frame[1] = i;
+		imu.GetBus().pushFIFO(frame, sizeof(frame));
+	}
+
+	MotionSample batch[8];
+	const uint16_t expected[] = {2, 2, 1, 0};
+	uint8_t next = 0;
+	for(uint16_t n : expected)
+	{
+		const uint16_t got = imu.ReadFIFO(batch, 8);
+		CHECK(got == n);
+		for(uint16_t i = 0; i < got; i++, next++) CHECK_NEAR(batch[i].acc[0], next * perCount(Ascale::AFS_2G), 1e-7);
+	}
+	CHECK(!imu.FIFOOverflowed());
+
+	return checkResult();
+}
@@ -0,0 +1,63 @@
+/*
+ * test_burst.cpp
+ *
+ *  The motion read is one bus transaction, counted on SimBus against the per sensor reads.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+int main()
+{
+	const int16_t acc[3] = {1, 2, 3}, gyr[3] = {4, 5, 6};
+
+	MPU9250T<SimBus> imu{SimBus()};
+	SimBus &bus = imu.GetBus();
+	setMotion(bus, acc, 7, gyr);
+
+	//Old path, accel and gyro each pay an address phase
+	uint32_t tx = bus.transactions, bytes = bus.bytes;
+	imu.ReadAccel(imu);
+	imu.ReadGyro(imu);
+	CHECK(bus.transactions - tx == 2);
+	CHECK(bus.bytes - bytes == 2 * (1 + 6));
+	const MotionSample separate = imu.Snapshot();
+
+	//Accel, temp and gyro in one 14 byte burst, same values
+	tx = bus.transactions;
+	bytes = bus.bytes;
+	imu.ReadAll(imu);
+	CHECK(bus.transactions - tx == 1);
+	CHECK(bus.bytes - bytes == 1 + MPU9250_MOTION_BURST_LEN);
+
+	const MotionSample burst = imu.Snapshot();
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		CHECK(burst.acc[i] == separate.acc[i]);
+		CHECK(burst.gyr[i] == separate.gyr[i]);
+	}
+	CHECK_NEAR(burst.temp, 7 / TEMP_SENSITIVITY + TEMP_ROOM_OFFSET, 1e-5);
+
+	//Master mode, the mag comes along in the same transaction instead of three bypass reads
+	MPU9250T<SimBus> master(SimBus(), MagMode::Master);
+	SimBus &mbus = master.GetBus();
+	const int16_t mag[3] = {10, 20, 30};
+	setMotion(mbus, acc, 7, gyr);
+	setMag(mbus, mag, true);
+
+	tx = mbus.transactions;
+	bytes = mbus.bytes;
+	master.ReadAll(master);
+	CHECK(mbus.transactions - tx == 1);
+	CHECK(mbus.bytes - bytes == 1 + MPU9250_MOTION_MAG_BURST_LEN);
+	CHECK(master.Snapshot().mag[0] != 0.0f);
+
+	setMag(bus, mag);
+	tx = bus.transactions;
+	CHECK(imu.ReadMag(imu));
+	CHECK(bus.transactions - tx == 3);
+
+	return checkResult();
+}
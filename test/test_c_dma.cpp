@@ -0,0 +1,54 @@
+/*
+ * test_c_dma.cpp
+ *
+ *  The C driver's DMA burst (MPU9250/Core): MPU9250_StartReadDMA, the completion callback and
+ *  MPU9250_GetLatest against the blocking MPU9250_ReadMotion.
+ */
+
+#include "check.h"
+#include "firmware_sim.h"
+
+int main()
+{
+	fwReset();
+
+	I2C_HandleTypeDef hi2c1{}, hi2c2{};
+	MPU9250_Handle_t imu{}, ref{};
+	imu.I2Chandle = ref.I2Chandle = &hi2c1;
+	CHECK(MPU9250_init(&imu) == 1);
+
+	const int16_t acc[3] = {1000, -2000, 3000}, gyr[3] = {10, 20, -30};
+	fwSetMotion(acc, 100, gyr);
+	MPU9250_ReadMotion(&ref);
+
+	CHECK(MPU9250_GetLatest(&imu) == 0);
+
+	//One transfer at a time, nothing is published before the completion
+	CHECK(MPU9250_StartReadDMA(&imu) == 1);
+	CHECK(MPU9250_StartReadDMA(&imu) == 0);
+	CHECK(MPU9250_GetLatest(&imu) == 0);
+
+	//Another handle's completion is ignored
+	HAL_I2C_MemRxCpltCallback(&hi2c2);
+	CHECK(MPU9250_GetLatest(&imu) == 0);
+
+	CHECK(fwCompleteDMA());
+	CHECK(MPU9250_GetLatest(&imu) == 1);
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		CHECK(imu.acc[i] == ref.acc[i]);
+		CHECK(imu.gyr[i] == ref.gyr[i]);
+	}
+	CHECK(imu.temp == ref.temp);
+	CHECK(MPU9250_GetLatest(&imu) == 0);
+
+	//An error frees the transfer slot without publishing
+	CHECK(MPU9250_StartReadDMA(&imu) == 1);
+	CHECK(fwFailDMA());
+	CHECK(MPU9250_GetLatest(&imu) == 0);
+	CHECK(MPU9250_StartReadDMA(&imu) == 1);
+	CHECK(fwCompleteDMA());
+	CHECK(MPU9250_GetLatest(&imu) == 1);
+
+	return checkResult();
+}
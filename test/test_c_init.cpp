@@ -0,0 +1,89 @@
+/*
+ * test_c_init.cpp
+ *
+ *  MPU9250_init of the C driver (MPU9250/Core): both init tables are polled, a responsive part costs
+ *  no HAL_Delay, the AK8963 steps go to AK8963_ADDRESS and its CNTL ends up at Mscale / 100Hz.
+ *  A part that NACKs after H_RESET is waited for, a failed read never passes a poll.
+ *  The AK8963 fuse ROM sensitivity adjustment is read in fuse ROM mode and scales each mag axis.
+ */
+
+#include "check.h"
+#include "firmware_sim.h"
+
+int main()
+{
+	fwReset();
+
+	I2C_HandleTypeDef hi2c1{};
+	MPU9250_Handle_t imu{};
+	imu.I2Chandle = &hi2c1;
+
+	CHECK(MPU9250_init(&imu) == 1);
+	CHECK(fw.delays == 0);
+	CHECK(fw.ak[AK8963_CNTL] == ((MPU9250_MSCALE << 4) | 0x06));
+	CHECK(fw.mpu[AK8963_CNTL] == 0);
+	CHECK(fw.mpu[INT_PIN_CFG] == 0x22);
+	CHECK(fw.mpu[SMPLRT_DIV] == MPU9250_SMPLRT_DIV);
+
+	//Mag through the bypass, little endian, AK8963 axes swapped into the body frame
+	fw.ak[AK8963_ST1] = 0x01;
+	fw.ak[AK8963_XOUT_L] = 100;
+	fw.ak[AK8963_YOUT_L] = 200;
+	fw.ak[AK8963_ZOUT_L] = 50;
+	fw.ak[AK8963_ST2] = 0x10;
+	MPU9250_ReadMag(&imu);
+	CHECK(imu.mag[0] != 0.0f && imu.mag[1] != 0.0f && imu.mag[2] != 0.0f);
+
+	//Overflowed sample is dropped
+	const float kept = imu.mag[0];
+	fw.ak[AK8963_XOUT_L] = 10;
+	fw.ak[AK8963_ST2] = 0x18;
+	MPU9250_ReadMag(&imu);
+	CHECK(imu.mag[0] == kept);
+
+	//Factory ASA per AK8963 axis: body axis i scales by (ASA + 128) / 256 of the sensor axis it comes from
+	const float neutral[3] = {imu.mag[0], imu.mag[1], imu.mag[2]};
+	fwReset();
+	fw.ak[AK8963_ASAX] = 100;
+	fw.ak[AK8963_ASAY] = 170;
+	fw.ak[AK8963_ASAZ] = 140;
+	CHECK(MPU9250_init(&imu) == 1);
+	fw.ak[AK8963_ST1] = 0x01;
+	fw.ak[AK8963_XOUT_L] = 100;		//the raw sample of the neutral read above
+	fw.ak[AK8963_YOUT_L] = 200;
+	fw.ak[AK8963_ZOUT_L] = 50;
+	fw.ak[AK8963_ST2] = 0x10;
+	MPU9250_ReadMag(&imu);
+
+	static const uint8_t mountAxis[3] = { MPU9250_MOUNT_AXES };
+	const uint8_t akAxis[3] = {1, 0, 2};		//AK8963 X and Y are swapped against the accel/gyro
+	const float asa[3] = {100, 170, 140};
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		const uint8_t s = akAxis[mountAxis[i]];
+		CHECK_NEAR(imu.mag[i], neutral[i] * (asa[s] + 128) / 256, fabs(neutral[i]) * 1e-6);
+	}
+
+	//No AK8963 on the bus, init fails after its poll timeout instead of carrying on
+	fwReset();
+	fw.ak[AK8963_WHO_AM_I] = 0x00;
+	CHECK(MPU9250_init(&imu) == 0);
+	CHECK(fw.now > 0 && fw.now <= 11);
+
+	//NACKs for 5 ms after the reset: the H_RESET poll waits, the configuration after it lands
+	fwReset();
+	fw.nackMs = 5;
+	CHECK(MPU9250_init(&imu) == 1);
+	CHECK(fw.now >= 5);
+	CHECK(fw.mpu[INT_PIN_CFG] == 0x22);
+	CHECK(fw.mpu[SMPLRT_DIV] == MPU9250_SMPLRT_DIV);
+	CHECK(fw.mpu[PWR_MGMT_1] == 0x01);
+
+	//and a part that stays silent fails at the poll timeout
+	fwReset();
+	fw.nackMs = 1000;
+	CHECK(MPU9250_init(&imu) == 0);
+	CHECK(fw.now <= 101);
+
+	return checkResult();
+}
@@ -0,0 +1,121 @@
+/*
+ * test_c_irq.cpp
+ *
+ *  The C driver's data ready path (MPU9250/Core): the EXTI callback starts the DMA burst, which
+ *  releases the latched INT for the next edge. An edge during a burst is read after it, a refused
+ *  burst and a DMA error still read INT_STATUS, so the edges keep coming in every case.
+ */
+
+#include "check.h"
+#include "firmware_sim.h"
+
+static constexpr uint16_t INT_PIN = 0x0100;
+
+static MPU9250_Handle_t imu;
+static int16_t n;
+
+/*
+ * The next sample, accel x counts up.
+ */
+static void sample()
+{
+	const int16_t acc[3] = {++n, 0, 0}, gyr[3] = {0, 0, 0};
+	fwSetMotion(acc, 0, gyr);
+	fwDataReady(INT_PIN);
+}
+
+static bool latest(int16_t expected)
+{
+	return MPU9250_GetLatest(&imu) == 1 && fabs(imu.acc[0] - expected * getAres(MPU9250_ASCALE)) < 1e-6;
+}
+
+int main()
+{
+	fwReset();
+
+	I2C_HandleTypeDef hi2c1{};
+	imu.I2Chandle = &hi2c1;
+	CHECK(MPU9250_init(&imu) == 1);
+
+	MPU9250_EnableDataReadyIRQ(&imu, INT_PIN);
+	CHECK(fw.mpu[INT_PIN_CFG] & INT_LATCH_EN);
+	CHECK(fw.mpu[INT_PIN_CFG] & INT_ANYRD_2CLEAR);
+	CHECK(fw.mpu[INT_PIN_CFG] & INT_BYPASS_EN);
+	CHECK(fw.mpu[INT_ENABLE] == 0x01);
+
+	for(uint8_t i = 0; i < 20; i++)
+	{
+		sample();
+		CHECK(fw.dmaPending);
+		CHECK(fw.intLevel);
+		CHECK(fwCompleteDMA());
+		CHECK(!fw.intLevel);
+		CHECK(latest(n));
+	}
+	CHECK(fw.edges == 20);
+	CHECK(MPU9250_DroppedSamples() == 0);
+
+	//An edge during the burst is read right after it, not dropped
+	sample();
+	fw.intLevel = false;		//the burst in flight already released INT
+	sample();
+	CHECK(fw.edges == 22);
+	CHECK(fwCompleteDMA());
+	CHECK(fw.dmaPending);
+	CHECK(fwCompleteDMA());
+	CHECK(latest(n));
+	CHECK(MPU9250_DroppedSamples() == 0);
+
+	//A third edge in the same burst supersedes the deferred one
+	sample();
+	fw.intLevel = false;
+	sample();
+	fw.intLevel = false;
+	sample();
+	CHECK(MPU9250_DroppedSamples() == 1);
+	CHECK(fwCompleteDMA());
+	CHECK(fwCompleteDMA());
+	CHECK(!fw.dmaPending);
+	CHECK(latest(n));
+
+	//The HAL refuses the burst: dropped, but INT_STATUS is read and the next sample has its edge
+	fw.refuseDMA = true;
+	sample();
+	CHECK(!fw.dmaPending);
+	CHECK(!fw.intLevel);
+	CHECK(MPU9250_DroppedSamples() == 2);
+	fw.refuseDMA = false;
+
+	sample();
+	CHECK(fw.dmaPending);
+	CHECK(fwCompleteDMA());
+	CHECK(latest(n));
+
+	//DMA error, with a deferred edge pending: both dropped, INT released, acquisition goes on
+	sample();
+	fw.intLevel = false;
+	sample();
+	CHECK(fw.intLevel);			//latched by the second edge, the failed burst never read the part
+	CHECK(fwFailDMA());
+	CHECK(!fw.intLevel);
+	CHECK(MPU9250_DroppedSamples() == 4);
+
+	const uint32_t edges = fw.edges;
+	for(uint8_t i = 0; i < 10; i++)
+	{
+		sample();
+		CHECK(fwCompleteDMA());
+		CHECK(latest(n));
+	}
+	CHECK(fw.edges == edges + 10);
+	CHECK(MPU9250_DroppedSamples() == 4);
+
+	//Other lines and a disabled pipeline start nothing
+	HAL_GPIO_EXTI_Callback(0x0200);
+	CHECK(!fw.dmaPending);
+	MPU9250_DisableDataReadyIRQ();
+	HAL_GPIO_EXTI_Callback(INT_PIN);
+	CHECK(!fw.dmaPending);
+
+	return checkResult();
+}
@@ -0,0 +1,105 @@
+/*
+ * test_calibration.cpp
+ *
+ *  Calibration folded into the conversion: with a mounting, non neutral AK8963 ASA, every scale and
+ *  Set*Calibration on all three sensors, ReadAll / ReadMag and GetConversion give the unfolded
+ *  formula out = (sign * raw * perCount * sens - bias) * gain, one step at a time in double.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+//Z up, rotated 90 deg: body x is chip -y, body y is chip x
+struct RotatedZ90 { static constexpr AxisMap axes = {{1, 0, 2}, {-1, 1, 1}}; };
+
+static const int16_t accRaw[3] = {1000, -2000, 3000};
+static const int16_t gyrRaw[3] = {-400, 500, 600};
+static const int16_t magRaw[3] = {70, -80, 90};		/*AK8963 axes*/
+static const uint8_t asa[3] = {100, 170, 140};		/*AK8963 axes*/
+
+static const double gain[3][3] = {{1.01, 0.98, 1.003}, {0.995, 1.02, 0.97}, {1.1, 0.9, 1.05}};
+static const double bias[3][3] = {{0.12, -0.3, 0.05}, {0.01, -0.02, 0.004}, {25.0, -40.0, 12.5}};
+
+/*
+ * Chip frame to body frame, then the calibration.
+ */
+static double unfolded(const double chip[3], uint8_t i, double perCount, const double gain[3], const double bias[3])
+{
+	const AxisMap &m = RotatedZ90::axes;
+	return (m.sign[i] * chip[m.axis[i]] * perCount - bias[i]) * gain[i];
+}
+
+template<typename Real>
+static void run(double tol)
+{
+	SimBus part;
+	for(uint8_t i = 0; i < 3; i++) part.reg(AK8963_ADDRESS, uint8_t(AK8963_ASAX + i)) = asa[i];
+
+	MPU9250T<SimBus, Real, RotatedZ90> imu{std::move(part)};
+	setMotion(imu.GetBus(), accRaw, 0, gyrRaw);
+	setMag(imu.GetBus(), magRaw);
+
+	Real g[3][3], b[3][3];
+	for(uint8_t s = 0; s < 3; s++)
+	{
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			g[s][i] = Real(gain[s][i]);
+			b[s][i] = Real(bias[s][i]);
+		}
+	}
+	imu.SetAccelCalibration(g[0], b[0]);
+	imu.SetGyroCalibration(g[1], b[1]);
+	imu.SetMagCalibration(g[2], b[2]);
+
+	//The AK8963 axes are X / Y swapped and Z inverted into the chip frame, the ASA trims its own axis
+	double sens[3];
+	for(uint8_t i = 0; i < 3; i++) sens[i] = (asa[i] + 128) / 256.0;
+	const double magChip[3] = {magRaw[1] * sens[1], magRaw[0] * sens[0], -magRaw[2] * sens[2]};
+	double accChip[3], gyrChip[3];
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		accChip[i] = accRaw[i];
+		gyrChip[i] = gyrRaw[i];
+	}
+
+	for(uint8_t fs = 0; fs < 4; fs++)
+	{
+		const Ascale as = Ascale(fs);
+		const Gscale gs = Gscale(uint8_t(Gscale::GFS_250DPS) + fs);
+		imu.SetAccelScale(as);
+		imu.SetGyroScale(gs);
+
+		imu.ReadAll(imu);
+		CHECK(imu.ReadMag(imu));
+		const auto s = imu.Snapshot();
+
+		const auto conv = imu.GetConversion();
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			const double a = unfolded(accChip, i, perCount(as), gain[0], bias[0]);
+			const double w = unfolded(gyrChip, i, perCount(gs), gain[1], bias[1]);
+			CHECK_NEAR(s.acc[i], a, tol * fabs(a));
+			CHECK_NEAR(s.gyr[i], w, tol * fabs(w));
+			CHECK_NEAR(s.mag[i], unfolded(magChip, i, perCount(Mscale::MFS_16BITS), gain[2], bias[2]), tol * 1000);
+
+			//The same factors for the batch decode, from the frame column of the mapped chip axis
+			CHECK(conv.src[batch::AX + i] == batch::AX + RotatedZ90::axes.axis[i]);
+			CHECK(conv.src[batch::GX + i] == batch::GX + RotatedZ90::axes.axis[i]);
+			CHECK_NEAR(conv.k[batch::AX + i], RotatedZ90::axes.sign[i] * perCount(as) * gain[0][i], tol * perCount(as));
+			CHECK_NEAR(conv.offset[batch::AX + i], -bias[0][i] * gain[0][i], tol);
+			CHECK_NEAR(conv.k[batch::GX + i], RotatedZ90::axes.sign[i] * perCount(gs) * gain[1][i], tol * perCount(gs));
+			CHECK_NEAR(conv.offset[batch::GX + i], -bias[1][i] * gain[1][i], tol);
+		}
+	}
+}
+
+int main()
+{
+	run<double>(1e-12);
+	run<float>(1e-6);
+
+	return checkResult();
+}
@@ -0,0 +1,74 @@
+/*
+ * test_dma.cpp
+ *
+ *  I2CDMABus against the HAL stand-in: StartReadDMA, the HAL completion / error callbacks from
+ *  MPU9250.cpp and the torn free GetLatest.
+ */
+
+#include "check.h"
+#include "sim.h"
+#include "hal_sim.h"
+
+using namespace IMU;
+
+int main()
+{
+	halReset();
+
+	I2C_HandleTypeDef hi2c1{1}, hi2c2{2};
+	MPU9250 imu(hi2c1);
+	CHECK(imu.GetDMAState() == DMAState::Idle);
+
+	const int16_t acc[3] = {1000, 2000, 3000}, gyr[3] = {-10, -20, -30};
+	setMotion(halDevice(), acc, 0, gyr);
+
+	//Nothing completed yet
+	MotionSample s;
+	CHECK(!imu.GetLatest(s));
+
+	//Started, the second start is refused while the first is in flight
+	CHECK(imu.StartReadDMA());
+	CHECK(halDMAPending());
+	CHECK(imu.GetDMAState() == DMAState::Busy);
+	CHECK(!imu.StartReadDMA());
+	CHECK(!imu.GetLatest(s));
+
+	//The completion publishes, once
+	CHECK(halCompleteDMA());
+	CHECK(imu.GetDMAState() == DMAState::Idle);
+	CHECK(imu.GetLatest(s));
+	CHECK_NEAR(s.acc[2], 3000 * perCount(Ascale::AFS_2G), 1e-6);
+	CHECK_NEAR(s.gyr[0], -10 * perCount(Gscale::GFS_250DPS), 1e-7);
+	CHECK(!imu.GetLatest(s));
+
+	//The front buffer keeps the last complete sample while the next burst is in flight
+	const int16_t acc2[3] = {-1, -2, -3};
+	setMotion(halDevice(), acc2, 0, gyr);
+	CHECK(imu.StartReadDMA());
+	CHECK(!imu.GetLatest(s));
+	CHECK_NEAR(s.acc[2], 3000 * perCount(Ascale::AFS_2G), 1e-6);
+
+	//A completion of another I2C handle is not ours
+	HAL_I2C_MemRxCpltCallback(&hi2c2);
+	CHECK(imu.GetDMAState() == DMAState::Busy);
+	CHECK(halCompleteDMA());
+	CHECK(imu.GetLatest(s));
+	CHECK_NEAR(s.acc[2], -3 * perCount(Ascale::AFS_2G), 1e-7);
+
+	//Bus error, then the next start works again
+	CHECK(imu.StartReadDMA());
+	CHECK(halFailDMA());
+	CHECK(imu.GetDMAState() == DMAState::Error);
+	CHECK(!imu.GetLatest(s));
+	CHECK(imu.StartReadDMA());
+	CHECK(halCompleteDMA());
+	CHECK(imu.GetLatest(s));
+
+	//HAL refuses the transfer
+	halRefuseDMA(true);
+	CHECK(!imu.StartReadDMA());
+	CHECK(imu.GetDMAState() == DMAState::Error);
+	halRefuseDMA(false);
+
+	return checkResult();
+}
@@ -0,0 +1,206 @@
+/*
+ * test_ekf.cpp
+ *
+ *  AttitudeEKF<false> and <true> on synthetic 500 Hz samples in NWU and NED: Align against a known
+ *  attitude, gyro (and accel) bias convergence with sensor noise, the chi^2 gate on a linear
+ *  acceleration and on a magnetic disturbance, and P kept symmetric and positive definite throughout.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "motion.h"
+#include "MPU9250_EKF.h"
+
+using namespace IMU;
+
+static const double GYRO_BIAS[3] = {0.02, -0.03, 0.04};
+static const double ACCEL_BIAS[3] = {0.2, -0.1, 0.15};
+static constexpr uint32_t RATE = 500;
+
+/*
+ * Deterministic unit gaussian, LCG into Box-Muller, so the bounds below hold run to run.
+ */
+static double gauss()
+{
+	static uint32_t state = 12345;
+	auto uniform = [] { state = state * 1664525u + 1013904223u; return (double(state >> 8) + 0.5) / 16777216.0; };
+
+	const double u1 = uniform(), u2 = uniform();
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/*
+ * Symmetric to the bit and a Cholesky factorisation (in double) with all pivots > 0.
+ */
+template<uint8_t N>
+static bool symmetricPositive(const la::Matrix<N, N> &P)
+{
+	double L[N][N] = {};
+
+	for(uint8_t i = 0; i < N; i++)
+	{
+		for(uint8_t j = 0; j < N; j++)
+			if(P(i, j) != P(j, i)) return false;
+
+		for(uint8_t j = 0; j <= i; j++)
+		{
+			double s = P(i, j);
+			for(uint8_t k = 0; k < j; k++) s -= L[i][k] * L[j][k];
+
+			if(i == j)
+			{
+				if(!(s > 0.0)) return false;
+				L[i][i] = sqrt(s);
+			}
+			else L[i][j] = s / L[j][j];
+		}
+	}
+
+	return true;
+}
+
+struct Disturbance
+{
+	double acc[3];		/*earth frame linear acceleration, m/s^2*/
+	double mag[3];		/*earth frame field added, same unit as earthFields*/
+};
+
+/*
+ * n samples from sample i0 on, biased and noisy, the truth moves with the sum of sines rate
+ * (or not at all). Returns false as soon as P loses symmetry or definiteness.
+ */
+template<bool AB>
+static bool run(AttitudeEKF<AB> &f, Earth earth, Quat &truth, bool moving, uint32_t i0, uint32_t n, const Disturbance *d = nullptr)
+{
+	double g[3], b[3];
+	earthFields(earth, g, b);
+
+	const double dt = 1.0 / RATE;
+	bool ok = true;
+
+	for(uint32_t i = i0; i < i0 + n; i++)
+	{
+		const double t = i * dt;
+		double w[3] = {0.3 * sin(0.5 * t), 0.2 * cos(0.3 * t), 0.25 * sin(0.2 * t + 1.0)};
+		if(!moving) w[0] = w[1] = w[2] = 0.0;
+		truth = truth * rotation(w[0] * dt, w[1] * dt, w[2] * dt);
+
+		double ge[3] = {g[0], g[1], g[2]}, be[3] = {b[0], b[1], b[2]};
+		if(d != nullptr)
+			for(uint8_t k = 0; k < 3; k++) { ge[k] += d->acc[k]; be[k] += d->mag[k]; }
+
+		MotionSample s{};
+		toBody(truth, ge, s.acc);
+		toBody(truth, be, s.mag);
+		for(uint8_t k = 0; k < 3; k++)
+		{
+			s.gyr[k] = float(w[k] + GYRO_BIAS[k] + 3e-3 * gauss());
+			s.acc[k] += float((AB ? ACCEL_BIAS[k] : 0.0) + 0.05 * gauss());
+			s.mag[k] += float(2.0 * gauss());
+		}
+		s.stamp = i * (1000000 / RATE);
+		f.Update(s, true);
+
+		if(i % 100 == 0 && !symmetricPositive(f.GetCovariance())) ok = false;
+	}
+
+	return ok;
+}
+
+template<bool AB>
+static void testAlign(Earth earth)
+{
+	double g[3], b[3];
+	earthFields(earth, g, b);
+
+	const Quat truth = fromEuler(0.4, -0.2, 0.8);
+	float acc[3], mag[3];
+	toBody(truth, g, acc);
+	toBody(truth, b, mag);
+
+	AttitudeEKF<AB> f(EKFNoise(), 1e-6f, earth);
+	f.Align(acc, mag);
+	CHECK(f.Aligned());
+	CHECK(angleDeg(f.GetQuaternion(), truth) < 0.01);
+	CHECK(symmetricPositive(f.GetCovariance()));
+
+	//Without the mag the tilt is still right, Z-Y-X roll and pitch do not depend on the heading
+	AttitudeEKF<AB> tilt(EKFNoise(), 1e-6f, earth);
+	tilt.Align(acc, nullptr);
+	const EulerAngles e = tilt.GetEuler();
+	CHECK(wrapDeg(e.roll, 0.4) < 0.01);
+	CHECK(wrapDeg(e.pitch, -0.2) < 0.01);
+
+	float sigma[3];
+	tilt.AttitudeSigma(sigma);
+	CHECK(sigma[2] > 1.0f);		//initHeading on the body z at this tilt mostly
+	CHECK(symmetricPositive(tilt.GetCovariance()));
+}
+
+template<bool AB>
+static void testFilter(Earth earth)
+{
+	Quat truth = fromEuler(0.3, 0.1, -0.5);
+	AttitudeEKF<AB> f(EKFNoise(), 1e-6f, earth);
+
+	//Bias convergence, moving so all gyro axes and (for <true>) all accel axes are observable
+	CHECK(run(f, earth, truth, true, 0, 120 * RATE));
+	CHECK(angleDeg(f.GetQuaternion(), truth) < 0.2);
+
+	float bg[3], ba[3];
+	f.GetGyroBias(bg);
+	f.GetAccelBias(ba);
+	for(uint8_t k = 0; k < 3; k++)
+	{
+		CHECK_NEAR(bg[k], GYRO_BIAS[k], 5e-4);
+		CHECK_NEAR(ba[k], AB ? ACCEL_BIAS[k] : 0.0, AB ? 0.01 : 0.0);
+	}
+
+	//A 3 m/s^2 horizontal acceleration for 1 s: |acc| stays within accelTolerance of g so the update
+	//is attempted, the tilt it implies (17 deg) is gated out, all three components, and the attitude holds
+	uint32_t i = 120 * RATE;
+	const uint32_t before = f.Rejected();
+	const Disturbance push{{3.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+	CHECK(run(f, earth, truth, false, i, RATE, &push));
+	i += RATE;
+	CHECK(f.Rejected() == before + 3 * RATE);
+	CHECK(angleDeg(f.GetQuaternion(), truth) < 0.2);
+
+	//A field turned 45 deg in the horizontal plane for 1 s, the heading update is rejected and yaw holds
+	const double yaw = f.GetEuler().yaw;
+	const uint32_t beforeMag = f.Rejected();
+	const Disturbance magnet{{0.0, 0.0, 0.0}, {-200.0 + 200.0 * cos(M_PI / 4), 200.0 * sin(M_PI / 4), 0.0}};
+	CHECK(run(f, earth, truth, false, i, RATE, &magnet));
+	i += RATE;
+	CHECK(f.Rejected() >= beforeMag + RATE);
+	CHECK(wrapDeg(f.GetEuler().yaw, yaw) < 0.2);
+	CHECK(angleDeg(f.GetQuaternion(), truth) < 0.2);
+
+	//The direct call reports the rejection
+	double g[3], b[3];
+	earthFields(earth, g, b);
+	const double bm[3] = {b[0] - 200.0 + 200.0 * cos(M_PI / 4), b[1] + 200.0 * sin(M_PI / 4), b[2]};
+	float mag[3];
+	toBody(truth, bm, mag);
+	CHECK(!f.UpdateHeading(mag));
+
+	//Undisturbed again, the updates are taken
+	const uint32_t after = f.Rejected();
+	CHECK(run(f, earth, truth, false, i, RATE));
+	CHECK(f.Rejected() - after < RATE / 100);
+	CHECK(angleDeg(f.GetQuaternion(), truth) < 0.2);
+}
+
+int main()
+{
+	for(Earth earth : {Earth::NWU, Earth::NED})
+	{
+		testAlign<false>(earth);
+		testAlign<true>(earth);
+		testFilter<false>(earth);
+		testFilter<true>(earth);
+	}
+
+	return checkResult();
+}
@@ -0,0 +1,211 @@
+/*
+ * test_fixed.cpp
+ *
+ *  MPU9250T<SimBus, fixed::Q16> against MPU9250T<SimBus, double> for every int16 count at every full
+ *  scale setting, accel, gyro and both mag resolutions.
+ *
+ *  The Q16 path is raw * mant >> shift, bit exact to that integer spec. Against the double driver it
+ *  is round(raw * perCount * 65536) except where the mantissa's own rounding (at most 0.5 in 2^29)
+ *  moves the product across a rounding tie, there it may be the other neighbour.
+ *
+ *  Then the arithmetic on its own: saturation instead of wrap around, calibrate against its double
+ *  formula and the LowPass step response against the exact first order recursion.
+ */
+
+#include <math.h>
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+using fixed::Q15;
+using fixed::Q16;
+using fixed::QScale;
+
+struct Tally
+{
+	uint32_t specMismatch;	/*differs from the integer spec*/
+	uint32_t offBound;		/*further from the double than the mantissa allows*/
+	uint32_t farTie;		/*rounded to the other neighbour outside the tie band*/
+};
+
+/*
+ * One axis, sign is the mounting / AK8963 axis sign folded into the scale.
+ */
+static void compare(int16_t raw, int sign, double perCount, Q16 q, double d, Tally &t)
+{
+	const QScale s = fixed::makeScale(perCount);
+	const int64_t mant = sign * int64_t(s.mant);
+
+	if(q.v != fixed::sat32(fixed::roundShift(raw * mant, s.shift))) t.specMismatch++;
+
+	const double x = d * 65536.0;
+	if(fabs(x) >= 2147483647.0)
+	{
+		if(q.v != (x > 0 ? INT32_MAX : INT32_MIN)) t.offBound++;
+		return;
+	}
+
+	//What the mantissa rounding can move the product by, plus double's own rounding
+	const double band = fabs(double(raw)) * fabs(ldexp(double(s.mant), -s.shift) - perCount * 65536.0) + 1e-6;
+
+	if(fabs(q.v - x) > 0.5 + band) t.offBound++;
+
+	const double nearest = floor(x + 0.5);
+	if(q.v == nearest) return;
+
+	if(fabs(x - floor(x) - 0.5) > band) t.farTie++;
+}
+
+static void check(const Tally &t)
+{
+	CHECK(t.specMismatch == 0);
+	CHECK(t.offBound == 0);
+	CHECK(t.farTie == 0);
+}
+
+static void testSaturation()
+{
+	const Q16 max = Q16::fromRaw(INT32_MAX), min = Q16::fromRaw(INT32_MIN), one = Q16::fromDouble(1.0);
+
+	CHECK((max + one).v == INT32_MAX);
+	CHECK((min - one).v == INT32_MIN);
+	CHECK((-min).v == INT32_MAX);
+	CHECK((max * Q16::fromDouble(2.0)).v == INT32_MAX);
+	CHECK((max * Q16::fromDouble(-2.0)).v == INT32_MIN);
+	CHECK(Q16::fromDouble(1e6).v == INT32_MAX);
+	CHECK(Q16::fromDouble(-1e6).v == INT32_MIN);
+
+	//Q15 covers [-1, 1), -1 * -1 is the one product that leaves it
+	CHECK(Q15::fromDouble(1.0).v == INT16_MAX);
+	CHECK(Q15::fromDouble(-1.0).v == INT16_MIN);
+	CHECK(Q15::fromDouble(-3.0).v == INT16_MIN);
+	CHECK((Q15::fromDouble(0.75) + Q15::fromDouble(0.75)).v == INT16_MAX);
+	CHECK((Q15::fromDouble(-0.75) - Q15::fromDouble(0.75)).v == INT16_MIN);
+	CHECK((Q15::fromRaw(INT16_MIN) * Q15::fromRaw(INT16_MIN)).v == INT16_MAX);
+	CHECK((Q15::fromDouble(0.5) * Q15::fromDouble(-0.5)).v == Q15::fromDouble(-0.25).v);
+
+	//Raw counts through a scale that cannot fit Q16.16
+	CHECK((int16_t(INT16_MAX) * fixed::makeScale(1e4)).v == INT32_MAX);
+	CHECK((int16_t(INT16_MIN) * fixed::makeScale(1e4)).v == INT32_MIN);
+}
+
+static void testCalibrate()
+{
+	uint32_t state = 99;
+	for(uint32_t n = 0; n < 100000; n++)
+	{
+		state = state * 1664525u + 1013904223u;
+		const double x = int32_t(state) / 65536.0 / 256.0;		//+-128
+		state = state * 1664525u + 1013904223u;
+		const double bias = int32_t(state) / 65536.0 / 4096.0;	//+-8
+		const double gain = 0.9 + (state >> 16) / 65536.0 * 0.2;
+
+		const Q16 qx = Q16::fromDouble(x), qb = Q16::fromDouble(bias), qg = Q16::fromDouble(gain);
+		const double exact = (qx.v - qb.v) / 65536.0 * (qg.v / 65536.0);
+		CHECK(fabs(fixed::calibrate(qx, qb, qg).v - exact * 65536.0) <= 0.5);
+	}
+
+	//A bias past the range saturates instead of wrapping to the other sign
+	CHECK(fixed::calibrate(Q16::fromRaw(INT32_MIN + 10), Q16::fromDouble(100.0), Q16::fromDouble(1.0)).v == INT32_MIN);
+	CHECK(fixed::calibrate(Q16::fromRaw(INT32_MAX - 10), Q16::fromDouble(-100.0), Q16::fromDouble(1.0)).v == INT32_MAX);
+}
+
+/*
+ * Step from 0 to target, alpha 0.1. Each update rounds alpha * (x - y) once, so y follows
+ * target * (1 - (1 - alpha)^n) within a few LSB, never overshoots, and stops within 1 / (2 alpha) LSB
+ * of the target once the step is below half an LSB.
+ */
+static void testLowPassStep(double target)
+{
+	const double alpha = 0.1;
+	fixed::LowPass lp{Q15::fromDouble(alpha), Q16()};
+	const Q16 x = Q16::fromDouble(target);
+
+	double worst = 0.0;
+	int32_t last = 0;
+	bool monotonic = true, overshoot = false;
+	for(uint32_t n = 1; n <= 200; n++)
+	{
+		const Q16 y = lp.update(x);
+		const double exact = x.v * (1.0 - pow(1.0 - Q15::fromDouble(alpha).v / 32768.0, n));
+		worst = fmax(worst, fabs(y.v - exact));
+
+		if(target > 0 ? y.v < last : y.v > last) monotonic = false;
+		if(target > 0 ? y.v > x.v : y.v < x.v) overshoot = true;
+		last = y.v;
+	}
+
+	CHECK(monotonic);
+	CHECK(!overshoot);
+	CHECK(worst <= 1.0 / (2.0 * alpha) + 0.5);
+	CHECK(abs(x.v - last) <= 5);
+}
+
+int main()
+{
+	testSaturation();
+	testCalibrate();
+	testLowPassStep(9.80665);
+	testLowPassStep(-250.0);
+
+	MPU9250T<SimBus, Q16> qi{SimBus()};
+	MPU9250T<SimBus, double> di{SimBus()};
+
+	for(uint8_t fs = 0; fs < 4; fs++)
+	{
+		const Ascale as = Ascale(fs);
+		const Gscale gs = Gscale(uint8_t(Gscale::GFS_250DPS) + fs);
+		qi.SetAccelScale(as);
+		di.SetAccelScale(as);
+		qi.SetGyroScale(gs);
+		di.SetGyroScale(gs);
+
+		Tally acc{}, gyr{};
+		for(int32_t r = INT16_MIN; r <= INT16_MAX; r++)
+		{
+			const int16_t raw[3] = {int16_t(r), int16_t(r), int16_t(r)};
+			setMotion(qi.GetBus(), raw, 0, raw);
+			setMotion(di.GetBus(), raw, 0, raw);
+			qi.ReadAll(qi);
+			di.ReadAll(di);
+
+			const auto qs = qi.Snapshot();
+			const auto ds = di.Snapshot();
+			for(uint8_t i = 0; i < 3; i++)
+			{
+				compare(int16_t(r), 1, perCount(as), qs.acc[i], ds.acc[i], acc);
+				compare(int16_t(r), 1, perCount(gs), qs.gyr[i], ds.gyr[i], gyr);
+			}
+		}
+		check(acc);
+		check(gyr);
+	}
+
+	//Mag resolution comes from the init script options, AK8963 Z is inverted into the chip frame
+	for(Mscale ms : {Mscale::MFS_14BITS, Mscale::MFS_16BITS})
+	{
+		InitOptions opt = MPU9250_DEFAULT_INIT;
+		opt.mscale = ms;
+		const InitScript script = makeInitScript(opt);
+		CHECK(qi.RunInitScript(script));
+		CHECK(di.RunInitScript(script));
+
+		Tally mag{};
+		for(int32_t r = INT16_MIN; r <= INT16_MAX; r++)
+		{
+			const int16_t raw[3] = {int16_t(r), int16_t(r), int16_t(r)};
+			setMag(qi.GetBus(), raw);
+			setMag(di.GetBus(), raw);
+			qi.ReadMag(qi);
+			di.ReadMag(di);
+
+			const auto qs = qi.Snapshot();
+			const auto ds = di.Snapshot();
+			for(uint8_t i = 0; i < 3; i++) compare(int16_t(r), i == 2 ? -1 : 1, perCount(ms), qs.mag[i], ds.mag[i], mag);
+		}
+		check(mag);
+	}
+
+	return checkResult();
+}
@@ -0,0 +1,99 @@
+/*
+ * test_fixfmt.cpp
+ *
+ *  fixfmt_float of the CubeIDE project against snprintf("%.*f"): every decimals setting over a
+ *  stride through all float bit patterns below 2^32 (subnormals included), both signs, rounding that
+ *  carries into the integer part, exact ties and NaN / Inf. Past 2^32 it saturates where printf does not.
+ */
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#include "check.h"
+
+extern "C" {
+#include "fixfmt.h"
+}
+
+static uint32_t mismatches = 0;
+
+/*
+ * fixfmt_float against snprintf, prints the first few that differ.
+ */
+static void compare(float x, uint8_t decimals)
+{
+	char ref[64], out[FIXFMT_FLOAT_MAX_LEN + 1];
+	snprintf(ref, sizeof(ref), "%.*f", decimals, double(x));
+
+	const uint8_t n = fixfmt_float(out, x, decimals);
+	out[n] = 0;
+	CHECK(n <= FIXFMT_FLOAT_MAX_LEN);
+
+	if(strcmp(out, ref) != 0 && mismatches++ < 10) printf("%a, %u decimals: \"%s\", snprintf \"%s\"\n", double(x), decimals, out, ref);
+}
+
+static void compareAll(float x)
+{
+	for(uint8_t d = 0; d <= FIXFMT_MAX_DECIMALS; d++)
+	{
+		compare(x, d);
+		compare(-x, d);
+	}
+}
+
+static bool formats(float x, uint8_t decimals, const char *expected)
+{
+	char out[FIXFMT_FLOAT_MAX_LEN + 1];
+	out[fixfmt_float(out, x, decimals)] = 0;
+	return strcmp(out, expected) == 0;
+}
+
+int main()
+{
+	//Every 4093rd bit pattern from 0 to 2^32, 260k values, both signs and all decimals
+	for(uint32_t bits = 0; bits < 0x4F800000u; bits += 4093)
+	{
+		float x;
+		memcpy(&x, &bits, sizeof(x));
+		compareAll(x);
+	}
+
+	//Carries and exact ties, half way cases round to even like printf
+	const float edges[] = {0.0f, 0.5f, 1.5f, 2.5f, 0.125f, 0.375f, 0.05f, 0.995f, 9.9999f, 9.99995f, 99.5f,
+						   0.00005f, 0.00015f, 1023.99995f, 8388607.5f, 8388608.0f, 16777215.0f, 4294967040.0f,
+						   FLT_MIN, FLT_TRUE_MIN, 1e-20f, 0.1f, 0.2f, 0.3f, 3.14159265f, 9.80665f, 123456.789f};
+	for(float x : edges) compareAll(x);
+
+	CHECK(mismatches == 0);
+
+	//Sign, NaN and Inf as printf prints them
+	CHECK(formats(-0.0f, 2, "-0.00"));
+	CHECK(formats(-0.001f, 2, "-0.00"));
+	CHECK(formats(0.375f, 2, "0.38"));
+	CHECK(formats(0.125f, 2, "0.12"));
+	CHECK(formats(9.9999f, 3, "10.000"));
+	CHECK(formats(NAN, 2, "nan"));
+	CHECK(formats(-NAN, 2, "-nan"));
+	CHECK(formats(INFINITY, 2, "inf"));
+	CHECK(formats(-INFINITY, 0, "-inf"));
+	compareAll(NAN);
+	compareAll(INFINITY);
+	CHECK(mismatches == 0);
+
+	//Saturation past 2^32, and at most 4 decimals
+	CHECK(formats(5e9f, 2, "4294967295.00"));
+	CHECK(formats(-FLT_MAX, 0, "-4294967295"));
+	CHECK(formats(1.5f, 7, "1.5000"));
+
+	//A record as main.c sends it
+	const float v[3] = {0.01f, -1.0f, 0.985f};
+	char buf[96];
+	char *p = buf;
+	p += fixfmt_str(p, "ACCEL:: ");
+	p += fixfmt_axes(p, v, "g", 2);
+	*p = 0;
+	CHECK(strcmp(buf, "ACCEL:: X: 0.01 g, Y: -1.00 g, Z: 0.99 g") == 0);		//0.985f is 0.98500001...
+
+	return checkResult();
+}
@@ -0,0 +1,161 @@
+/*
+ * test_heading.cpp
+ *
+ *  HeadingService on exact accel and mag from known attitudes in NWU and NED, pitch up to 80 deg.
+ *  The heading is clockwise from north, -yaw in NWU and yaw in NED. Then the cache: nothing moves
+ *  without a new mag, the accel in between is averaged, and SetDeclination applies to the cached
+ *  heading. fastAsin's bound is checked here, the service is its user.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "motion.h"
+#include "MPU9250_Heading.h"
+
+using namespace IMU;
+
+static constexpr double TOL = 1e-4;		//rad, fastAtan2 and fastAsin plus float rounding
+
+/*
+ * Deterministic uniform in [lo, hi).
+ */
+static double uniform(double lo, double hi)
+{
+	static uint32_t state = 4321;
+	state = state * 1664525u + 1013904223u;
+	return lo + (hi - lo) * (double(state >> 8) / 16777216.0);
+}
+
+static void testFastAsin()
+{
+	double worst = 0.0;
+	for(int32_t i = -100000; i <= 100000; i++)
+	{
+		const double x = i * 1e-5;
+		worst = fmax(worst, fabs(fusion::fastAsin(float(x)) - asin(x)));
+	}
+
+	CHECK(worst < 7e-5);
+	CHECK(fusion::fastAsin(1.5f) == fusion::fastAsin(1.0f));
+	CHECK(fusion::fastAsin(-1.5f) == fusion::fastAsin(-1.0f));
+}
+
+static void testAccuracy(Earth earth)
+{
+	double g[3], b[3];
+	earthFields(earth, g, b);
+
+	double worstHeading = 0.0, worstRoll = 0.0, worstPitch = 0.0;
+	for(uint32_t n = 0; n < 10000; n++)
+	{
+		const double roll = uniform(-M_PI, M_PI), pitch = uniform(-1.396, 1.396), yaw = uniform(-M_PI, M_PI);
+		const Quat truth = fromEuler(roll, pitch, yaw);
+
+		float acc[3], mag[3];
+		toBody(truth, g, acc);
+		toBody(truth, b, mag);
+
+		HeadingService h(0.0f, earth);
+		h.Update(acc, mag, true);
+		CHECK(h.Valid());
+		CHECK(h.Heading() >= 0.0f && h.Heading() < 6.28318531f);
+
+		const double expected = (earth == Earth::NED) ? yaw : -yaw;
+		worstHeading = fmax(worstHeading, wrapDeg(h.Heading(), expected));
+		worstRoll = fmax(worstRoll, wrapDeg(h.Roll(), roll));
+		worstPitch = fmax(worstPitch, wrapDeg(h.Pitch(), pitch));
+	}
+
+	CHECK(worstHeading < TOL * 180.0 / M_PI);
+	CHECK(worstRoll < TOL * 180.0 / M_PI);
+	CHECK(worstPitch < TOL * 180.0 / M_PI);
+}
+
+static void testCache(Earth earth)
+{
+	double g[3], b[3];
+	earthFields(earth, g, b);
+
+	const Quat truth = fromEuler(0.2, -0.4, 1.0);
+	const double expected = (earth == Earth::NED) ? 1.0 : -1.0;
+	float acc[3], mag[3];
+	toBody(truth, g, acc);
+	toBody(truth, b, mag);
+
+	HeadingService h(0.0f, earth);
+	h.Update(acc, mag, false);
+	CHECK(!h.Valid());
+	CHECK(h.Updates() == 0);
+
+	h.Update(acc, mag, true);
+	CHECK(h.Updates() == 1);
+	const float heading = h.Heading(), roll = h.Roll(), pitch = h.Pitch();
+	CHECK(wrapDeg(heading, expected) < 0.01);
+
+	//Other samples without a new mag change nothing but the average
+	const Quat other = fromEuler(-0.5, 0.3, -2.0);
+	float acc2[3], mag2[3];
+	toBody(other, g, acc2);
+	toBody(other, b, mag2);
+	for(uint8_t i = 0; i < 50; i++) h.Update(acc2, mag2, false);
+	CHECK(h.Updates() == 1);
+	CHECK(h.Heading() == heading && h.Roll() == roll && h.Pitch() == pitch);
+
+	//A zero mag flagged as new is not a sample either
+	const float zero[3] = {0.0f, 0.0f, 0.0f};
+	h.Update(acc, zero, true);
+	CHECK(h.Updates() == 1);
+
+	//The next mag uses the mean accel since the last one: +-d about the truth averages out
+	HeadingService avg(0.0f, earth);
+	const float d[3] = {1.5f, -2.0f, 0.7f};
+	for(uint8_t i = 0; i < 10; i++)
+	{
+		const float s = (i & 1) ? -1.0f : 1.0f;
+		const float a[3] = {acc[0] + s * d[0], acc[1] + s * d[1], acc[2] + s * d[2]};
+		avg.Update(a, mag, i == 9);
+	}
+	CHECK(avg.Updates() == 1);
+	CHECK(wrapDeg(avg.Heading(), expected) < 0.01);
+	CHECK(wrapDeg(avg.Roll(), 0.2) < 0.01);
+	CHECK(wrapDeg(avg.Pitch(), -0.4) < 0.01);
+
+	//Declination goes onto the cached heading right away, wrapped into [0, 2pi)
+	const float east = HeadingService::degrees(10.0f);
+	h.SetDeclination(east);
+	CHECK(h.Updates() == 1);
+	CHECK(h.MagneticHeading() == heading);
+	CHECK(wrapDeg(h.Heading(), heading + east) < 1e-4);
+	CHECK(h.Heading() >= 0.0f && h.Heading() < 6.28318531f);
+
+	h.SetDeclination(-3.0f);
+	CHECK(wrapDeg(h.Heading(), heading - 3.0f) < 1e-4);
+	CHECK(h.Heading() >= 0.0f && h.Heading() < 6.28318531f);
+
+	//and stays on the next computations. The first still has the other attitude's accels in its mean,
+	//the second is on the truth alone.
+	h.SetDeclination(east);
+	h.Update(acc, mag, true);
+	CHECK(h.Updates() == 2);
+	CHECK(wrapDeg(h.Roll(), 0.2) > 0.1);
+
+	h.Update(acc, mag, true);
+	CHECK(h.Updates() == 3);
+	CHECK(wrapDeg(h.Roll(), 0.2) < 0.01);
+	CHECK(wrapDeg(h.Heading(), expected + east) < 0.01);
+	CHECK(wrapDeg(h.MagneticHeading(), expected) < 0.01);
+}
+
+int main()
+{
+	testFastAsin();
+
+	for(Earth earth : {Earth::NWU, Earth::NED})
+	{
+		testAccuracy(earth);
+		testCache(earth);
+	}
+
+	return checkResult();
+}
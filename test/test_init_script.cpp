@@ -0,0 +1,83 @@
+/*
+ * test_init_script.cpp
+ *
+ *  RunInitScript with a script other than the default: the shadow and the AK8963 follow the reset,
+ *  the mag scale of the options ends up in CNTL, a script for the other mag path is refused.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr InitOptions options(MagMode magMode, bool spi = false)
+{
+	InitOptions opt = MPU9250_DEFAULT_INIT;
+	opt.ascale = Ascale::AFS_8G;
+	opt.mscale = Mscale::MFS_14BITS;
+	opt.sampleRateDiv = 1;
+	opt.magMode = magMode;
+	opt.spi = spi;
+	return opt;
+}
+
+static constexpr InitScript bypassScript = makeInitScript(options(MagMode::Bypass));
+static constexpr InitScript masterScript = makeInitScript(options(MagMode::Master));
+static constexpr InitScript spiScript = makeInitScript(options(MagMode::Master, true));
+
+/*
+ * The shadow holds what the device holds, for the registers the driver writes.
+ */
+template<class Driver>
+static bool shadowMatches(Driver &imu)
+{
+	for(uint8_t r = MPU9250_SHADOW_BASE; r < MPU9250_SHADOW_BASE + MPU9250_SHADOW_LEN; r++)
+	{
+		if(r == I2C_SLV4_DI || r == I2C_MST_STATUS) continue;	//read only, set by the device
+		if(imu.ShadowReg(r) != imu.GetBus().reg(MPU9250_ADDRESS, r)) return false;
+	}
+	return true;
+}
+
+int main()
+{
+	MPU9250T<SimBus> imu{SimBus()};
+	SimBus &bus = imu.GetBus();
+
+	//Runtime changes the reset in the script undoes
+	imu.EnableFIFO(false);
+	imu.SetSampleRateDiv(9);
+	CHECK(imu.ShadowReg(FIFO_EN) != 0);
+
+	//A script for the other mag path or for SPI does not touch the device
+	uint32_t tx = bus.transactions;
+	CHECK(!imu.RunInitScript(masterScript));
+	CHECK(!imu.RunInitScript(spiScript));
+	CHECK(bus.transactions == tx);
+
+	CHECK(imu.RunInitScript(bypassScript));
+	CHECK(shadowMatches(imu));
+	CHECK(imu.ShadowReg(FIFO_EN) == 0);
+	CHECK(imu.ShadowReg(SMPLRT_DIV) == 1);
+	CHECK(bus.reg(AK8963_ADDRESS, AK8963_CNTL) == 0x06);
+
+	//Decoded with the script's scales
+	const int16_t acc[3] = {1000, 0, 0}, gyr[3] = {}, mag[3] = {0, 0, 100};
+	setMotion(bus, acc, 0, gyr);
+	setMag(bus, mag);
+	imu.ReadAll(imu);
+	CHECK(imu.ReadMag(imu));
+	CHECK_NEAR(imu.Snapshot().acc[0], 1000 * perCount(Ascale::AFS_8G), 1e-5);
+	CHECK_NEAR(imu.Snapshot().mag[2], -100 * perCount(Mscale::MFS_14BITS), 1e-3);
+
+	//Master mode, the reset cleared SLV0 and AK8963_Init set it up again
+	MPU9250T<SimBus> master(SimBus(), MagMode::Master);
+	SimBus &mbus = master.GetBus();
+	CHECK(!master.RunInitScript(bypassScript));
+	CHECK(master.RunInitScript(masterScript));
+	CHECK(shadowMatches(master));
+	CHECK(mbus.reg(MPU9250_ADDRESS, I2C_SLV0_CTRL) & I2C_SLV_EN);
+	CHECK(mbus.reg(AK8963_ADDRESS, AK8963_CNTL) == 0x06);
+
+	return checkResult();
+}
@@ -0,0 +1,150 @@
+/*
+ * test_irq.cpp
+ *
+ *  Data ready interrupt pipeline on SimBus with a simulated INT line. The device produces a sample
+ *  every 5 ms (200 Hz), INT latches high with it and an edge calls OnDataReady like the EXTI callback.
+ *  INT only drops again when the driver reads, so a missing ANYRD_2CLEAR stops the edges.
+ *  A destroyed driver unregisters its IRQ hook, and ReadSample stamps a ReadAll with the bus time.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint16_t INT_PIN = 0x0100;
+static constexpr uint32_t PERIOD_US = 5000;
+
+struct FakeInt
+{
+	bool level = false;
+	uint32_t readsAtEdge = 0;
+	uint32_t edges = 0;
+
+	template<class Driver>
+	void sample(Driver &imu, uint32_t n)
+	{
+		SimBus &bus = imu.GetBus();
+		bus.now += PERIOD_US;
+
+		//Latched INT, any read since the edge cleared it only with ANYRD_2CLEAR
+		if(level && (bus.reg(MPU9250_ADDRESS, INT_PIN_CFG) & INT_PIN_CFG_ANYRD_2CLEAR) && bus.transactions != readsAtEdge) level = false;
+
+		const int16_t acc[3] = {int16_t(n), int16_t(-n), 1}, gyr[3] = {int16_t(2 * n), 0, 0};
+		setMotion(bus, acc, 0, gyr);
+		if(!(bus.reg(MPU9250_ADDRESS, INT_ENABLE) & 0x01) || level) return;
+
+		level = true;
+		edges++;
+		readsAtEdge = bus.transactions;
+		imu.OnDataReady(INT_PIN, bus.now);
+	}
+};
+
+/*
+ * Only the instance that holds the hook clears it.
+ */
+static void testHookLifetime()
+{
+	{
+		MPU9250T<SimBus> imu{SimBus()};
+		imu.EnableDataReadyIRQ(INT_PIN);
+		CHECK(detail::irqHook.owner == &imu);
+	}
+	CHECK(detail::irqHook.owner == nullptr);
+
+	MPU9250T<SimBus> armed{SimBus()};
+	armed.EnableDataReadyIRQ(INT_PIN);
+	{
+		MPU9250T<SimBus> other{SimBus()};
+	}
+	CHECK(detail::irqHook.owner == &armed);
+
+	//Through the hook like HAL_GPIO_EXTI_Callback
+	const int16_t acc[3] = {10, 0, 0}, gyr[3] = {};
+	setMotion(armed.GetBus(), acc, 0, gyr);
+	detail::irqHook.dataReady(detail::irqHook.owner, INT_PIN, 77);
+	MotionSample s{};
+	CHECK(armed.PopSample(s) && s.stamp == 77);
+}
+
+static void testReadSample()
+{
+	MPU9250T<SimBus> imu{SimBus()};
+	const float ka = perCount(Ascale::AFS_2G), kg = perCount(Gscale::GFS_250DPS);
+
+	const int16_t acc[3] = {100, -200, 300}, gyr[3] = {-4, 5, 6};
+	setMotion(imu.GetBus(), acc, 0, gyr);
+	imu.GetBus().now = 123456;
+	MotionSample s = imu.ReadSample();
+	CHECK(s.stamp == 123456);
+	CHECK_NEAR(s.acc[1], -200 * ka, 1e-6);
+	CHECK_NEAR(s.gyr[2], 6 * kg, 1e-6);
+
+	//Same values as Snapshot, which is not stamped
+	MotionSample snap = imu.Snapshot();
+	CHECK(snap.stamp == 0);
+	for(uint8_t i = 0; i < 3; i++) CHECK(snap.acc[i] == s.acc[i] && snap.gyr[i] == s.gyr[i]);
+
+	//Every call reads the device again
+	const int16_t acc2[3] = {7, 8, 9};
+	setMotion(imu.GetBus(), acc2, 0, gyr);
+	imu.GetBus().now += 5000;
+	s = imu.ReadSample();
+	CHECK(s.stamp == 128456);
+	CHECK_NEAR(s.acc[0], 7 * ka, 1e-6);
+}
+
+int main()
+{
+	MPU9250T<SimBus> imu{SimBus()};
+	imu.EnableDataReadyIRQ(INT_PIN);
+	CHECK(imu.GetBus().reg(MPU9250_ADDRESS, INT_PIN_CFG) & INT_PIN_CFG_ANYRD_2CLEAR);
+
+	//1 s at 200 Hz, drained every 50 ms
+	FakeInt line;
+	MotionSample s;
+	uint32_t popped = 0, lastStamp = 0;
+	const float ka = perCount(Ascale::AFS_2G);
+
+	for(uint32_t n = 1; n <= 200; n++)
+	{
+		line.sample(imu, n);
+
+		if(n % 10) continue;
+		while(imu.PopSample(s))
+		{
+			popped++;
+			CHECK_NEAR(s.acc[0], popped * ka, 1e-6);
+			CHECK(s.stamp == popped * PERIOD_US);
+			CHECK(s.stamp > lastStamp);
+			lastStamp = s.stamp;
+		}
+	}
+	CHECK(line.edges == 200);
+	CHECK(popped == 200);
+	CHECK(imu.DroppedSamples() == 0);
+
+	//Nobody drains for 200 ms, the queue keeps the oldest 31 and counts the rest
+	for(uint32_t n = 201; n <= 240; n++) line.sample(imu, n);
+	popped = 0;
+	while(imu.PopSample(s)) popped++;
+	CHECK(popped == MPU9250_SAMPLE_QUEUE_LEN - 1);
+	CHECK(imu.DroppedSamples() == 40 - popped);
+
+	//Another EXTI line is not ours
+	imu.OnDataReady(0x0200, 0);
+	CHECK(!imu.PopSample(s));
+
+	//Disabled, INT stays latched and nothing is read any more
+	imu.DisableDataReadyIRQ();
+	const uint32_t edges = line.edges;
+	for(uint32_t n = 241; n <= 250; n++) line.sample(imu, n);
+	CHECK(line.edges - edges <= 1);
+	CHECK(!imu.PopSample(s));
+
+	testHookLifetime();
+	testReadSample();
+
+	return checkResult();
+}
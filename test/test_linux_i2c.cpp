@@ -0,0 +1,64 @@
+/*
+ * test_linux_i2c.cpp
+ *
+ *  LinuxI2CBus ownership and failure reporting without an I2C adapter: a device that does not exist,
+ *  and /dev/null, which opens but refuses I2C_RDWR.
+ */
+
+#include "check.h"
+#include "MPU9250.h"
+
+using namespace IMU;
+
+static_assert(!std::is_copy_constructible<LinuxI2CBus>::value && !std::is_copy_assignable<LinuxI2CBus>::value, "the fd has one owner");
+static_assert(std::is_move_constructible<LinuxI2CBus>::value && std::is_move_assignable<LinuxI2CBus>::value, "handed to the driver by move");
+
+static bool fdOpen(int fd) { return fcntl(fd, F_GETFD) != -1; }
+
+int main()
+{
+	//open() failure is reported, accesses fail without a bus
+	LinuxI2CBus missing("/dev/i2c-does-not-exist");
+	CHECK(!missing.isOpen());
+	CHECK(missing.error() == ENOENT);
+	CHECK(missing.readByte(MPU9250_ADDRESS, WHO_AM_I_MPU9250) == 0);
+	CHECK(missing.error() == EBADF);
+
+	//The destructor closes, the next open gets the lowest free descriptor
+	const int probe = open("/dev/null", O_RDWR);
+	close(probe);
+	{
+		LinuxI2CBus bus("/dev/null");
+		CHECK(bus.isOpen());
+		CHECK(bus.error() == 0);
+		CHECK(fdOpen(probe));
+
+		//A failed ioctl is reported and reads come back cleared
+		uint8_t data[2] = {0xAA, 0xAA};
+		bus.read(MPU9250_ADDRESS, ACCEL_XOUT_H, data, 2);
+		CHECK(bus.error() == ENOTTY);
+		CHECK(data[0] == 0 && data[1] == 0);
+
+		//Too long a burst is refused, not cut short
+		uint8_t burst[MPU9250_INIT_MAX_BURST + 1] = {};
+		bus.write(MPU9250_ADDRESS, SMPLRT_DIV, burst, sizeof(burst));
+		CHECK(bus.error() == EMSGSIZE);
+
+		//Moved, only the new owner closes
+		LinuxI2CBus moved(std::move(bus));
+		CHECK(!bus.isOpen());
+		CHECK(moved.isOpen());
+	}
+	CHECK(!fdOpen(probe));
+
+	//The driver takes the bus by move, Init fails on WHO_AM_I
+	{
+		MPU9250T<LinuxI2CBus> imu(LinuxI2CBus("/dev/null"));
+		CHECK(imu.GetBus().isOpen());
+		CHECK(imu.StartupTicks() == 0);
+		CHECK(fdOpen(probe));
+	}
+	CHECK(!fdOpen(probe));
+
+	return checkResult();
+}
@@ -0,0 +1,83 @@
+/*
+ * test_madgwick.cpp
+ *
+ *  Madgwick on synthetic 1 kHz samples of a known motion in NWU and NED, and the error of the
+ *  fast math it runs on (fusion::invSqrt, fusion::fastAtan2).
+ */
+
+#include "check.h"
+#include "motion.h"
+
+using namespace IMU;
+
+/*
+ * Samples of truth, optionally rotating at w (rad/s), n of them at 1 kHz. Returns the worst
+ * attitude error in deg over the samples after settle.
+ */
+static double run(Madgwick &f, Earth earth, Quat &truth, const double w[3], uint32_t n, uint32_t settle)
+{
+	double g[3], b[3];
+	earthFields(earth, g, b);
+
+	double worst = 0.0;
+	for(uint32_t i = 0; i < n; i++)
+	{
+		truth = truth * rotation(w[0] * 1e-3, w[1] * 1e-3, w[2] * 1e-3);
+
+		MotionSample s{};
+		toBody(truth, g, s.acc);
+		toBody(truth, b, s.mag);
+		for(uint8_t k = 0; k < 3; k++) s.gyr[k] = float(w[k]);
+		s.stamp = i * 1000;
+
+		f.Update(s);
+		if(i >= settle && angleDeg(f.GetQuaternion(), truth) > worst) worst = angleDeg(f.GetQuaternion(), truth);
+	}
+
+	return worst;
+}
+
+int main()
+{
+	//invSqrt, relative error < 0.07 % over the range the filters normalise
+	double worst = 0.0;
+	for(float x = 1e-6f; x < 1e6f; x *= 1.01f) worst = fmax(worst, fabs(double(fusion::invSqrt(x)) * sqrt(double(x)) - 1.0));
+	CHECK(worst < 7e-4);
+
+	//fastAtan2 < 1e-5 rad all the way round, at several radii
+	worst = 0.0;
+	for(double a = -M_PI; a < M_PI; a += 1e-4)
+	{
+		for(double r : {1e-3, 1.0, 1e3}) worst = fmax(worst, fabs(fusion::fastAtan2(float(r * sin(a)), float(r * cos(a))) - a));
+	}
+	CHECK(worst < 1e-5);
+	CHECK(fusion::fastAtan2(0.0f, 0.0f) == 0.0f);
+
+	const double still[3] = {0.0, 0.0, 0.0}, spin[3] = {0.3, -0.2, 0.5};
+
+	for(Earth earth : {Earth::NWU, Earth::NED})
+	{
+		//Known attitude 70 deg from the identity start, Euler angles within 0.1 deg after 60 s
+		const double roll = 0.5, pitch = -0.3, yaw = 1.0;
+		Quat truth = fromEuler(roll, pitch, yaw);
+		Madgwick still1(0.1f, 1e-6f, earth);
+		run(still1, earth, truth, still, 60000, 0);
+
+		const EulerAngles e = still1.GetEuler();
+		CHECK(wrapDeg(e.roll, roll) < 0.1);
+		CHECK(wrapDeg(e.pitch, pitch) < 0.1);
+		CHECK(wrapDeg(e.yaw, yaw) < 0.1);
+
+		//Tracking a constant rate, started on the truth
+		Quat moving{1, 0, 0, 0};
+		Madgwick tracker(0.1f, 1e-6f, earth);
+		CHECK(run(tracker, earth, moving, spin, 20000, 0) < 0.1);
+
+		//30 deg off at the start, within 1 deg after 15 s
+		Quat off = fromEuler(M_PI / 6, 0, 0);
+		Madgwick converge(0.1f, 1e-6f, earth);
+		CHECK(run(converge, earth, off, spin, 20000, 15000) < 1.0);
+	}
+
+	return checkResult();
+}
@@ -0,0 +1,79 @@
+/*
+ * test_mount.cpp
+ *
+ *  Board mountings other than SensorFrame instantiate from the header and map accel, gyro and mag
+ *  into the body frame (MPU9250_Orient.h).
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+//The example from MPU9250_Orient.h
+struct RotatedZ90 { static constexpr AxisMap axes = {{1, 0, 2}, {-1, 1, 1}}; };
+
+static const int16_t accRaw[3] = {1000, -2000, 3000};
+static const int16_t gyrRaw[3] = {-400, 500, 600};
+static const int16_t magRaw[3] = {70, -80, 90};		/*AK8963 axes*/
+
+template<class Mount>
+static void read(float acc[3], float gyr[3], float mag[3])
+{
+	MPU9250T<SimBus, float, Mount> imu{SimBus()};
+	setMotion(imu.GetBus(), accRaw, 0, gyrRaw);
+	setMag(imu.GetBus(), magRaw);
+
+	imu.ReadAll(imu);
+	CHECK(imu.ReadMag(imu));
+
+	const MotionSample s = imu.Snapshot();
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		acc[i] = s.acc[i];
+		gyr[i] = s.gyr[i];
+		mag[i] = s.mag[i];
+	}
+}
+
+int main()
+{
+	float a[3], g[3], m[3];
+	read<SensorFrame>(a, g, m);
+
+	//The chip frame itself, the AK8963 has X and Y swapped and Z inverted
+	const float ka = perCount(Ascale::AFS_2G), kg = perCount(Gscale::GFS_250DPS), km = perCount(Mscale::MFS_16BITS);
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		CHECK_NEAR(a[i], accRaw[i] * ka, 1e-6);
+		CHECK_NEAR(g[i], gyrRaw[i] * kg, 1e-6);
+	}
+	CHECK_NEAR(m[0], magRaw[1] * km, 1e-4);
+	CHECK_NEAR(m[1], magRaw[0] * km, 1e-4);
+	CHECK_NEAR(m[2], -magRaw[2] * km, 1e-4);
+
+	//x forward, y and z flipped
+	float an[3], gn[3], mn[3];
+	read<NEDFaceUp>(an, gn, mn);
+	const float ned[3] = {1.0f, -1.0f, -1.0f};
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		CHECK(an[i] == ned[i] * a[i]);
+		CHECK(gn[i] == ned[i] * g[i]);
+		CHECK(mn[i] == ned[i] * m[i]);
+	}
+
+	//body x = -sensor y, body y = sensor x
+	float ar[3], gr[3], mr[3];
+	read<RotatedZ90>(ar, gr, mr);
+	const float *in[3] = {a, g, m};
+	const float *out[3] = {ar, gr, mr};
+	for(uint8_t k = 0; k < 3; k++)
+	{
+		CHECK(out[k][0] == -in[k][1]);
+		CHECK(out[k][1] == in[k][0]);
+		CHECK(out[k][2] == in[k][2]);
+	}
+
+	return checkResult();
+}
@@ -0,0 +1,70 @@
+/*
+ * test_nack.cpp
+ *
+ *  Failed reads on the HAL buses. The part NACKs for a while after H_RESET, a read in that window
+ *  is HAL_ERROR with the buffer untouched: the bus hands back zeros and false, and the init polls
+ *  keep waiting instead of taking the zeros for H_RESET done. The configuration written after the
+ *  reset then lands on the part, as without the NACKs.
+ */
+
+#include "check.h"
+#include "sim.h"
+#include "hal_sim.h"
+
+using namespace IMU;
+
+static constexpr uint8_t CONFIG_REGS[] = {SMPLRT_DIV, CONFIG, GYRO_CONFIG, ACCEL_CONFIG, ACCEL_CONFIG2, INT_PIN_CFG, INT_ENABLE, PWR_MGMT_1, USER_CTRL};
+
+int main()
+{
+	//The configuration of a part that answers at once
+	halReset();
+	I2C_HandleTypeDef hi2c1{1};
+	uint8_t expected[sizeof(CONFIG_REGS)];
+	{
+		MPU9250 imu(hi2c1);
+		for(uint8_t i = 0; i < sizeof(CONFIG_REGS); i++) expected[i] = halDevice().mpu[CONFIG_REGS[i]];
+	}
+
+	//Bus level: zeros and false while NACKed, the HAL stand-in leaves the buffer alone
+	halReset();
+	halNackAfterReset(5);
+	I2CBus bus(hi2c1);
+	bus.write(MPU9250_ADDRESS, PWR_MGMT_1, PWR_MGMT_1_H_RESET);
+	uint8_t buf[2] = {0xAA, 0xAA};
+	CHECK(!bus.read(MPU9250_ADDRESS, WHO_AM_I_MPU9250, buf, 2));
+	CHECK(buf[0] == 0 && buf[1] == 0);
+	CHECK(bus.readByte(MPU9250_ADDRESS, WHO_AM_I_MPU9250) == 0);
+	HAL_Delay(5);
+	CHECK(bus.read(MPU9250_ADDRESS, WHO_AM_I_MPU9250, buf, 1));
+	CHECK(buf[0] == MPU9250_WHO_AM_I_VALUE);
+
+	//Init through a 5 ms NACK window after the reset: the H_RESET poll waits it out
+	halReset();
+	halNackAfterReset(5);
+	MPU9250 imu(hi2c1);
+	CHECK(HAL_GetTick() >= 5);
+	for(uint8_t i = 0; i < sizeof(CONFIG_REGS); i++) CHECK(halDevice().mpu[CONFIG_REGS[i]] == expected[i]);
+	CHECK(imu.Init());
+
+	//A part that never comes back fails Init at the poll timeout
+	halNackAfterReset(1000);
+	const uint32_t start = HAL_GetTick();
+	CHECK(!imu.Init());
+	CHECK(HAL_GetTick() - start <= MPU9250_BOOT_TIMEOUT_MS + 1);
+
+	//SPI: a frame the part does not take (NCS on another pin) reads as zeros and false
+	halReset();
+	GPIO_TypeDef gpioa{}, gpiob{0x0010};		//the part's NCS stays high
+	SPI_TypeDef spi1{SPI_CR1_SPE};
+	SPI_HandleTypeDef hspi1{&spi1};
+	halSelectCS(&gpiob, 0x0010);
+	SPIBus spi(hspi1, &gpioa, 0x0010);
+	buf[0] = buf[1] = 0xAA;
+	CHECK(!spi.read(MPU9250_ADDRESS, WHO_AM_I_MPU9250, buf, 2));
+	CHECK(buf[0] == 0 && buf[1] == 0);
+	CHECK(spi.readByte(MPU9250_ADDRESS, WHO_AM_I_MPU9250) == 0);
+	CHECK(gpioa.ODR & 0x0010);
+
+	return checkResult();
+}
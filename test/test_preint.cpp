@@ -0,0 +1,181 @@
+/*
+ * test_preint.cpp
+ *
+ *  PreIntegrator against motion where the plain sum of rates and accels goes wrong, 1 kHz samples
+ *  decimated to 100 Hz for 10 s. Coning: the rotation vector traces a cone, the attitude is known
+ *  in closed form. Sculling: a roll oscillation in phase with a lateral vibration, the truth is a
+ *  fine step integration. Each with the corrected increments and with the plain sums.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "motion.h"
+#include "MPU9250_PreInt.h"
+
+using namespace IMU;
+
+static constexpr uint32_t RATE = 1000;
+static constexpr uint16_t DECIMATION = 10;
+static constexpr uint32_t SECONDS = 10;
+static constexpr double OMEGA = 2.0 * M_PI * 20.0;
+
+/*
+ * Coning: rotation vector (a cos, a sin, 0), 0.05 rad (2.9 deg) at 20 Hz.
+ */
+static Quat coning(double t)
+{
+	return rotation(0.05 * cos(OMEGA * t), 0.05 * sin(OMEGA * t), 0.0);
+}
+
+/*
+ * Body rate of coning(t), 2 q* dq/dt by central difference. h^2 keeps it far below the bounds.
+ */
+static void coningRate(double t, double w[3])
+{
+	const double h = 1e-6;
+	const Quat a = coning(t - h), b = coning(t + h), q = coning(t);
+	const Quat dq{(b.w - a.w) / (2 * h), (b.x - a.x) / (2 * h), (b.y - a.y) / (2 * h), (b.z - a.z) / (2 * h)};
+	const Quat r = Quat{q.w, -q.x, -q.y, -q.z} * dq;
+
+	w[0] = 2 * r.x;
+	w[1] = 2 * r.y;
+	w[2] = 2 * r.z;
+}
+
+static void testConing()
+{
+	PreIntegrator pre(DECIMATION);
+	Quat corrected = coning(0.0), plain = coning(0.0);
+	double sum[3] = {};
+	uint32_t increments = 0;
+
+	for(uint32_t i = 0; i <= SECONDS * RATE; i++)
+	{
+		double w[3];
+		coningRate(double(i) / RATE, w);
+
+		const float gyr[3] = {float(w[0]), float(w[1]), float(w[2])};
+		const float acc[3] = {0.0f, 0.0f, 0.0f};
+
+		Increment inc;
+		if(pre.Add(gyr, acc, 1.0f / RATE, inc))
+		{
+			corrected = corrected * rotation(inc.dTheta[0], inc.dTheta[1], inc.dTheta[2]);
+			increments++;
+			CHECK(inc.samples == DECIMATION);
+			CHECK_NEAR(inc.dt, double(DECIMATION) / RATE, 1e-6);
+		}
+
+		//The plain sum, the same samples (rectangular) with no coning term
+		if(i == 0) continue;
+		for(uint8_t k = 0; k < 3; k++) sum[k] += w[k] / RATE;
+		if(i % DECIMATION == 0)
+		{
+			plain = plain * rotation(sum[0], sum[1], sum[2]);
+			sum[0] = sum[1] = sum[2] = 0.0;
+		}
+	}
+
+	const Quat truth = coning(SECONDS);
+	const IMU::Quaternion c{float(corrected.w), float(corrected.x), float(corrected.y), float(corrected.z)};
+	const IMU::Quaternion p{float(plain.w), float(plain.x), float(plain.y), float(plain.z)};
+
+	CHECK(increments == SECONDS * RATE / DECIMATION);
+	CHECK(angleDeg(c, truth) < 0.5);
+	CHECK(angleDeg(p, truth) > 10.0);
+}
+
+/*
+ * Sculling: roll 0.05 sin, body y specific force 2 sin, both at 25 Hz. The truth velocity (earth
+ * frame, no gravity) is integrated in double at 100 kHz, both estimates rotate their increments with
+ * the true attitude at the start of the interval so only the velocity algorithm is under test.
+ */
+static constexpr double SCUL_OMEGA = 2.0 * M_PI * 25.0;
+
+static void sculling(double t, double &roll, double f[3])
+{
+	roll = 0.05 * sin(SCUL_OMEGA * t);
+	f[0] = 0.0;
+	f[1] = 2.0 * sin(SCUL_OMEGA * t);
+	f[2] = 0.0;
+}
+
+static void toEarth(double roll, const double v[3], double out[3])
+{
+	out[0] = v[0];
+	out[1] = cos(roll) * v[1] - sin(roll) * v[2];
+	out[2] = sin(roll) * v[1] + cos(roll) * v[2];
+}
+
+static void testSculling()
+{
+	PreIntegrator pre(DECIMATION);
+	double corrected[3] = {}, plain[3] = {}, sum[3] = {};
+	double start = 0.0;		//roll at the start of the interval
+
+	for(uint32_t i = 0; i <= SECONDS * RATE; i++)
+	{
+		const double t = double(i) / RATE;
+		double roll, f[3];
+		sculling(t, roll, f);
+
+		const float gyr[3] = {float(0.05 * SCUL_OMEGA * cos(SCUL_OMEGA * t)), 0.0f, 0.0f};
+		const float acc[3] = {float(f[0]), float(f[1]), float(f[2])};
+
+		Increment inc;
+		if(pre.Add(gyr, acc, 1.0f / RATE, inc))
+		{
+			const double dv[3] = {inc.dVel[0], inc.dVel[1], inc.dVel[2]};
+			double e[3];
+			toEarth(start, dv, e);
+			for(uint8_t k = 0; k < 3; k++) corrected[k] += e[k];
+		}
+
+		if(i > 0)
+		{
+			for(uint8_t k = 0; k < 3; k++) sum[k] += f[k] / RATE;
+			if(i % DECIMATION == 0)
+			{
+				double e[3];
+				toEarth(start, sum, e);
+				for(uint8_t k = 0; k < 3; k++) plain[k] += e[k];
+				sum[0] = sum[1] = sum[2] = 0.0;
+			}
+		}
+
+		if(i % DECIMATION == 0) start = roll;
+	}
+
+	//Truth, midpoint rule at 100 kHz
+	double truth[3] = {};
+	const uint32_t steps = SECONDS * 100000;
+	for(uint32_t i = 0; i < steps; i++)
+	{
+		double roll, f[3], e[3];
+		sculling((i + 0.5) * 1e-5, roll, f);
+		toEarth(roll, f, e);
+		for(uint8_t k = 0; k < 3; k++) truth[k] += e[k] * 1e-5;
+	}
+
+	//The rectified part is along earth z, 1/2 * 0.05 * 2 = 0.05 m/s^2, 0.5 m/s after 10 s
+	CHECK(truth[2] > 0.4);
+
+	double errCorrected = 0.0, errPlain = 0.0;
+	for(uint8_t k = 0; k < 3; k++)
+	{
+		errCorrected = fmax(errCorrected, fabs(corrected[k] - truth[k]));
+		errPlain = fmax(errPlain, fabs(plain[k] - truth[k]));
+	}
+
+	CHECK(errCorrected < 0.01);
+	CHECK(errPlain > 0.1);
+}
+
+int main()
+{
+	testConing();
+	testSculling();
+
+	return checkResult();
+}
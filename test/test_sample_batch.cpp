@@ -0,0 +1,179 @@
+/*
+ * test_sample_batch.cpp
+ *
+ *  SampleBatch on its own (tail / commit / push, capacity), then acquisition into it: ReadFIFO drains
+ *  into the columns with the same values as the AoS ReadFIFO on the same frames, bounded by the space
+ *  left. A FIFO overflow on SimBus (oldest bytes overwritten) resets the FIFO, and the first sample
+ *  after it carries SAMPLE_GAP. PopSamples moves the data ready queue over as PopSample would.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint16_t INT_PIN = 0x0100;
+
+/*
+ * Frame n of accel + temp + gyro, every word different.
+ */
+static void pushFrames(SimBus &bus, uint16_t first, uint16_t count)
+{
+	for(uint16_t n = first; n < first + count; n++)
+	{
+		uint8_t frame[14];
+		for(uint8_t w = 0; w < 7; w++)
+		{
+			const int16_t v = int16_t(n * 7 + w - 300);
+			frame[2 * w] = uint8_t(uint16_t(v) >> 8);
+			frame[2 * w + 1] = uint8_t(v);
+		}
+		bus.pushFIFO(frame, sizeof(frame));
+	}
+}
+
+/*
+ * Column i of the batch equals the AoS sample.
+ */
+template<uint16_t N>
+static bool matches(const batch::SampleBatch<float, N> &b, uint16_t i, const MotionSample &s)
+{
+	bool same = b.temp[i] == s.temp;
+	for(uint8_t a = 0; a < 3; a++) same = same && b.acc[a][i] == s.acc[a] && b.gyr[a][i] == s.gyr[a];
+	return same;
+}
+
+static void testContainer()
+{
+	batch::SampleBatch<float, 4> b;
+	CHECK(b.count == 0 && b.space() == 4);
+
+	//Columns straight into the free slots, committed with one stamp and flags
+	batch::Columns<float> t = b.tail();
+	for(uint8_t c = 0; c < batch::COLUMNS; c++) t.col[c][0] = t.col[c][1] = float(c);
+	b.commit(2, 77, batch::SAMPLE_FIFO);
+	CHECK(b.count == 2 && b.space() == 2);
+	CHECK(b.acc[2][1] == 2.0f && b.temp[0] == 3.0f && b.gyr[0][1] == 4.0f);
+	CHECK(b.stamp[0] == 77 && b.stamp[1] == 77 && b.flags[1] == batch::SAMPLE_FIFO);
+
+	//tail moves on
+	t = b.tail();
+	CHECK(t.col[batch::AX] == &b.acc[0][2] && t.col[batch::GZ] == &b.gyr[2][2] && t.col[batch::TEMP] == &b.temp[2]);
+
+	MotionSample s{};
+	s.acc[1] = 5.0f;
+	s.mag[2] = 6.0f;
+	s.temp = 25.0f;
+	s.stamp = 99;
+	CHECK(b.push(s, batch::SAMPLE_MAG));
+	CHECK(b.push(s, batch::SAMPLE_MAG));
+	CHECK(!b.push(s, batch::SAMPLE_MAG));
+	CHECK(b.count == 4 && b.space() == 0);
+	CHECK(b.acc[1][3] == 5.0f && b.mag[2][3] == 6.0f && b.temp[2] == 25.0f && b.stamp[3] == 99 && b.flags[2] == batch::SAMPLE_MAG);
+
+	b.clear();
+	CHECK(b.count == 0 && b.space() == 4);
+}
+
+static void testFIFO()
+{
+	MPU9250T<SimBus> soa{SimBus()}, aos{SimBus()};
+	soa.EnableFIFO(true);
+	aos.EnableFIFO(true);
+
+	//More than the batch holds: drained in two goes, the rest waits in the FIFO
+	pushFrames(soa.GetBus(), 0, 30);
+	pushFrames(aos.GetBus(), 0, 30);
+
+	static batch::SampleBatch<float, 20> b;
+	MotionSample ref[36];
+	CHECK(soa.ReadFIFO(b) == 20);
+	CHECK(b.space() == 0);
+	CHECK(soa.ReadFIFO(b) == 0);
+	CHECK(aos.ReadFIFO(ref, 20) == 20);
+
+	uint16_t mismatch = 0;
+	for(uint16_t i = 0; i < 20; i++)
+	{
+		mismatch += !matches(b, i, ref[i]);
+		CHECK(b.flags[i] == (batch::SAMPLE_FIFO | batch::SAMPLE_TEMP));
+	}
+	CHECK(mismatch == 0);
+
+	b.clear();
+	CHECK(soa.ReadFIFO(b) == 10);
+	CHECK(aos.ReadFIFO(ref, 20) == 10);
+	for(uint16_t i = 0; i < 10; i++) mismatch += !matches(b, i, ref[i]);
+	CHECK(mismatch == 0);
+
+	//Past 512 bytes the part overwrites the oldest frames: the drain resets the FIFO, no samples
+	b.clear();
+	pushFrames(soa.GetBus(), 100, 40);
+	CHECK(soa.GetBus().reg(MPU9250_ADDRESS, INT_STATUS) & INT_FIFO_OFLOW);
+	CHECK(soa.GetBus().fifoLen == MPU9250_FIFO_SIZE);
+	const uint16_t newest = uint16_t(139 * 7 - 300);		//accel x of the last frame pushed
+	CHECK(soa.GetBus().fifo[MPU9250_FIFO_SIZE - 14] == uint8_t(newest >> 8) && soa.GetBus().fifo[MPU9250_FIFO_SIZE - 13] == uint8_t(newest));
+	CHECK(soa.ReadFIFO(b) == 0);
+	CHECK(soa.FIFOOverflowed());
+	CHECK(soa.GetBus().fifoLen == 0);
+	CHECK(!(soa.GetBus().reg(MPU9250_ADDRESS, INT_STATUS) & INT_FIFO_OFLOW));
+
+	//The next drain starts on a frame boundary again, its first sample marks the gap
+	pushFrames(soa.GetBus(), 200, 5);
+	pushFrames(aos.GetBus(), 200, 5);
+	CHECK(soa.ReadFIFO(b) == 5);
+	CHECK(!soa.FIFOOverflowed());
+	CHECK(aos.ReadFIFO(ref, 20) == 5);
+	CHECK(b.flags[0] == (batch::SAMPLE_FIFO | batch::SAMPLE_TEMP | batch::SAMPLE_GAP));
+	for(uint16_t i = 0; i < 5; i++) mismatch += !matches(b, i, ref[i]);
+	for(uint16_t i = 1; i < 5; i++) CHECK(!(b.flags[i] & batch::SAMPLE_GAP));
+	CHECK(mismatch == 0);
+
+	//and only that one
+	pushFrames(soa.GetBus(), 300, 2);
+	CHECK(soa.ReadFIFO(b) == 2);
+	CHECK(!(b.flags[5] & batch::SAMPLE_GAP));
+}
+
+static void testQueue()
+{
+	MPU9250T<SimBus> soa{SimBus()}, aos{SimBus()};
+	soa.EnableDataReadyIRQ(INT_PIN);
+	aos.EnableDataReadyIRQ(INT_PIN);
+
+	for(uint32_t i = 1; i <= 6; i++)
+	{
+		const int16_t acc[3] = {int16_t(i), int16_t(-2 * i), 300}, gyr[3] = {-1, int16_t(i), 3};
+		setMotion(soa.GetBus(), acc, int16_t(i * 10), gyr);
+		setMotion(aos.GetBus(), acc, int16_t(i * 10), gyr);
+		soa.OnDataReady(INT_PIN, i);
+		aos.OnDataReady(INT_PIN, i);
+	}
+
+	batch::SampleBatch<float, 4> b;
+	CHECK(soa.PopSamples(b) == 4);
+	CHECK(soa.PopSamples(b) == 0);
+
+	MotionSample s{};
+	for(uint16_t i = 0; i < 4; i++)
+	{
+		CHECK(aos.PopSample(s));
+		CHECK(matches(b, i, s));
+		CHECK(b.stamp[i] == s.stamp && b.stamp[i] == i + 1u);
+		CHECK(b.flags[i] == batch::SAMPLE_TEMP);
+	}
+
+	//The rest is still queued for the next batch
+	b.clear();
+	CHECK(soa.PopSamples(b) == 2);
+	CHECK(b.stamp[1] == 6);
+}
+
+int main()
+{
+	testContainer();
+	testFIFO();
+	testQueue();
+
+	return checkResult();
+}
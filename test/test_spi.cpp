@@ -0,0 +1,61 @@
+/*
+ * test_spi.cpp
+ *
+ *  SPIBus against the HAL stand-in's SPI loopback: init in master mode, the motion and mag burst in
+ *  one frame and the prescaler switch between configuration and data registers.
+ */
+
+#include "check.h"
+#include "sim.h"
+#include "hal_sim.h"
+
+using namespace IMU;
+
+static constexpr uint16_t NCS_PIN = 0x0010;
+
+int main()
+{
+	halReset();
+
+	GPIO_TypeDef gpioa{};
+	SPI_TypeDef spi1{SPI_CR1_SPE};
+	SPI_HandleTypeDef hspi1{&spi1};
+	halSelectCS(&gpioa, NCS_PIN);
+
+	MPU9250T<SPIBus> imu(SPIBus(hspi1, &gpioa, NCS_PIN));
+	SimBus &dev = halDevice();
+
+	//Init ran on the slow clock, I2C interface off, AK8963 behind the I2C master
+	const HalSPIStats init = halSPIStats();
+	CHECK(init.frames > 0);
+	CHECK(init.errors == 0);
+	CHECK(dev.reg(MPU9250_ADDRESS, USER_CTRL) & USER_CTRL_I2C_IF_DIS);
+	CHECK(dev.reg(MPU9250_ADDRESS, USER_CTRL) & USER_CTRL_I2C_MST_EN);
+	CHECK((dev.reg(AK8963_ADDRESS, AK8963_CNTL) & 0x0F) == 0x06);
+	CHECK(gpioa.ODR & NCS_PIN);
+
+	//Accel, temp, gyro and mag in one fast frame
+	const int16_t acc[3] = {100, -200, 300}, gyr[3] = {-1, 2, -3}, mag[3] = {40, 50, 60};
+	setMotion(dev, acc, 0, gyr);
+	setMag(dev, mag, true);
+
+	imu.ReadAll(imu);
+	const MotionSample s = imu.Snapshot();
+	CHECK(halSPIStats().frames - init.frames == 1);
+	CHECK(halSPIStats().fastReads - init.fastReads == 1);
+	CHECK((spi1.CR1 & SPI_CR1_BR) == SPI_BAUDRATEPRESCALER_8);
+	CHECK_NEAR(s.acc[1], -200 * perCount(Ascale::AFS_2G), 1e-6);
+	CHECK_NEAR(s.gyr[2], -3 * perCount(Gscale::GFS_250DPS), 1e-6);
+	CHECK(s.mag[0] != 0.0f);
+
+	//A configuration register goes back to the slow prescaler, SPE is on again after the change
+	CHECK(imu.GetBus().readByte(MPU9250_ADDRESS, WHO_AM_I_MPU9250) == MPU9250_WHO_AM_I_VALUE);
+	CHECK((spi1.CR1 & SPI_CR1_BR) == SPI_BAUDRATEPRESCALER_128);
+	CHECK(spi1.CR1 & SPI_CR1_SPE);
+
+	imu.ReadAll(imu);
+	CHECK(halSPIStats().errors == 0);
+	CHECK(gpioa.ODR & NCS_PIN);
+
+	return checkResult();
+}
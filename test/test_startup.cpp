@@ -0,0 +1,49 @@
+/*
+ * test_startup.cpp
+ *
+ *  Cold start on the SimBus timeline: H_RESET busy for 1 ms, first sample 35 ms later (gyro start-up,
+ *  datasheet pg 8). Init polls every step, so the first valid sample comes well inside 50 ms in both
+ *  mag modes, where fixed sleeps would have added up past it.
+ */
+
+#include "check.h"
+#include "sim.h"
+
+using namespace IMU;
+
+static constexpr uint32_t RESET_US = 1000;
+static constexpr uint32_t STARTUP_US = 35000;
+static constexpr uint32_t BUDGET_US = 50000;
+
+static SimBus coldPart()
+{
+	SimBus bus;
+	bus.resetUs = RESET_US;
+	bus.startupUs = STARTUP_US;
+	return bus;
+}
+
+int main()
+{
+	for(MagMode mode : {MagMode::Bypass, MagMode::Master})
+	{
+		MPU9250T<SimBus> imu(coldPart(), mode);
+		SimBus &bus = imu.GetBus();
+
+		//Done once the sample is there, within the 1 ms poll step
+		CHECK(imu.StartupTicks() >= RESET_US + STARTUP_US);
+		CHECK(imu.StartupTicks() <= RESET_US + STARTUP_US + 1000);
+		CHECK(imu.StartupTicks() < BUDGET_US);
+		CHECK(bus.now == imu.StartupTicks());
+		CHECK(bus.reg(AK8963_ADDRESS, AK8963_CNTL) == 0x16);
+	}
+
+	//A part that never answers gives up after the WHO_AM_I timeout
+	SimBus dead;
+	dead.mpu[WHO_AM_I_MPU9250] = 0;
+	MPU9250T<SimBus> none(dead);
+	CHECK(none.StartupTicks() == 0);
+	CHECK(none.GetBus().now == MPU9250_BOOT_TIMEOUT_MS * 1000);
+
+	return checkResult();
+}